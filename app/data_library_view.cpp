@@ -2,6 +2,7 @@
 #include "data_info_view.hpp"
 #include "../data/data_library.hpp"
 #include "../data/data_source.hpp"
+#include "../reactive/reactive.hpp"
 
 #include <QTreeWidgetItem>
 #include <QStringList>
@@ -18,7 +19,7 @@ DataLibraryView::DataLibraryView(QWidget * parent):
     m_lib_tree = new DataSetTree;
     m_lib_tree->setDragEnabled(true);
 
-    m_lib_tree->setHeaderLabels(QStringList() << "Name" << "Size");
+    m_lib_tree->setHeaderLabels(QStringList() << "Name" << "Size" << "Progress");
     m_lib_tree->header()->setSectionHidden(1,true);
 
     m_dataset_info = new DataInfoView;
@@ -90,6 +91,9 @@ void DataLibraryView::updateLibraryTree()
             texts << name;
             texts << size_text;
 
+            auto progress = m_progress_text.find({ source, id });
+            texts << (progress != m_progress_text.end() ? progress->second : QString());
+
             auto dataset_item = new QTreeWidgetItem(texts);
 
             source_item->addChild(dataset_item);
@@ -100,6 +104,76 @@ void DataLibraryView::updateLibraryTree()
     }
 }
 
+void DataLibraryView::trackProgress(DataSource * source, const string & id,
+                                    const FutureDataset & dataset)
+{
+    if (!dataset)
+        return;
+
+    std::pair<DataSource*, string> key { source, id };
+    std::weak_ptr<Reactive::Value_Data<DataSetPtr>> tracked = dataset;
+
+    // Whether both refer to the same value, even once it is destroyed.
+    auto same = [](const std::weak_ptr<Reactive::Value_Data<DataSetPtr>> & a,
+                   const std::weak_ptr<Reactive::Value_Data<DataSetPtr>> & b)
+    {
+        return !a.owner_before(b) && !b.owner_before(a);
+    };
+
+    auto current = m_tracked.find(key);
+    if (current != m_tracked.end() && same(current->second, tracked))
+        return;
+
+    m_tracked[key] = tracked;
+
+    Reactive::on_progress(dataset, this,
+                          [=, this](const Reactive::Progress & progress, std::shared_ptr<const DataSetPtr>)
+    {
+        // Ignore data sets replaced meanwhile.
+        auto current = m_tracked.find(key);
+        if (current == m_tracked.end() || !same(current->second, tracked))
+            return;
+
+        if (progress.failed || progress.fraction >= 1)
+        {
+            m_progress_text.erase(key);
+            m_tracked.erase(current);
+        }
+        else
+        {
+            QString text = progress.phase.empty() ? QString("Loading")
+                                                  : QString::fromStdString(progress.phase);
+            if (progress.fraction >= 0)
+                text += QString(" %1%").arg(int(progress.fraction * 100));
+            m_progress_text[key] = text;
+        }
+
+        updateProgressText(source, id);
+    });
+}
+
+void DataLibraryView::updateProgressText(DataSource * source, const string & id)
+{
+    auto progress = m_progress_text.find({ source, id });
+    QString text = progress != m_progress_text.end() ? progress->second : QString();
+
+    // Update the item in place, to preserve selection.
+
+    for (int i = 0; i < m_lib_tree->topLevelItemCount(); ++i)
+    {
+        auto source_item = m_lib_tree->topLevelItem(i);
+        if (source_item->data(0, Qt::UserRole).value<DataSource*>() != source)
+            continue;
+
+        for (int j = 0; j < source_item->childCount(); ++j)
+        {
+            auto dataset_item = source_item->child(j);
+            if (dataset_item->text(0).toStdString() == id)
+                dataset_item->setText(2, text);
+        }
+    }
+}
+
 void DataLibraryView::updateDimTree()
 {
     const auto & dimensions = m_lib->dimensions();
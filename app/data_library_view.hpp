@@ -1,15 +1,18 @@
 #pragma once
 
+#include "../data/data_source.hpp"
+
 #include <QWidget>
 #include <QTreeWidget>
 #include <QMimeData>
 #include <vector>
 #include <string>
+#include <map>
+#include <utility>
 
 namespace datavis {
 
 class DataLibrary;
-class DataSource;
 class DataInfoView;
 
 using std::vector;
@@ -41,6 +44,11 @@ public:
     //int selectedDatasetIndex();
     string selectedDatasetId();
 
+    // Shows progress of loading the data set next to it,
+    // until it is loaded, fails or is no longer needed.
+    // Does nothing if the data set is already tracked.
+    void trackProgress(DataSource *, const string & id, const FutureDataset &);
+
 signals:
     void selectionChanged();
 
@@ -48,11 +56,17 @@ private:
     void updateLibraryTree();
     void updateDimTree();
     void updateDataInfo();
+    void updateProgressText(DataSource *, const string & id);
 
     DataLibrary * m_lib = nullptr;
     QTreeWidget * m_lib_tree = nullptr;
     QTreeWidget * m_dim_tree = nullptr;
     DataInfoView * m_dataset_info = nullptr;
+
+    // Progress text of data sets being loaded, by source and id.
+    std::map<std::pair<DataSource*, string>, QString> m_progress_text;
+    // Data sets whose progress is tracked, by source and id.
+    std::map<std::pair<DataSource*, string>, std::weak_ptr<Reactive::Value_Data<DataSetPtr>>> m_tracked;
 };
 
 class DataSetTree : public QTreeWidget
@@ -79,7 +79,7 @@ void LinePlotSettingsView::updateDimensionList()
     if (!m_plot->dataSet())
         return;
 
-    auto n_dim = m_plot->dataSet()->data()->size().size();
+    auto n_dim = m_plot->dataSet()->size().size();
 
     m_x_dim->clear();
     m_x_dim->addItem("None", int(-1));
@@ -1,9 +1,10 @@
 #include "main_window.hpp"
-#include "../utility/threads.hpp"
+#include "../reactive/trace.hpp"
 
 #include <QApplication>
 #include <QScreen>
 #include <iostream>
+#include <cstdlib>
 
 using namespace std;
 using namespace datavis;
@@ -12,6 +13,13 @@ int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
+    Reactive::Trace::set_thread_name("GUI");
+
+    // Records a trace from startup, saved to the given path on exit.
+    const char * trace_path = std::getenv("DATAVIS_TRACE");
+    if (trace_path && *trace_path)
+        Reactive::Trace::set_enabled(true);
+
     auto args = app.arguments();
 
     QString file_path;
@@ -21,8 +29,6 @@ int main(int argc, char *argv[])
         file_path = args[1];
     }
 
-    background_thread()->start();
-
     auto main_win = new MainWindow;
 
     {
@@ -46,8 +52,11 @@ int main(int argc, char *argv[])
 
     delete main_win;
 
-    background_thread()->quit();
-    background_thread()->wait();
+    if (trace_path && *trace_path)
+    {
+        if (!Reactive::Trace::save(trace_path))
+            cerr << "Failed to save trace to " << trace_path << endl;
+    }
 
     return status;
 }
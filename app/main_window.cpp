@@ -5,6 +5,7 @@
 #include "plot_settings_view2.hpp"
 #include "../plot/plot_view.hpp"
 #include "../plot/line_plot.hpp"
+#include "../plot/multi_line_plot.hpp"
 #include "../plot/heat_map.hpp"
 #include "../plot/scatter_plot_1d.hpp"
 #include "../plot/scatter_plot_2d.hpp"
@@ -12,6 +13,7 @@
 #include "../json/json.hpp"
 #include "../json/utils.hpp"
 #include "../utility/error.hpp"
+#include "../reactive/trace.hpp"
 #include <sstream>
 
 #include <QVBoxLayout>
@@ -146,6 +148,25 @@ void MainWindow::makeMenu()
                     this, &MainWindow::addPlotView);
         }
     }
+
+    {
+        auto menu = menuBar->addMenu("Tools");
+
+        {
+            auto action = menu->addAction("Record Trace");
+            action->setCheckable(true);
+            action->setChecked(Reactive::Trace::enabled());
+            connect(action, &QAction::toggled, [](bool checked)
+            {
+                Reactive::Trace::set_enabled(checked);
+            });
+        }
+        {
+            auto action = menu->addAction("Save Trace...");
+            connect(action, &QAction::triggered,
+                    this, &MainWindow::saveTrace);
+        }
+    }
 }
 
 void MainWindow::openFile(const QString & path)
@@ -303,6 +324,8 @@ Plot * MainWindow::makePlot(DataSource * source, const string & datasetId)
         return nullptr;
 
     auto dataset = source->dataset(datasetId);
+    m_lib_view->trackProgress(source, datasetId, dataset);
+
     auto plot = settings->makePlot(dataset);
 
     if (!plot)
@@ -433,6 +456,22 @@ void MainWindow::saveProjectAs()
     saveProjectFile(file_path);
 }
 
+void MainWindow::saveTrace()
+{
+    auto file_path = QFileDialog::getSaveFileName(this, "Save Trace", QString(),
+                                                  "Chrome Trace (*.json)");
+
+    if (file_path.isEmpty())
+        return;
+
+    if (!Reactive::Trace::save(file_path.toStdString()))
+    {
+        QMessageBox::warning(this, "Save Trace Failed",
+                             "Failed to save the trace"
+                             " because the file could not be accessed.");
+    }
+}
+
 void MainWindow::saveProjectFile(const QString & path)
 {
     ofstream file(path.toStdString());
@@ -683,12 +722,18 @@ void MainWindow::restorePlot(PlotGridView * view, const json & state)
         throw e;
     }
 
+    m_lib_view->trackProgress(source, dataset_id, dataset);
+
     Plot * plot = nullptr;
 
     if (plot_type == "line")
     {
         plot = new LinePlot;
     }
+    else if (plot_type == "multi_line")
+    {
+        plot = new MultiLinePlot;
+    }
     else if (plot_type == "heat_map")
     {
         plot = new HeatMap;
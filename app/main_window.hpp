@@ -42,6 +42,8 @@ public:
     void openProjectFile(const QString & file_path);
     bool closeProject();
 
+    void saveTrace();
+
 protected:
     virtual void dragEnterEvent(QDragEnterEvent *event);
     virtual void dropEvent(QDropEvent *event);
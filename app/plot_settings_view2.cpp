@@ -1,5 +1,6 @@
 #include "plot_settings_view2.hpp"
 #include "../plot/line_plot.hpp"
+#include "../plot/multi_line_plot.hpp"
 #include "../plot/heat_map.hpp"
 #include "../plot/scatter_plot_1d.hpp"
 #include "../plot/scatter_plot_2d.hpp"
@@ -19,12 +20,14 @@ PlotSettingsView::PlotSettingsView(const DataSetInfo & info, QWidget *parent):
 
     m_type = new QComboBox(this);
     m_type->addItem("Line");
+    m_type->addItem("Multi-Line");
     m_type->addItem("Heat Map");
     m_type->addItem("Scatter 1D");
     m_type->addItem("Scatter 2D");
     layout->addWidget(m_type);
 
     m_settings.push_back(new LinePlotSettings(info));
+    m_settings.push_back(new MultiLinePlotSettings(info));
     m_settings.push_back(new HeatMapPlotSettings(info));
     m_settings.push_back(new ScatterPlot1dSettings(info));
     m_settings.push_back(new ScatterPlot2dSettings(info));
@@ -104,6 +107,36 @@ Plot * LinePlotSettings::makePlot(const FutureDataset & dataset)
     return plot;
 }
 
+MultiLinePlotSettings::MultiLinePlotSettings(const DataSetInfo & info, QWidget * parent):
+    PlotSettings(info, parent)
+{
+    auto form = new QFormLayout(this);
+
+    m_dimension = new QComboBox;
+    fillDimensions(m_dimension);
+
+    m_layout = new QComboBox;
+    m_layout->addItem("Overlaid");
+    m_layout->addItem("Stacked");
+
+    form->addRow("Dimension:", m_dimension);
+    form->addRow("Layout:", m_layout);
+}
+
+Plot * MultiLinePlotSettings::makePlot(const FutureDataset & dataset)
+{
+    int dim = m_dimension->currentIndex();
+    if (dim < 0)
+        return nullptr;
+
+    auto layout = m_layout->currentIndex() == 0 ? MultiLinePlot::Overlaid : MultiLinePlot::Stacked;
+
+    auto plot = new MultiLinePlot;
+    plot->setLayout(layout);
+    plot->setDataSet(dataset, dim);
+    return plot;
+}
+
 HeatMapPlotSettings::HeatMapPlotSettings(const DataSetInfo & info, QWidget * parent):
     PlotSettings(info, parent)
 {
@@ -48,6 +48,16 @@ private:
     QComboBox * m_dimension = nullptr;
 };
 
+class MultiLinePlotSettings : public PlotSettings
+{
+public:
+    MultiLinePlotSettings(const DataSetInfo & info, QWidget * parent = nullptr);
+    Plot * makePlot(const FutureDataset &) override;
+private:
+    QComboBox * m_dimension = nullptr;
+    QComboBox * m_layout = nullptr;
+};
+
 class HeatMapPlotSettings : public PlotSettings
 {
 public:
@@ -1,6 +1,13 @@
 #pragma once
 
+#include "array_storage.hpp"
+
 #include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 using namespace std;
@@ -10,18 +17,18 @@ namespace datavis {
 using std::vector;
 
 inline
-int flat_size(const vector<int> & size)
+int64_t flat_size(const vector<int64_t> & size)
 {
-    int fs = 1;
+    int64_t fs = 1;
     for (auto & s : size)
         fs *= s;
     return fs;
 }
 
 inline
-int flat_index(const vector<int> & index, const vector<int> & size)
+int64_t flat_index(const vector<int64_t> & index, const vector<int64_t> & size)
 {
-    int fi = index[0];
+    int64_t fi = index[0];
     for (unsigned d = 1; d < index.size(); ++d)
     {
         fi *= size[d];
@@ -34,20 +41,53 @@ class abstract_array
 {
 };
 
+// An n-dimensional array of elements in row-major order.
+// The elements are held by an array_storage, on the heap by default.
+// Arrays can be moved but not copied.
 template <typename T>
 class array : public abstract_array
 {
 public:
-    using index_t = vector<int>;
-    using size_t = vector<int>;
+    using index_t = vector<int64_t>;
+    using size_t = vector<int64_t>;
 
     array() {}
 
     array(size_t size):
-        m_size(size),
-        m_data(flat_size(size))
+        array(size, std::unique_ptr<array_storage>(new heap_storage<T>(flat_size(size))))
     {}
 
+    // Throws std::invalid_argument if the storage is too small for the size.
+    array(size_t size, std::unique_ptr<array_storage> storage):
+        m_size(size),
+        m_storage(std::move(storage))
+    {
+        if (!m_storage || m_storage->byte_size() < flat_size(m_size) * sizeof(T))
+            throw std::invalid_argument("Array storage is too small.");
+
+        m_data = (T*) m_storage->data();
+    }
+
+    array(array && other):
+        m_size(std::move(other.m_size)),
+        m_storage(std::move(other.m_storage)),
+        m_data(other.m_data)
+    {
+        other.m_data = nullptr;
+    }
+
+    array & operator=(array && other)
+    {
+        m_size = std::move(other.m_size);
+        m_storage = std::move(other.m_storage);
+        m_data = other.m_data;
+        other.m_data = nullptr;
+        return *this;
+    }
+
+    array(const array &) = delete;
+    array & operator=(const array &) = delete;
+
     const size_t & size() const { return m_size; }
 
     T & operator()(const index_t & i)
@@ -62,30 +102,113 @@ public:
         return m_data[j];
     }
 
-    T * data() { return m_data.data(); }
+    T * data() { return m_data; }
+
+    const T * data() const { return m_data; }
 
-    const T * data() const { return m_data.data(); }
+    array_storage * storage() { return m_storage.get(); }
+
+    // Whether the elements must not be changed, see array_storage.
+    bool is_read_only() const { return m_storage && m_storage->is_read_only(); }
 
 private:
     size_t m_size;
-    vector<T> m_data;
+    std::unique_ptr<array_storage> m_storage;
+    T * m_data = nullptr;
+};
+
+// Makes an array using an existing buffer.
+// The deleter, if any, is called with the buffer when the array is destroyed.
+template <typename T>
+array<T> adopt_array(const vector<int64_t> & size, T * data,
+                     std::function<void(T*)> deleter = std::function<void(T*)>())
+{
+    external_storage::deleter_type storage_deleter;
+    if (deleter)
+        storage_deleter = [deleter](void * p){ deleter((T*) p); };
+
+    std::unique_ptr<array_storage> storage
+            (new external_storage(data, flat_size(size) * sizeof(T), storage_deleter));
+
+    return array<T>(size, std::move(storage));
+}
+
+// Makes an array using elements stored in a file, starting at byte offset,
+// in native byte order.
+// The file is mapped into memory, so elements are only read when accessed.
+// The elements are read-only: Changing them crashes.
+template <typename T>
+array<T> map_array(const string & file_path, int64_t offset, const vector<int64_t> & size)
+{
+    std::unique_ptr<array_storage> storage
+            (new mapped_file_storage(file_path, offset, flat_size(size) * sizeof(T)));
+
+    return array<T>(size, std::move(storage));
+}
+
+// A run of elements with a constant distance between them in memory.
+// The run may extend over several dimensions of the array,
+// in which case the elements wrap around into outer dimensions
+// in the usual row-major order.
+template <typename T>
+struct array_span
+{
+    T * data = nullptr;
+    int64_t size = 0;
+    int64_t stride = 0;
+    // Index of the first element relative to the data of the region
+    int64_t index = 0;
+    // Location of the first element in the array
+    vector<int64_t> location;
 };
 
+// Distances between consecutive elements in each dimension
+// of an array stored in row-major order.
+inline
+vector<int64_t> row_major_strides(const vector<int64_t> & size)
+{
+    vector<int64_t> strides(size.size());
+    int64_t s = 1;
+    for (int d = int(size.size()) - 1; d >= 0; --d)
+    {
+        strides[d] = s;
+        s *= size[d];
+    }
+    return strides;
+}
+
+// A rectangular region of an array.
+// The array may have arbitrary strides in each dimension,
+// so it may be a transposed or subsampled view of other data.
+// Element indices are relative to the data pointer:
+// the element at a location has index sum(location[d] * data_stride[d]).
 template <typename T>
 class array_region
 {
     T * m_data = nullptr;
-    vector<int> m_data_size;
-    vector<int> m_region_offset;
-    vector<int> m_region_size;
+    vector<int64_t> m_data_size;
+    vector<int64_t> m_data_stride;
+    vector<int64_t> m_region_offset;
+    vector<int64_t> m_region_size;
 
 public:
     array_region()
     {}
 
-    array_region(array<T> & a, const vector<int> & offset, const vector<int> & size):
-        m_data(a.data()),
-        m_data_size(a.size()),
+    array_region(array<T> & a, const vector<int64_t> & offset, const vector<int64_t> & size):
+        array_region(a.data(), a.size(), offset, size)
+    {}
+
+    array_region(T * data, const vector<int64_t> & data_size,
+                 const vector<int64_t> & offset, const vector<int64_t> & size):
+        array_region(data, data_size, row_major_strides(data_size), offset, size)
+    {}
+
+    array_region(T * data, const vector<int64_t> & data_size, const vector<int64_t> & data_stride,
+                 const vector<int64_t> & offset, const vector<int64_t> & size):
+        m_data(data),
+        m_data_size(data_size),
+        m_data_stride(data_stride),
         m_region_offset(offset),
         m_region_size(size)
     {}
@@ -94,6 +217,7 @@ public:
     {
         return m_data == other.m_data &&
                 m_data_size == other.m_data_size &&
+                m_data_stride == other.m_data_stride &&
                 m_region_offset == other.m_region_offset &&
                 m_region_size == other.m_region_size;
     }
@@ -105,18 +229,43 @@ public:
 
     bool is_valid() const { return m_data != nullptr; }
 
-    const vector<int> & offset() const { return m_region_offset; }
+    T * data() const { return m_data; }
+
+    const vector<int64_t> & data_size() const { return m_data_size; }
+
+    const vector<int64_t> & data_stride() const { return m_data_stride; }
+
+    // Index of the element at location, relative to data().
+    int64_t index_of(const vector<int64_t> & location) const
+    {
+        int64_t index = 0;
+        for (int d = 0; d < (int) location.size(); ++d)
+            index += location[d] * m_data_stride[d];
+        return index;
+    }
+
+    const vector<int64_t> & offset() const { return m_region_offset; }
 
-    const vector<int> & size() const { return m_region_size; }
+    const vector<int64_t> & size() const { return m_region_size; }
+
+    // A region of the same array.
+    // The offset is relative to the array, not to this region.
+    array_region<T> sub_region(const vector<int64_t> & offset, const vector<int64_t> & size) const
+    {
+        array_region<T> r(*this);
+        r.m_region_offset = offset;
+        r.m_region_size = size;
+        return r;
+    }
 
     class iterator
     {
         T * m_data = nullptr;
-        vector<int> m_start;
-        vector<int> m_end;
-        vector<int> m_stride;
-        vector<int> m_location;
-        int m_index = -1;
+        vector<int64_t> m_start;
+        vector<int64_t> m_end;
+        vector<int64_t> m_stride;
+        vector<int64_t> m_location;
+        int64_t m_index = -1;
 
     public:
 #if 0
@@ -128,21 +277,21 @@ public:
                 return m_data[m_index];
             }
 
-            int index() const { return m_index; }
+            int64_t index() const { return m_index; }
 
         private:
             friend class iterator;
             T * m_data;
-            int m_index;
-            vector<int> m_location;
+            int64_t m_index;
+            vector<int64_t> m_location;
         };
 #endif
 
         iterator(T * data,
-                 const vector<int> & start,
-                 const vector<int> & end,
-                 const vector<int> & stride,
-                 int start_index):
+                 const vector<int64_t> & start,
+                 const vector<int64_t> & end,
+                 const vector<int64_t> & stride,
+                 int64_t start_index):
             m_data(data),
             m_start(start),
             m_end(end),
@@ -179,12 +328,12 @@ public:
             return m_data != nullptr;
         }
 
-        const vector<int> & location() const
+        const vector<int64_t> & location() const
         {
             return m_location;
         }
 
-        int index() const { return m_index; }
+        int64_t index() const { return m_index; }
 
         T & value() const
         {
@@ -227,64 +376,134 @@ public:
     {
         int n_dim = m_data_size.size();
 
-        vector<int> flat_strides(n_dim, 0);
+        // Index increment when moving to the next location in a dimension,
+        // after returning to the start in all inner dimensions.
 
-        vector<int> stride(n_dim, 0);
-
-        stride.back() = 1;
+        vector<int64_t> steps(n_dim, 0);
+        int64_t rewind = 0;
 
         for (int d = n_dim - 1; d >= 0; --d)
         {
-            flat_strides[d] = flat_index(stride, m_data_size);
-
-            stride[d] += m_data_size[d] - m_region_size[d];
-/*
-            subspace_size *= m_size[d+1];
-            dim_stride = dim_stride + subspace_size * (m_size[d] - size[d]);
-            stride.push_back(dim_stride);
-            */
-            //cout << "stride " << d << " = " << flat_strides[d] << endl;
+            steps[d] = m_data_stride[d] - rewind;
+            rewind += (m_region_size[d] - 1) * m_data_stride[d];
         }
 
         auto & start = m_region_offset;
-        vector<int> end = m_region_offset;
+        vector<int64_t> end = m_region_offset;
         for (int d = 0; d < m_region_size.size(); ++d)
             end[d] += m_region_size[d];
 
         return iterator(m_data,
                         start,
                         end,
-                        flat_strides,
-                        flat_index(m_region_offset, m_data_size));
-#if 0
-        vector<int> it_size;
-        vector<int> it_stride;
+                        steps,
+                        index_of(m_region_offset));
+    }
+
+    iterator end()
+    {
+        return iterator();
+    }
+
+    // Calls fn(const array_span<T> &) for each of the largest runs of elements
+    // with constant stride, in iteration order.
+    // Only the dimensions outside of the runs are walked element by element.
+    template <typename F>
+    void for_each_span(F fn) const
+    {
+        int n_dim = m_data_size.size();
+
+        if (!m_data || !n_dim)
+            return;
+
         for (int d = 0; d < n_dim; ++d)
         {
-            if (m_region_size[d] < 2)
+            if (m_region_size[d] < 1)
+                return;
+        }
+
+        const auto & data_stride = m_data_stride;
+
+        array_span<T> span;
+        span.size = 1;
+        span.stride = 1;
+        span.index = index_of(m_region_offset);
+        span.location = m_region_offset;
+
+        // Merge inner dimensions into a single run,
+        // as long as the distance between elements stays constant.
+        // Dimensions of size 1 do not break the run.
+
+        int d = n_dim - 1;
+
+        while(d >= 0 && m_region_size[d] == 1)
+            --d;
+
+        if (d >= 0)
+        {
+            span.size = m_region_size[d];
+            span.stride = data_stride[d];
+            --d;
+        }
+
+        for(; d >= 0; --d)
+        {
+            if (m_region_size[d] == 1)
                 continue;
+            if (data_stride[d] != span.stride * span.size)
+                break;
+            span.size *= m_region_size[d];
+        }
+
+        // Remaining dimensions are walked one span at a time.
 
-            it_size.push_back(m_region_size[d]);
-            it_stride.push_back(flat_strides[d]);
+        vector<int> outer_dims;
+        for(; d >= 0; --d)
+        {
+            if (m_region_size[d] > 1)
+                outer_dims.push_back(d);
         }
 
-        return iterator(m_data,
-                        it_size,
-                        it_stride,
-                        flat_index(m_region_offset, m_data_size));
-#endif
+        int64_t start_index = span.index;
+
+        while(true)
+        {
+            span.data = m_data + span.index;
+
+            fn(const_cast<const array_span<T>&>(span));
+
+            unsigned i;
+            for (i = 0; i < outer_dims.size(); ++i)
+            {
+                int od = outer_dims[i];
+                auto & loc = span.location[od];
+                ++loc;
+                if (loc < m_region_offset[od] + m_region_size[od])
+                    break;
+                loc = m_region_offset[od];
+            }
+
+            if (i == outer_dims.size())
+                break;
+
+            span.index = start_index;
+            for (int od : outer_dims)
+                span.index += (span.location[od] - m_region_offset[od]) * data_stride[od];
+        }
     }
 
-    iterator end()
+    vector<array_span<T>> spans() const
     {
-        return iterator();
+        vector<array_span<T>> result;
+        for_each_span([&](const array_span<T> & span){ result.push_back(span); });
+        return result;
     }
 };
 
 template<typename T>
 inline
 array_region<T>
-get_region(array<T> & array, const vector<int> & offset, const vector<int> & size)
+get_region(array<T> & array, const vector<int64_t> & offset, const vector<int64_t> & size)
 {
     return array_region<T>(array, offset, size);
 }
@@ -294,7 +513,14 @@ inline
 array_region<T>
 get_all(array<T> & array)
 {
-    return array_region<T>(array, vector<int>(array.size().size(), 0), array.size());
+    return array_region<T>(array, vector<int64_t>(array.size().size(), 0), array.size());
+}
+
+template<typename T, typename F>
+inline
+void for_each_span(const array_region<T> & region, F fn)
+{
+    region.for_each_span(fn);
 }
 
 }
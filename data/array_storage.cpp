@@ -0,0 +1,61 @@
+#include "array_storage.hpp"
+#include "../utility/error.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+namespace datavis {
+
+mapped_file_storage::mapped_file_storage(const std::string & path, std::int64_t offset, std::size_t byte_size):
+    m_byte_size(byte_size)
+{
+    if (offset < 0)
+        throw Error("Invalid offset into file: " + path);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw Error("Failed to open file " + path + ": " + std::strerror(errno));
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0 || file_stat.st_size < offset + (std::int64_t) byte_size)
+    {
+        ::close(fd);
+        throw Error("File is too small: " + path);
+    }
+
+    if (byte_size == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    // The mapping must start at a multiple of the page size.
+    std::int64_t page_size = ::sysconf(_SC_PAGESIZE);
+    std::int64_t mapping_offset = offset - offset % page_size;
+
+    m_data_offset = offset - mapping_offset;
+    m_mapping_size = m_data_offset + byte_size;
+
+    void * mapping = ::mmap(nullptr, m_mapping_size, PROT_READ, MAP_PRIVATE,
+                            fd, mapping_offset);
+
+    // The mapping remains valid after the file is closed.
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+        throw Error("Failed to map file " + path + ": " + std::strerror(errno));
+
+    m_mapping = mapping;
+}
+
+mapped_file_storage::~mapped_file_storage()
+{
+    if (m_mapping)
+        ::munmap(m_mapping, m_mapping_size);
+}
+
+}
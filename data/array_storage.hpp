@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+namespace datavis {
+
+// Owner of the memory holding the elements of an array.
+
+class array_storage
+{
+public:
+    virtual ~array_storage() {}
+
+    // Address of the first element.
+    virtual void * data() = 0;
+
+    // Number of bytes available from data().
+    virtual std::size_t byte_size() const = 0;
+
+    // Whether the elements must not be changed.
+    virtual bool is_read_only() const { return false; }
+};
+
+// Elements allocated on the heap.
+
+template <typename T>
+class heap_storage : public array_storage
+{
+public:
+    heap_storage(std::size_t count): m_elements(count) {}
+
+    void * data() override { return m_elements.data(); }
+
+    std::size_t byte_size() const override { return m_elements.size() * sizeof(T); }
+
+private:
+    std::vector<T> m_elements;
+};
+
+// A buffer allocated elsewhere.
+// The deleter, if any, is called with the buffer when the storage is destroyed.
+
+class external_storage : public array_storage
+{
+public:
+    using deleter_type = std::function<void(void*)>;
+
+    external_storage(void * data, std::size_t byte_size, deleter_type deleter = deleter_type()):
+        m_data(data),
+        m_byte_size(byte_size),
+        m_deleter(deleter)
+    {}
+
+    ~external_storage()
+    {
+        if (m_deleter)
+            m_deleter(m_data);
+    }
+
+    void * data() override { return m_data; }
+
+    std::size_t byte_size() const override { return m_byte_size; }
+
+private:
+    void * m_data;
+    std::size_t m_byte_size;
+    deleter_type m_deleter;
+};
+
+// A part of a file mapped into memory.
+// The mapping is read-only: Writing to it crashes.
+// Pages are only read from the file when accessed.
+// Throws Error if the file can not be mapped.
+
+class mapped_file_storage : public array_storage
+{
+public:
+    mapped_file_storage(const std::string & path, std::int64_t offset, std::size_t byte_size);
+    ~mapped_file_storage();
+
+    mapped_file_storage(const mapped_file_storage &) = delete;
+    mapped_file_storage & operator=(const mapped_file_storage &) = delete;
+
+    void * data() override { return (char*) m_mapping + m_data_offset; }
+
+    std::size_t byte_size() const override { return m_byte_size; }
+
+    bool is_read_only() const override { return true; }
+
+private:
+    void * m_mapping = nullptr;
+    std::size_t m_mapping_size = 0;
+    std::size_t m_data_offset = 0;
+    std::size_t m_byte_size = 0;
+};
+
+}
@@ -4,14 +4,40 @@
 #include "../io/sndfile.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 
 #include <QFileInfo>
+#include <QTimer>
 
 namespace datavis {
 
+static size_t memory_budget()
+{
+    size_t megabytes = 2048;
+
+    if (const char * value = std::getenv("DATAVIS_MEMORY_BUDGET_MB"))
+    {
+        char * end = nullptr;
+        auto parsed = std::strtoull(value, &end, 10);
+        if (end != value && parsed > 0)
+            megabytes = parsed;
+        else
+            cerr << "Invalid DATAVIS_MEMORY_BUDGET_MB: " << value << endl;
+    }
+
+    return megabytes << 20;
+}
+
 DataLibrary::DataLibrary(QObject * parent):
-    QObject(parent)
-{}
+    QObject(parent),
+    m_datasets(memory_budget())
+{
+    // Data sets are also released by plots,
+    // so check the budget now and then.
+    auto trim_timer = new QTimer(this);
+    connect(trim_timer, &QTimer::timeout, this, [this](){ m_datasets.trim(); });
+    trim_timer->start(5000);
+}
 
 void DataLibrary::open(const QString & path)
 {
@@ -71,6 +97,8 @@ void DataLibrary::close(DataSource * source)
     if (pos == m_sources.end())
         return;
 
+    m_datasets.remove(source);
+
     delete *pos;
 
     m_sources.erase(pos);
@@ -83,7 +111,10 @@ void DataLibrary::close(DataSource * source)
 void DataLibrary::closeAll()
 {
     for(DataSource * source : m_sources)
+    {
+        m_datasets.remove(source);
         delete source;
+    }
 
     m_sources.clear();
 
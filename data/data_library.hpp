@@ -9,6 +9,7 @@
 #include <QString>
 
 #include "dimension.hpp"
+#include "dataset_cache.hpp"
 
 namespace datavis {
 
@@ -34,6 +35,11 @@ public:
     DimensionPtr dimension(const string & name);
     const Dimensions & dimensions() const { return d_dimensions; }
 
+    // Data sets loaded by sources, kept within a memory budget.
+    // The budget defaults to 2 GB, or to the number of megabytes in
+    // the environment variable DATAVIS_MEMORY_BUDGET_MB.
+    dataset_cache & datasetCache() { return m_datasets; }
+
 signals:
     void sourcesChanged();
     void openFailed(const QString & path, const QString & reason = QString());
@@ -43,6 +49,7 @@ private:
 
     vector<DataSource*> m_sources;
     unordered_map<string, DimensionPtr> d_dimensions;
+    dataset_cache m_datasets;
 };
 
 }
@@ -1,9 +1,291 @@
 #include "data_set.hpp"
+#include "expression.hpp"
+#include "parallel.hpp"
+#include "../utility/threads.hpp"
+#include "../reactive/task_graph.hpp"
+#include "../reactive/trace.hpp"
+
+#include <cctype>
 
 namespace datavis {
 
+// Maximum number of cached statistics per data set.
+static const size_t max_statistics_count = 32;
+
+// Number of elements processed between checks for cancellation.
+static const int64_t cancellation_block_size = 1 << 20;
+
+// Preferred number of elements in a tile of computed data.
+static const int64_t computed_tile_element_count = 1 << 16;
+
+// Computes tiles of an attribute by evaluating an expression
+// over regions of another data set.
+class ExpressionTileSource : public tile_source<double>
+{
+public:
+    ExpressionTileSource(DataSetPtr data_set, const expression & expr):
+        m_data_set(data_set),
+        m_expression(expr)
+    {}
+
+    void read(const vector<int64_t> & offset, const vector<int64_t> & size, double * buffer) override
+    {
+        int attribute_count = m_data_set->attributeCount();
+        int n_dim = size.size();
+        int64_t count = flat_size(size);
+
+        vector<array<double>> attributes(attribute_count);
+        vector<vector<double>> coordinates(n_dim);
+        vector<const double*> inputs(attribute_count + n_dim, nullptr);
+
+        for (int v : m_expression.used_variables())
+        {
+            if (v < attribute_count)
+            {
+                attributes[v] = m_data_set->readRegion(v, offset, size);
+                inputs[v] = attributes[v].data();
+            }
+            else
+            {
+                int d = v - attribute_count;
+                coordinates[d] = this->coordinates(d, offset, size);
+                inputs[v] = coordinates[d].data();
+            }
+        }
+
+        m_expression.evaluate(inputs, count, buffer);
+    }
+
+private:
+    // Coordinates along dimension d of elements in a region.
+    vector<double> coordinates(int d, const vector<int64_t> & offset, const vector<int64_t> & size)
+    {
+        auto map = m_data_set->dimension(d).map;
+        auto strides = row_major_strides(size);
+        int64_t count = flat_size(size);
+
+        vector<double> result(count);
+
+        // The pattern of coordinates within one period repeats.
+
+        int64_t period = strides[d] * size[d];
+
+        for (int64_t i = 0; i < size[d]; ++i)
+        {
+            auto first = result.begin() + i * strides[d];
+            std::fill(first, first + strides[d], map * (offset[d] + i));
+        }
 
-void DataSet::selectIndex(int dim, int index)
+        for (int64_t start = period; start < count; start += period)
+            std::copy(result.begin(), result.begin() + period, result.begin() + start);
+
+        return result;
+    }
+
+    DataSetPtr m_data_set;
+    expression m_expression;
+};
+
+static bool isIdentifier(const string & name)
+{
+    if (name.empty() || !(std::isalpha(name[0]) || name[0] == '_'))
+        return false;
+
+    for (char c : name)
+    {
+        if (!(std::isalnum(c) || c == '_'))
+            return false;
+    }
+
+    return true;
+}
+
+
+DataSet::DataSet(const string & id, std::shared_ptr<DataSet> parent, const vector<ViewDimension> & dimensions):
+    m_source(parent->m_source),
+    m_id(id),
+    m_parent(parent),
+    m_attributes(parent->m_attributes)
+{
+    if (parent->isTiled())
+        throw std::invalid_argument("Can not make a view of tiled data.");
+
+    int n_dim = parent->dimensionCount();
+
+    if ((int) dimensions.size() != n_dim)
+        throw std::invalid_argument("View must use each dimension once.");
+
+    vector<bool> used(n_dim, false);
+    vector<int64_t> first(n_dim, 0);
+
+    for (auto & view_dim : dimensions)
+    {
+        int d = view_dim.dimension;
+        if (d < 0 || d >= n_dim || used[d])
+            throw std::invalid_argument("View must use each dimension once.");
+        used[d] = true;
+
+        int64_t last = view_dim.offset + (view_dim.size - 1) * view_dim.stride;
+        int64_t parent_size = parent->m_size[d];
+        if (view_dim.size < 1 || view_dim.offset < 0 || view_dim.offset >= parent_size ||
+                last < 0 || last >= parent_size)
+            throw std::invalid_argument("View dimension exceeds data.");
+
+        first[d] = view_dim.offset;
+    }
+
+    int attribute_count = parent->attributeCount();
+
+    // Strides and data of the parent, which may be a view itself.
+
+    vector<int64_t> parent_strides;
+    vector<double*> parent_data;
+
+    if (parent->isView())
+    {
+        parent_strides = parent->m_view_strides;
+        parent_data = parent->m_view_data;
+    }
+    else
+    {
+        parent_strides = row_major_strides(parent->m_size);
+        for (auto & a : parent->m_data)
+            parent_data.push_back(a.data());
+    }
+
+    int64_t first_index = 0;
+    for (int d = 0; d < n_dim; ++d)
+        first_index += first[d] * parent_strides[d];
+
+    for (int a = 0; a < attribute_count; ++a)
+        m_view_data.push_back(parent_data[a] + first_index);
+
+    for (auto & view_dim : dimensions)
+    {
+        const auto & parent_dim = parent->m_dimensions[view_dim.dimension];
+
+        m_size.push_back(view_dim.size);
+        m_view_strides.push_back(view_dim.stride * parent_strides[view_dim.dimension]);
+
+        Dimension dim;
+        dim.name = parent_dim.name;
+        dim.size = view_dim.size;
+        dim.map.offset = parent_dim.map * view_dim.offset;
+        dim.map.scale = parent_dim.map.scale * view_dim.stride;
+        m_dimensions.push_back(dim);
+    }
+
+    m_global_dimensions.resize(n_dim + attribute_count);
+    m_selection.resize(n_dim, 0);
+}
+
+DataSet::~DataSet()
+{
+    memo_cache::global().remove(m_cache_id);
+}
+
+size_t DataSet::memorySize() const
+{
+    size_t bytes = 0;
+    for (auto & attribute_data : m_data)
+        bytes += flat_size(attribute_data.size()) * sizeof(double);
+    return bytes;
+}
+
+DataSetPtr DataSet::view(const string & id, const vector<ViewDimension> & dimensions)
+{
+    return std::make_shared<DataSet>(id, shared_from_this(), dimensions);
+}
+
+DataSetPtr DataSet::computed(const string & id, const string & text)
+{
+    int attribute_count = attributeCount();
+    int n_dim = dimensionCount();
+
+    // Names default to indices. Names given to attributes and dimensions
+    // are added if they are valid identifiers and not taken.
+
+    expression::variable_map variables;
+
+    for (int a = 0; a < attribute_count; ++a)
+        variables["a" + std::to_string(a)] = a;
+
+    for (int d = 0; d < n_dim; ++d)
+        variables["d" + std::to_string(d)] = attribute_count + d;
+
+    for (int a = 0; a < attribute_count; ++a)
+    {
+        auto & name = m_attributes[a].name;
+        if (isIdentifier(name))
+            variables.emplace(name, a);
+    }
+
+    for (int d = 0; d < n_dim; ++d)
+    {
+        auto & name = m_dimensions[d].name;
+        if (isIdentifier(name))
+            variables.emplace(name, attribute_count + d);
+    }
+
+    expression expr(text, variables);
+
+    // Prefer tiles spanning entire inner dimensions.
+
+    vector<int64_t> tile_size = m_size;
+    {
+        int64_t inner_count = 1;
+        for (int d = n_dim - 1; d >= 0; --d)
+        {
+            int64_t max_size = std::max(int64_t(1), computed_tile_element_count / inner_count);
+            tile_size[d] = std::min(tile_size[d], max_size);
+            inner_count *= tile_size[d];
+        }
+    }
+
+    auto source = std::make_shared<ExpressionTileSource>(shared_from_this(), expr);
+    auto data = std::make_shared<tiled_array<double>>(m_size, tile_size, source);
+
+    // Computing a tile reads tiles of this data set, which may be prefetched
+    // on the IO pool, so computed tiles must not occupy the IO pool themselves.
+    data->set_prefetch_count(0);
+
+    vector<std::shared_ptr<tiled_array<double>>> attributes { data };
+
+    auto result = std::make_shared<DataSet>(id, std::move(attributes));
+    result->setSource(m_source);
+    for (int d = 0; d < n_dim; ++d)
+        result->setDimension(d, m_dimensions[d]);
+    result->attribute(0).name = text;
+
+    return result;
+}
+
+array_region<double> DataSet::region(int attribute, const vector<int64_t> & offset, const vector<int64_t> & size)
+{
+    if (isView())
+        return array_region<double>(m_view_data[attribute], m_size, m_view_strides, offset, size);
+
+    if (isTiled())
+        return array_region<double>();
+
+    return get_region(m_data[attribute], offset, size);
+}
+
+array_region<double> DataSet::region(int attribute)
+{
+    return region(attribute, vector<int64_t>(m_size.size(), 0), m_size);
+}
+
+double DataSet::value(int attribute, const vector<int64_t> & index)
+{
+    if (isTiled())
+        return m_tiled_data[attribute]->read(index, vector<int64_t>(index.size(), 1)).data()[0];
+
+    auto r = region(attribute);
+    return r.data()[r.index_of(index)];
+}
+
+void DataSet::selectIndex(int dim, int64_t index)
 {
     if (m_selection[dim] != index)
     {
@@ -12,7 +294,7 @@ void DataSet::selectIndex(int dim, int index)
     }
 }
 
-void DataSet::selectIndex(const vector<int> & index)
+void DataSet::selectIndex(const vector<int64_t> & index)
 {
 #if 0
     cout << "DataSet: selecting index: ";
@@ -37,6 +319,278 @@ void DataSet::selectIndex(const vector<int> & index)
         emit selectionChanged();
 }
 
+array<double> DataSet::readRegion(int attribute, const vector<int64_t> & offset, const vector<int64_t> & size)
+{
+    if (isTiled())
+        return m_tiled_data[attribute]->read(offset, size);
+
+    array<double> result(size);
+    double * dest = result.data();
+
+    for_each_span(region(attribute, offset, size), [&](const array_span<double> & span)
+    {
+        for (int64_t i = 0; i < span.size; ++i)
+            *dest++ = span.data[i * span.stride];
+    });
+
+    return result;
+}
+
+DataSet::StatisticsKey DataSet::statisticsKey(int attribute, const vector<int64_t> & offset,
+                                              const vector<int64_t> & size, int histogram_bins) const
+{
+    StatisticsKey key;
+    key.attribute = attribute;
+    key.offset = offset.empty() ? vector<int64_t>(m_size.size(), 0) : offset;
+    key.size = size.empty() ? m_size : size;
+    key.histogram_bins = std::max(0, histogram_bins);
+    return key;
+}
+
+DataSet::StatisticsEntryPtr DataSet::statisticsEntry(const StatisticsKey & key)
+{
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+
+    for (auto it = m_statistics.begin(); it != m_statistics.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            m_statistics.splice(m_statistics.begin(), m_statistics, it);
+            return it->second;
+        }
+    }
+
+    auto entry = std::make_shared<StatisticsEntry>();
+    m_statistics.emplace_front(key, entry);
+
+    if (m_statistics.size() > max_statistics_count)
+        m_statistics.pop_back();
+
+    return entry;
+}
+
+value_statistics DataSet::statistics(int attribute, const vector<int64_t> & offset,
+                                     const vector<int64_t> & size, int histogram_bins)
+{
+    auto key = statisticsKey(attribute, offset, size, histogram_bins);
+    auto entry = statisticsEntry(key);
+    return statistics(key, *entry);
+}
+
+value_statistics DataSet::statistics(const StatisticsKey & key, StatisticsEntry & entry,
+                                     const Reactive::Status * status)
+{
+    while (true)
+    {
+        if (entry.ready)
+            return entry.value;
+
+        std::promise<value_statistics> promise;
+        std::shared_future<value_statistics> pending;
+
+        {
+            std::lock_guard<std::mutex> lock(m_statistics_mutex);
+
+            if (entry.ready)
+                return entry.value;
+
+            if (entry.computing.valid())
+                pending = entry.computing;
+            else
+                entry.computing = promise.get_future().share();
+        }
+
+        if (pending.valid())
+        {
+            // Computed by another request.
+            // Compute again if it failed or was cancelled.
+            try
+            {
+                return pending.get();
+            }
+            catch (...)
+            {
+                if (status)
+                    status->check();
+                continue;
+            }
+        }
+
+        value_statistics value;
+
+        try
+        {
+            value = computeStatistics(key, status);
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_statistics_mutex);
+                entry.computing = std::shared_future<value_statistics>();
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_statistics_mutex);
+            entry.value = value;
+            entry.ready = true;
+            entry.computing = std::shared_future<value_statistics>();
+        }
+        promise.set_value(value);
+
+        return value;
+    }
+}
+
+Reactive::Value<value_statistics> DataSet::statisticsValue(int attribute, const vector<int64_t> & offset,
+                                                           const vector<int64_t> & size, int histogram_bins)
+{
+    auto key = statisticsKey(attribute, offset, size, histogram_bins);
+    auto entry = statisticsEntry(key);
+
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+
+    if (!entry->future)
+    {
+        if (entry->ready)
+        {
+            entry->future = Reactive::value(entry->value);
+        }
+        else
+        {
+            // The entry owns the future, so only refer to it weakly.
+            std::weak_ptr<DataSet> weak_this = shared_from_this();
+            std::weak_ptr<StatisticsEntry> weak_entry = entry;
+
+            entry->future = Reactive::apply(compute_pool(),
+            [weak_this, weak_entry, key](Reactive::Status & status) -> value_statistics
+            {
+                auto dataset = weak_this.lock();
+                auto entry = weak_entry.lock();
+                if (!dataset || !entry)
+                    return value_statistics();
+
+                try
+                {
+                    return dataset->statistics(key, *entry, &status);
+                }
+                catch (...)
+                {
+                    // The future never becomes ready, so let the next request
+                    // compute the statistics again. Released after unlocking.
+                    Reactive::Value<value_statistics> failed;
+                    {
+                        std::lock_guard<std::mutex> lock(dataset->m_statistics_mutex);
+                        failed.swap(entry->future);
+                    }
+                    throw;
+                }
+            });
+        }
+    }
+
+    return entry->future;
+}
+
+value_statistics DataSet::computeStatistics(const StatisticsKey & key, const Reactive::Status * status)
+{
+    // Only checks for cancellation, without yielding to more urgent work,
+    // because other requests for the same statistics wait meanwhile,
+    // and that work may be one of them.
+    auto check = [&]()
+    {
+        if (status)
+            status->check();
+    };
+
+    value_statistics result;
+
+    if (key.attribute < 0 || key.attribute >= attributeCount())
+        return result;
+
+    Reactive::Trace_Span span("Statistics", "compute");
+    span.set_bytes(flat_size(key.size) * int64_t(sizeof(double)));
+
+    if (isTiled())
+    {
+        auto & data = *m_tiled_data[key.attribute];
+
+        data.for_each_block(key.offset, key.size,
+                            [&](const array_region<double> & block, const vector<int64_t> &)
+        {
+            check();
+            result = merge(result, datavis::statistics(block));
+        });
+
+        if (key.histogram_bins > 0 && !result.extent.is_empty())
+        {
+            data.for_each_block(key.offset, key.size,
+                                [&](const array_region<double> & block, const vector<int64_t> &)
+            {
+                check();
+                value_statistics part;
+                part.histogram = histogram(block, result.extent.min, result.extent.max, key.histogram_bins);
+                result = merge(result, part);
+            });
+        }
+    }
+    else
+    {
+        // Statistics of blocks in parallel, then histograms of blocks
+        // once the extent of all blocks is known.
+        // Parts are merged in order, so the result does not depend
+        // on the order in which blocks are done.
+
+        auto blocks = split_region(region(key.attribute, key.offset, key.size), cancellation_block_size);
+
+        using Part = Reactive::Task_Graph::Task<value_statistics>;
+
+        Reactive::Task_Graph graph;
+
+        vector<Part> parts;
+        for (auto & block : blocks)
+        {
+            parts.push_back(graph.add([&block]{ return datavis::statistics(block); }));
+        }
+
+        auto total = graph.add([&parts]
+        {
+            value_statistics total;
+            for (auto & part : parts)
+                total = merge(total, part.take());
+            return total;
+        },
+        parts);
+
+        vector<Part> histograms;
+        if (key.histogram_bins > 0)
+        {
+            for (auto & block : blocks)
+            {
+                histograms.push_back(graph.add([&block, &key, total]
+                {
+                    value_statistics part;
+                    auto & extent = total.get().extent;
+                    if (!extent.is_empty())
+                        part.histogram = histogram(block, extent.min, extent.max, key.histogram_bins);
+                    return part;
+                },
+                { total }));
+            }
+        }
+
+        graph.run(compute_pool(), status);
+
+        result = total.take();
+        for (auto & part : histograms)
+            result = merge(result, part.take());
+    }
+
+    return result;
+}
+
 void DataSet::setGlobalDimension(int idx, const DimensionPtr & dim)
 {
     auto & my_dim = m_global_dimensions[idx];
@@ -61,7 +615,7 @@ void DataSet::onDimensionFocusChanged()
 
         double focus = gdim->focus();
 
-        int index = std::round(focus / m_dimensions[d].map);
+        int64_t index = std::llround(focus / m_dimensions[d].map);
         if (index < 0 || index >= m_dimensions[d].size)
             continue;
 
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "array.hpp"
+#include "tiled_array.hpp"
+#include "reduction.hpp"
 #include "math.hpp"
 #include "dimension.hpp"
+#include "memo_cache.hpp"
+#include "../reactive/value.hpp"
 
 #include <string>
 #include <memory>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <list>
 #include <QObject>
 #include <cmath>
 
@@ -15,7 +23,7 @@ using std::string;
 
 class DataSource;
 
-class DataSet : public QObject
+class DataSet : public QObject, public std::enable_shared_from_this<DataSet>
 {
     Q_OBJECT
 
@@ -35,12 +43,26 @@ public:
         string name;
     };
 
-    DataSet(const vector<int> & size):
+    // A dimension of a view, see view().
+    struct ViewDimension
+    {
+        // Dimension of the viewed data set
+        int dimension = 0;
+        // First element
+        int64_t offset = 0;
+        // Distance between elements, may be negative
+        int64_t stride = 1;
+        // Number of elements
+        int64_t size = 0;
+    };
+
+    DataSet(const vector<int64_t> & size):
         DataSet(string(), size, 1)
     {}
 
-    DataSet(const string & id, const vector<int> & size, int attribute_count = 1):
+    DataSet(const string & id, const vector<int64_t> & size, int attribute_count = 1):
         m_id(id),
+        m_size(size),
         m_dimensions(size.size()),
         m_attributes(attribute_count),
         m_global_dimensions(size.size() + attribute_count),
@@ -51,27 +73,141 @@ public:
             m_data.emplace_back(size);
     }
 
-    DataSet(const string & id, const array<double> & data):
+    // Takes over the data of one attribute without copying.
+    DataSet(const string & id, array<double> && data):
         m_id(id),
+        m_size(data.size()),
         m_dimensions(data.size().size()),
         m_attributes(1),
         m_global_dimensions(data.size().size() + 1),
         m_selection(data.size().size(), 0)
     {
-        m_data.emplace_back(data);
+        m_data.push_back(std::move(data));
+    }
+
+    // Takes over the data of multiple attributes without copying.
+    // Throws std::invalid_argument unless all have the same size.
+    DataSet(const string & id, vector<array<double>> && data):
+        m_id(id),
+        m_data(std::move(data))
+    {
+        if (m_data.empty())
+            throw std::invalid_argument("No attribute data.");
+
+        auto size = m_data[0].size();
+        for (auto & attribute_data : m_data)
+        {
+            if (attribute_data.size() != size)
+                throw std::invalid_argument("Attribute data differ in size.");
+        }
+
+        m_size = size;
+        m_dimensions.resize(size.size());
+        m_attributes.resize(m_data.size());
+        m_global_dimensions.resize(size.size() + m_data.size());
+        m_selection.resize(size.size(), 0);
+    }
+
+    // Uses data of multiple attributes stored as tiles,
+    // which are loaded when accessed.
+    // Throws std::invalid_argument unless all have the same size.
+    DataSet(const string & id, vector<std::shared_ptr<tiled_array<double>>> && data):
+        m_id(id),
+        m_tiled_data(std::move(data))
+    {
+        if (m_tiled_data.empty())
+            throw std::invalid_argument("No attribute data.");
+
+        auto size = m_tiled_data[0]->size();
+        for (auto & attribute_data : m_tiled_data)
+        {
+            if (attribute_data->size() != size)
+                throw std::invalid_argument("Attribute data differ in size.");
+        }
+
+        m_size = size;
+        m_dimensions.resize(size.size());
+        m_attributes.resize(m_tiled_data.size());
+        m_global_dimensions.resize(size.size() + m_tiled_data.size());
+        m_selection.resize(size.size(), 0);
     }
 
+    // A view of parent's data. See view().
+    DataSet(const string & id, std::shared_ptr<DataSet> parent, const vector<ViewDimension> & dimensions);
+
+    ~DataSet();
+
     DataSource * source() { return m_source; }
     void setSource(DataSource * source) { m_source = source; }
 
     string id() const { return m_id; }
 
-    array<double> * data() { return & m_data[0]; }
-    const array<double> * data() const { return & m_data[0]; }
+    // Identifies this data set in caches, such as memo_cache.
+    // Unlike the address, never reused by another data set.
+    std::uint64_t cacheId() const { return m_cache_id; }
+
+    const vector<int64_t> & size() const { return m_size; }
+
+    // In-memory data of attributes owned by this data set.
+    // Not available for tiled data sets and views.
+
+    array<double> * data() { return m_data.empty() ? nullptr : & m_data[0]; }
+    const array<double> * data() const { return m_data.empty() ? nullptr : & m_data[0]; }
 
     array<double> & data(int idx) { return m_data[idx]; }
     const array<double> & data(int idx) const { return m_data[idx]; }
 
+    // A region of an attribute's data in memory.
+    // Available for data sets owning their data, and their views.
+    // Otherwise returns an invalid region.
+    array_region<double> region(int attribute, const vector<int64_t> & offset, const vector<int64_t> & size);
+
+    // The entire data of an attribute in memory, see region().
+    array_region<double> region(int attribute);
+
+    // The value of an attribute at index, loading tiles as needed.
+    double value(int attribute, const vector<int64_t> & index);
+
+    // A data set sharing the data of this one, without copying.
+    // Dimension d of the view covers elements
+    // offset + i * stride for i in [0, size) of this data set's
+    // dimension dimensions[d].dimension.
+    // Each dimension of this data set must be used exactly once,
+    // so dimensions can be permuted, but not dropped or added.
+    // The view keeps this data set alive.
+    // Requires the data set to be owned by a shared pointer.
+    // Throws std::invalid_argument for tiled data sets or invalid dimensions.
+    std::shared_ptr<DataSet> view(const string & id, const vector<ViewDimension> & dimensions);
+
+    bool isView() const { return m_parent != nullptr; }
+
+    // Bytes of attribute data owned by this data set in memory.
+    // Zero for views, and for tiled data, which is in tile_cache.
+    size_t memorySize() const;
+
+    // A data set with one attribute computed from this one's
+    // attributes and dimensions by an expression (see class expression).
+    // Attribute a is available as variable "a<a>", and the coordinate
+    // along dimension d as "d<d>". Attributes and dimensions can also be
+    // referred to by their names.
+    // The result is a tiled data set: Tiles are computed only when
+    // accessed, and cached like other tiles.
+    // The result keeps this data set alive.
+    // Requires the data set to be owned by a shared pointer.
+    // Throws Error if the expression is invalid.
+    std::shared_ptr<DataSet> computed(const string & id, const string & expression);
+
+    // Tiled data of attributes.
+    // Only available for tiled data sets.
+
+    bool isTiled() const { return !m_tiled_data.empty(); }
+
+    tiled_array<double> & tiledData(int idx) { return *m_tiled_data[idx]; }
+
+    // Copies a region of an attribute into a new array,
+    // loading tiles as needed.
+    array<double> readRegion(int attribute, const vector<int64_t> & offset, const vector<int64_t> & size);
+
     int dimensionCount() const { return m_dimensions.size(); }
     Dimension dimension(int idx) const { return m_dimensions[idx]; }
     void setDimension(int idx, const Dimension & dim) { m_dimensions[idx] = dim; }
@@ -84,15 +220,15 @@ public:
     DimensionPtr globalDimension(int idx) const { return m_global_dimensions[idx]; }
     void setGlobalDimension(int idx, const DimensionPtr & dim);
 
-    vector<int> indexForPoint(const vector<double> & point)
+    vector<int64_t> indexForPoint(const vector<double> & point)
     {
-        vector<int> index(point.size());
+        vector<int64_t> index(point.size());
         for (int d = 0; d < point.size(); ++d)
-            index[d] = std::round(point[d] / m_dimensions[d].map);
+            index[d] = std::llround(point[d] / m_dimensions[d].map);
         return index;
     }
 
-    vector<double> pointForIndex(const vector<int> & index)
+    vector<double> pointForIndex(const vector<int64_t> & index)
     {
         vector<double> point(index.size());
         for (int d = 0; d < index.size(); ++d)
@@ -100,12 +236,30 @@ public:
         return point;
     }
 
-    void selectIndex(int dim, int index);
-    void selectIndex(const vector<int> & index);
+    // Statistics of an attribute within a region,
+    // with a histogram if histogram_bins > 0.
+    // An empty offset and size mean the entire attribute.
+    // Results are cached, so each is computed only once,
+    // even when requested by multiple threads at the same time.
+    value_statistics statistics(int attribute,
+                                const vector<int64_t> & offset = vector<int64_t>(),
+                                const vector<int64_t> & size = vector<int64_t>(),
+                                int histogram_bins = 0);
+
+    // Same as statistics(), but computed in the background.
+    // All requests for the same statistics share the same value.
+    // Requires the DataSet to be owned by a shared pointer.
+    Reactive::Value<value_statistics> statisticsValue(int attribute,
+                                                      const vector<int64_t> & offset = vector<int64_t>(),
+                                                      const vector<int64_t> & size = vector<int64_t>(),
+                                                      int histogram_bins = 0);
 
-    int selectedIndex(int dim) const { return m_selection[dim]; }
+    void selectIndex(int dim, int64_t index);
+    void selectIndex(const vector<int64_t> & index);
 
-    vector<int> selectedIndex() const { return m_selection; }
+    int64_t selectedIndex(int dim) const { return m_selection[dim]; }
+
+    vector<int64_t> selectedIndex() const { return m_selection; }
 
     double selectedPoint(int dim) const
     {
@@ -126,15 +280,64 @@ signals:
     void selectionChanged();
 
 private:
+    struct StatisticsKey
+    {
+        int attribute;
+        vector<int64_t> offset;
+        vector<int64_t> size;
+        int histogram_bins;
+
+        bool operator==(const StatisticsKey & other) const
+        {
+            return attribute == other.attribute &&
+                    offset == other.offset &&
+                    size == other.size &&
+                    histogram_bins == other.histogram_bins;
+        }
+    };
+
+    struct StatisticsEntry
+    {
+        std::atomic<bool> ready { false };
+        value_statistics value;
+        // Of the computation in progress, which other requests wait for,
+        // so no lock is held while computing.
+        // Guarded by the statistics mutex, like the future.
+        std::shared_future<value_statistics> computing;
+        Reactive::Value<value_statistics> future;
+    };
+
+    using StatisticsEntryPtr = std::shared_ptr<StatisticsEntry>;
+
+    StatisticsKey statisticsKey(int attribute, const vector<int64_t> & offset,
+                                const vector<int64_t> & size, int histogram_bins) const;
+    StatisticsEntryPtr statisticsEntry(const StatisticsKey &);
+    value_statistics statistics(const StatisticsKey &, StatisticsEntry &,
+                                const Reactive::Status * = nullptr);
+    value_statistics computeStatistics(const StatisticsKey &, const Reactive::Status *);
+
     void onDimensionFocusChanged();
 
     DataSource * m_source = nullptr;
     string m_id;
+    std::uint64_t m_cache_id = memo_cache::new_source_id();
+    vector<int64_t> m_size;
     vector<array<double>> m_data;
+    vector<std::shared_ptr<tiled_array<double>>> m_tiled_data;
+
+    // Data of views
+    std::shared_ptr<DataSet> m_parent;
+    vector<double*> m_view_data;
+    vector<int64_t> m_view_strides;
+
     vector<Dimension> m_dimensions;
     vector<Attribute> m_attributes;
     vector<DimensionPtr> m_global_dimensions;
-    vector<int> m_selection;
+    vector<int64_t> m_selection;
+
+    // Most recently used first
+    std::mutex m_statistics_mutex;
+    std::list<std::pair<StatisticsKey, StatisticsEntryPtr>> m_statistics;
 
 };
 
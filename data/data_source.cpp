@@ -1,3 +1,11 @@
 #include "data_source.hpp"
+#include "data_library.hpp"
 
-// Just so Qt pre-processes the header.
+namespace datavis {
+
+dataset_cache * DataSource::datasetCache() const
+{
+    return d_lib ? &d_lib->datasetCache() : nullptr;
+}
+
+}
@@ -2,7 +2,7 @@
 
 #include "../data/array.hpp"
 #include "../data/data_set.hpp"
-#include "../reactive/reactive.hpp"
+#include "../reactive/value.hpp"
 
 #include <string>
 #include <memory>
@@ -15,6 +15,7 @@ using std::string;
 
 class DataLibrary;
 class DataSource;
+class dataset_cache;
 
 class DataSetInfo
 {
@@ -41,6 +42,10 @@ public:
     virtual DataSetInfo dataset_info(const string & id) const = 0;
     virtual FutureDataset dataset(const string & id) = 0;
 
+protected:
+    // Where loaded data sets are kept, or null without a library.
+    dataset_cache * datasetCache() const;
+
 private:
     DataLibrary * d_lib = nullptr;
 };
@@ -0,0 +1,192 @@
+#include "dataset_cache.hpp"
+
+namespace datavis {
+
+std::size_t dataset_cache::budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+void dataset_cache::set_budget(std::size_t bytes)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict(dropped);
+}
+
+std::size_t dataset_cache::used() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+std::size_t dataset_cache::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+FutureDataset dataset_cache::find(const DataSource * source, const std::string & id)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key(source, id));
+    if (it == m_entries.end())
+        return nullptr;
+
+    auto & e = it->second;
+
+    m_uses.splice(m_uses.begin(), m_uses, e.use);
+
+    FutureDataset dataset = e.dataset;
+
+    // Others may have stopped using data sets since the last check.
+    evict(dropped);
+
+    return dataset;
+}
+
+void dataset_cache::insert(const DataSource * source, const std::string & id, const FutureDataset & dataset)
+{
+    if (!dataset)
+        return;
+
+    key k(source, id);
+
+    {
+        dropped_list dropped;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(k);
+        if (it != m_entries.end())
+        {
+            m_used -= it->second.size;
+            m_uses.erase(it->second.use);
+            dropped.push_back(std::move(it->second.dataset));
+            m_entries.erase(it);
+        }
+
+        m_uses.push_front(k);
+
+        entry e;
+        e.dataset = dataset;
+        e.use = m_uses.begin();
+        m_entries.emplace(k, e);
+    }
+
+    std::weak_ptr<Reactive::Value_Data<DataSetPtr>> weak_dataset = dataset;
+
+    dataset->subscribe([this, k, weak_dataset]()
+    {
+        auto dataset = weak_dataset.lock();
+        if (dataset)
+            complete(k, dataset);
+    });
+}
+
+bool dataset_cache::contains(const DataSource * source, const std::string & id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.count(key(source, id)) > 0;
+}
+
+void dataset_cache::complete(const key & k, const FutureDataset & dataset)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(k);
+    if (it == m_entries.end())
+        return;
+
+    auto & e = it->second;
+
+    // The entry may have been replaced meanwhile.
+    if (e.loaded || e.dataset != dataset)
+        return;
+
+    e.loaded = true;
+    e.size = dataset->value ? dataset->value->memorySize() : 0;
+    m_used += e.size;
+
+    evict(dropped);
+}
+
+bool dataset_cache::in_use(const entry & e)
+{
+    if (e.dataset.use_count() > 1)
+        return true;
+
+    // Also used by plots holding only the data set,
+    // and views of it.
+    auto & dataset = e.dataset->value;
+    return dataset && dataset.use_count() > 1;
+}
+
+void dataset_cache::evict(dropped_list & dropped)
+{
+    auto it = m_uses.end();
+    while (m_used > m_budget && it != m_uses.begin())
+    {
+        --it;
+
+        auto e = m_entries.find(*it);
+
+        if (!e->second.loaded || in_use(e->second))
+            continue;
+
+        dropped.push_back(std::move(e->second.dataset));
+        m_used -= e->second.size;
+        m_entries.erase(e);
+        it = m_uses.erase(it);
+    }
+}
+
+void dataset_cache::trim()
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evict(dropped);
+}
+
+void dataset_cache::remove(const DataSource * source)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if (it->first.first == source)
+        {
+            dropped.push_back(std::move(it->second.dataset));
+            m_used -= it->second.size;
+            m_uses.erase(it->second.use);
+            it = m_entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void dataset_cache::clear()
+{
+    entry_map entries;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entries.swap(m_entries);
+    m_uses.clear();
+    m_used = 0;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "data_source.hpp"
+
+#include <memory>
+#include <mutex>
+#include <list>
+#include <string>
+#include <map>
+#include <utility>
+#include <cstddef>
+
+namespace datavis {
+
+// Keeps data sets loaded by data sources in memory,
+// within a budget for the total size of their data.
+//
+// When the budget is exceeded, the least recently used data sets
+// that are not in use are dropped. A data set is in use while
+// anything besides the cache refers to it or to its future,
+// for example a plot showing it, or a view of it.
+// Sources load dropped data sets again when they are requested.
+// Data sets being loaded are always kept.
+
+class dataset_cache
+{
+public:
+    dataset_cache(std::size_t budget): m_budget(budget) {}
+
+    std::size_t budget() const;
+    void set_budget(std::size_t bytes);
+
+    // Total size of loaded data sets in the cache.
+    std::size_t used() const;
+
+    // Number of cached data sets, including those being loaded.
+    std::size_t count() const;
+
+    // The cached data set of the source with the id, or null.
+    FutureDataset find(const DataSource *, const std::string & id);
+
+    // Caches the data set of the source with the id.
+    // Its size is accounted for once loaded.
+    // The cache must outlive the future.
+    void insert(const DataSource *, const std::string & id, const FutureDataset &);
+
+    // Whether the data set of the source with the id is cached.
+    bool contains(const DataSource *, const std::string & id) const;
+
+    // Drops all data sets of a source.
+    void remove(const DataSource *);
+
+    // Drops data sets no longer in use, if over budget.
+    void trim();
+
+    void clear();
+
+private:
+    using key = std::pair<const DataSource*, std::string>;
+
+    struct entry
+    {
+        FutureDataset dataset;
+        std::size_t size = 0;
+        bool loaded = false;
+        std::list<key>::iterator use;
+    };
+
+    using entry_map = std::map<key, entry>;
+
+    // Data sets dropped while the mutex is held, released after.
+    // Releasing a data set may run arbitrary destructors.
+    using dropped_list = std::vector<FutureDataset>;
+
+    void complete(const key &, const FutureDataset &);
+    void evict(dropped_list &);
+    static bool in_use(const entry &);
+
+    mutable std::mutex m_mutex;
+    std::size_t m_budget;
+    std::size_t m_used = 0;
+    entry_map m_entries;
+    // Most recently used first
+    std::list<key> m_uses;
+};
+
+}
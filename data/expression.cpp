@@ -0,0 +1,458 @@
+#include "expression.hpp"
+#include "../utility/error.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace datavis {
+
+// Number of elements processed by each instruction at once.
+static const int64_t block_size = 256;
+
+static int arity(expression::opcode op)
+{
+    switch(op)
+    {
+    case expression::op_constant:
+    case expression::op_variable:
+        return 0;
+    case expression::op_add:
+    case expression::op_subtract:
+    case expression::op_multiply:
+    case expression::op_divide:
+    case expression::op_power:
+    case expression::op_atan2:
+    case expression::op_min:
+    case expression::op_max:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+static double apply(expression::opcode op, double a, double b = 0)
+{
+    switch(op)
+    {
+    case expression::op_negate: return -a;
+    case expression::op_add: return a + b;
+    case expression::op_subtract: return a - b;
+    case expression::op_multiply: return a * b;
+    case expression::op_divide: return a / b;
+    case expression::op_power: return std::pow(a, b);
+    case expression::op_abs: return std::abs(a);
+    case expression::op_sqrt: return std::sqrt(a);
+    case expression::op_exp: return std::exp(a);
+    case expression::op_log: return std::log(a);
+    case expression::op_log10: return std::log10(a);
+    case expression::op_sin: return std::sin(a);
+    case expression::op_cos: return std::cos(a);
+    case expression::op_tan: return std::tan(a);
+    case expression::op_atan: return std::atan(a);
+    case expression::op_floor: return std::floor(a);
+    case expression::op_ceil: return std::ceil(a);
+    case expression::op_atan2: return std::atan2(a, b);
+    case expression::op_min: return std::min(a, b);
+    case expression::op_max: return std::max(a, b);
+    default: return 0;
+    }
+}
+
+class expression::parser
+{
+public:
+    parser(expression & e, const variable_map & variables):
+        m_expr(e),
+        m_text(e.m_text),
+        m_variables(variables)
+    {}
+
+    void parse()
+    {
+        parse_sum();
+        skip_space();
+        if (m_pos < m_text.size())
+            fail("Unexpected character");
+    }
+
+private:
+    void parse_sum()
+    {
+        parse_product();
+        while (true)
+        {
+            if (accept('+'))
+            {
+                parse_product();
+                emit(op_add);
+            }
+            else if (accept('-'))
+            {
+                parse_product();
+                emit(op_subtract);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    void parse_product()
+    {
+        parse_unary();
+        while (true)
+        {
+            if (accept('*'))
+            {
+                parse_unary();
+                emit(op_multiply);
+            }
+            else if (accept('/'))
+            {
+                parse_unary();
+                emit(op_divide);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    void parse_unary()
+    {
+        if (accept('-'))
+        {
+            parse_unary();
+            emit(op_negate);
+        }
+        else if (accept('+'))
+        {
+            parse_unary();
+        }
+        else
+        {
+            parse_power();
+        }
+    }
+
+    void parse_power()
+    {
+        parse_primary();
+        // Right associative, binds tighter than unary minus on the left:
+        // -a^b = -(a^b)
+        if (accept('^'))
+        {
+            parse_unary();
+            emit(op_power);
+        }
+    }
+
+    void parse_primary()
+    {
+        skip_space();
+
+        if (m_pos >= m_text.size())
+            fail("Unexpected end of expression");
+
+        char c = m_text[m_pos];
+
+        if (accept('('))
+        {
+            parse_sum();
+            expect(')');
+        }
+        else if (std::isdigit(c) || c == '.')
+        {
+            parse_number();
+        }
+        else if (std::isalpha(c) || c == '_')
+        {
+            auto start = m_pos;
+            auto name = parse_name();
+            if (accept('('))
+                parse_call(name, start);
+            else
+                parse_variable(name, start);
+        }
+        else
+        {
+            fail("Unexpected character");
+        }
+    }
+
+    void parse_number()
+    {
+        const char * start = m_text.c_str() + m_pos;
+        char * end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start)
+            fail("Invalid number");
+        m_pos += end - start;
+        emit_constant(value);
+    }
+
+    string parse_name()
+    {
+        auto start = m_pos;
+        while (m_pos < m_text.size() && (std::isalnum(m_text[m_pos]) || m_text[m_pos] == '_'))
+            ++m_pos;
+        return m_text.substr(start, m_pos - start);
+    }
+
+    void parse_variable(const string & name, size_t position)
+    {
+        auto it = m_variables.find(name);
+        if (it == m_variables.end())
+            fail("Unknown variable '" + name + "'", position);
+
+        int v = it->second;
+
+        emit_instruction({ op_variable, v });
+
+        auto & used = m_expr.m_used_variables;
+        auto pos = std::lower_bound(used.begin(), used.end(), v);
+        if (pos == used.end() || *pos != v)
+            used.insert(pos, v);
+    }
+
+    void parse_call(const string & name, size_t position)
+    {
+        static const std::map<string, opcode> functions =
+        {
+            { "abs", op_abs },
+            { "sqrt", op_sqrt },
+            { "exp", op_exp },
+            { "log", op_log },
+            { "log10", op_log10 },
+            { "sin", op_sin },
+            { "cos", op_cos },
+            { "tan", op_tan },
+            { "atan", op_atan },
+            { "floor", op_floor },
+            { "ceil", op_ceil },
+            { "atan2", op_atan2 },
+            { "pow", op_power },
+            { "min", op_min },
+            { "max", op_max },
+        };
+
+        auto it = functions.find(name);
+        if (it == functions.end())
+            fail("Unknown function '" + name + "'", position);
+
+        auto op = it->second;
+
+        int arg_count = 0;
+        if (!accept(')'))
+        {
+            do
+            {
+                parse_sum();
+                ++arg_count;
+            }
+            while(accept(','));
+
+            expect(')');
+        }
+
+        if (arg_count != arity(op))
+            fail("Wrong number of arguments to '" + name + "'", position);
+
+        emit(op);
+    }
+
+    void emit_constant(double value)
+    {
+        auto & constants = m_expr.m_constants;
+        emit_instruction({ op_constant, int(constants.size()) });
+        constants.push_back(value);
+    }
+
+    // Emits an operation, or evaluates it right away
+    // if all operands are constant.
+    void emit(opcode op)
+    {
+        auto & code = m_expr.m_code;
+        auto & constants = m_expr.m_constants;
+
+        int n = arity(op);
+
+        bool constant_operands = (int) code.size() >= n;
+        for (int i = 1; i <= n && constant_operands; ++i)
+            constant_operands = code[code.size() - i].op == op_constant;
+
+        if (!constant_operands)
+        {
+            emit_instruction({ op, 0 });
+            return;
+        }
+
+        double value;
+        if (n == 1)
+        {
+            value = apply(op, constants[code.back().operand]);
+        }
+        else
+        {
+            double a = constants[code[code.size() - 2].operand];
+            double b = constants[code.back().operand];
+            value = apply(op, a, b);
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            constants.pop_back();
+            code.pop_back();
+        }
+        m_depth -= n;
+
+        emit_constant(value);
+    }
+
+    void emit_instruction(const instruction & i)
+    {
+        m_expr.m_code.push_back(i);
+        m_depth += 1 - arity(i.op);
+        m_expr.m_stack_size = std::max(m_expr.m_stack_size, m_depth);
+    }
+
+    void skip_space()
+    {
+        while (m_pos < m_text.size() && std::isspace(m_text[m_pos]))
+            ++m_pos;
+    }
+
+    bool accept(char c)
+    {
+        skip_space();
+        if (m_pos < m_text.size() && m_text[m_pos] == c)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(c))
+            fail(string("Expected '") + c + "'");
+    }
+
+    void fail(const string & message)
+    {
+        fail(message, m_pos);
+    }
+
+    void fail(const string & message, size_t position)
+    {
+        throw Error(message + " at position " + std::to_string(position + 1)
+                    + " of expression: " + m_text);
+    }
+
+    expression & m_expr;
+    const string & m_text;
+    const variable_map & m_variables;
+    size_t m_pos = 0;
+    int m_depth = 0;
+};
+
+expression::expression(const string & text, const variable_map & variables):
+    m_text(text)
+{
+    parser(*this, variables).parse();
+}
+
+bool expression::uses(int variable) const
+{
+    return std::binary_search(m_used_variables.begin(), m_used_variables.end(), variable);
+}
+
+template <typename F> inline
+void apply_unary(const double * a, double * result, int64_t count, F f)
+{
+    for (int64_t i = 0; i < count; ++i)
+        result[i] = f(a[i]);
+}
+
+template <typename F> inline
+void apply_binary(const double * a, const double * b, double * result, int64_t count, F f)
+{
+    for (int64_t i = 0; i < count; ++i)
+        result[i] = f(a[i], b[i]);
+}
+
+void expression::evaluate(const vector<const double*> & inputs, int64_t count, double * result) const
+{
+    // Each stack entry points either to an input or to its own buffer.
+
+    vector<double> buffers(m_stack_size * block_size);
+    vector<const double*> stack(m_stack_size);
+
+    for (int64_t start = 0; start < count; start += block_size)
+    {
+        int64_t n = std::min(block_size, count - start);
+        int top = -1;
+
+        for (auto & instr : m_code)
+        {
+            int arg_count = arity(instr.op);
+            top -= arg_count - 1;
+
+            double * out = buffers.data() + top * block_size;
+            const double * a = stack[top];
+            const double * b = arg_count > 1 ? stack[top + 1] : nullptr;
+
+            switch(instr.op)
+            {
+            case op_constant:
+                std::fill(out, out + n, m_constants[instr.operand]);
+                break;
+            case op_variable:
+                stack[top] = inputs[instr.operand] + start;
+                continue;
+            case op_negate: apply_unary(a, out, n, [](double x){ return -x; }); break;
+            case op_add: apply_binary(a, b, out, n, [](double x, double y){ return x + y; }); break;
+            case op_subtract: apply_binary(a, b, out, n, [](double x, double y){ return x - y; }); break;
+            case op_multiply: apply_binary(a, b, out, n, [](double x, double y){ return x * y; }); break;
+            case op_divide: apply_binary(a, b, out, n, [](double x, double y){ return x / y; }); break;
+            case op_power: apply_binary(a, b, out, n, [](double x, double y){ return std::pow(x, y); }); break;
+            case op_abs: apply_unary(a, out, n, [](double x){ return std::abs(x); }); break;
+            case op_sqrt: apply_unary(a, out, n, [](double x){ return std::sqrt(x); }); break;
+            case op_exp: apply_unary(a, out, n, [](double x){ return std::exp(x); }); break;
+            case op_log: apply_unary(a, out, n, [](double x){ return std::log(x); }); break;
+            case op_log10: apply_unary(a, out, n, [](double x){ return std::log10(x); }); break;
+            case op_sin: apply_unary(a, out, n, [](double x){ return std::sin(x); }); break;
+            case op_cos: apply_unary(a, out, n, [](double x){ return std::cos(x); }); break;
+            case op_tan: apply_unary(a, out, n, [](double x){ return std::tan(x); }); break;
+            case op_atan: apply_unary(a, out, n, [](double x){ return std::atan(x); }); break;
+            case op_floor: apply_unary(a, out, n, [](double x){ return std::floor(x); }); break;
+            case op_ceil: apply_unary(a, out, n, [](double x){ return std::ceil(x); }); break;
+            case op_atan2: apply_binary(a, b, out, n, [](double y, double x){ return std::atan2(y, x); }); break;
+            case op_min: apply_binary(a, b, out, n, [](double x, double y){ return std::min(x, y); }); break;
+            case op_max: apply_binary(a, b, out, n, [](double x, double y){ return std::max(x, y); }); break;
+            }
+
+            stack[top] = out;
+        }
+
+        std::copy(stack[0], stack[0] + n, result + start);
+    }
+}
+
+double expression::evaluate(const vector<double> & inputs) const
+{
+    vector<const double*> pointers(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+        pointers[i] = &inputs[i];
+
+    double result;
+    evaluate(pointers, 1, &result);
+    return result;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace datavis {
+
+using std::string;
+using std::vector;
+
+// An arithmetic expression over named variables,
+// compiled to bytecode for a stack machine.
+//
+// The syntax supports numbers, variables, parentheses,
+// the operators + - * / ^ (power), unary minus,
+// and the functions:
+// abs, sqrt, exp, log, log10, sin, cos, tan, atan, floor, ceil,
+// atan2(y, x), pow(x, y), min(x, y), max(x, y).
+//
+// Each instruction processes a block of elements at once,
+// so evaluation cost per element is a few tight loops
+// rather than an interpretation step per element.
+
+class expression
+{
+public:
+    // Maps variable names to indices of inputs to evaluate().
+    using variable_map = std::map<string, int>;
+
+    // Throws Error if the text is not a valid expression,
+    // or uses a variable not in variables.
+    expression(const string & text, const variable_map & variables);
+
+    const string & text() const { return m_text; }
+
+    // Whether the expression uses the input with the given index.
+    bool uses(int variable) const;
+
+    // Indices of inputs used by the expression, in ascending order.
+    const vector<int> & used_variables() const { return m_used_variables; }
+
+    // Evaluates count elements.
+    // Element i of input v is inputs[v][i].
+    // Only inputs that are used need to be valid.
+    void evaluate(const vector<const double*> & inputs, int64_t count, double * result) const;
+
+    // Evaluates a single element.
+    double evaluate(const vector<double> & inputs) const;
+
+    enum opcode
+    {
+        op_constant,
+        op_variable,
+        op_negate,
+        op_add,
+        op_subtract,
+        op_multiply,
+        op_divide,
+        op_power,
+        op_abs,
+        op_sqrt,
+        op_exp,
+        op_log,
+        op_log10,
+        op_sin,
+        op_cos,
+        op_tan,
+        op_atan,
+        op_floor,
+        op_ceil,
+        op_atan2,
+        op_min,
+        op_max
+    };
+
+    struct instruction
+    {
+        opcode op;
+        // Index of constant or variable
+        int operand = 0;
+    };
+
+    const vector<instruction> & code() const { return m_code; }
+
+private:
+    class parser;
+
+    string m_text;
+    vector<instruction> m_code;
+    vector<double> m_constants;
+    vector<int> m_used_variables;
+    int m_stack_size = 0;
+};
+
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "reduction.hpp"
+#include "minmax_pyramid.hpp"
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+namespace datavis {
+
+// M4 aggregation of a line for drawing it (Jugel et al., VLDB 2014):
+// the first, last, minimum and maximum value in each pixel column.
+// Drawing a vertical line from minimum to maximum in each column,
+// and a line from the last value of each column to the first of the next,
+// gives the same pixels as drawing lines between all values,
+// at a cost proportional to the number of columns.
+
+struct m4_column
+{
+    // Values at the first and last index of the column
+    double first = std::numeric_limits<double>::quiet_NaN();
+    double last = std::numeric_limits<double>::quiet_NaN();
+    // Extent of the values, ignoring NaN values
+    value_extent extent;
+    // Number of values
+    int64_t count = 0;
+};
+
+// Index of the first value in each of count pixel columns starting at pixel x,
+// and the end of the last column, for values at pixel positions
+// offset + scale * index, with scale > 0, and indices in [0, size).
+// A value at position p is in the column floor(p).
+inline
+std::vector<int64_t> m4_column_bounds(double offset, double scale, int x, int count, int64_t size)
+{
+    auto column_of = [&](int64_t index) { return std::floor(offset + scale * index); };
+
+    std::vector<int64_t> bounds(count + 1);
+
+    for (int c = 0; c <= count; ++c)
+    {
+        double column = x + c;
+
+        double estimate = std::ceil((column - offset) / scale);
+        estimate = std::max(0.0, std::min(double(size), estimate));
+        int64_t index = int64_t(estimate);
+
+        // Correct rounding errors of the estimate.
+        while (index > 0 && column_of(index - 1) >= column)
+            --index;
+        while (index < size && column_of(index) < column)
+            ++index;
+
+        bounds[c] = index;
+    }
+
+    return bounds;
+}
+
+// Aggregates values [bounds[c], bounds[c+1]) into column c.
+// value_at(index) returns a value, and extent(start, end)
+// the value_extent of values [start, end), for example
+// using minmax_pyramid::extent().
+template <typename Value_At, typename Extent>
+std::vector<m4_column> m4_aggregate(const std::vector<int64_t> & bounds,
+                                    Value_At value_at, Extent extent)
+{
+    std::vector<m4_column> columns(bounds.empty() ? 0 : bounds.size() - 1);
+
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        int64_t start = bounds[c];
+        int64_t end = bounds[c + 1];
+        if (end <= start)
+            continue;
+
+        auto & column = columns[c];
+        column.count = end - start;
+        column.first = value_at(start);
+        column.last = value_at(end - 1);
+        column.extent = extent(start, end);
+    }
+
+    return columns;
+}
+
+// Aggregates a line using its pyramid, which may still be being built.
+// Extents of columns reduced by the pyramid are found using
+// pyramid->extent(start, end, raw_extent). The others are found using
+// raw_extent(start, end) if they have at most max_raw_size values,
+// and are otherwise left empty, so they are drawn once reduced.
+// The pyramid may be null.
+template <typename Value_At, typename Raw_Extent>
+std::vector<m4_column> m4_aggregate(const std::vector<int64_t> & bounds,
+                                    const minmax_pyramid * pyramid,
+                                    Value_At value_at, Raw_Extent raw_extent,
+                                    int64_t max_raw_size)
+{
+    int64_t reduced = pyramid ? pyramid->added() : 0;
+
+    auto extent = [&](int64_t start, int64_t end)
+    {
+        if (end <= reduced)
+            return pyramid->extent(start, end, raw_extent);
+        if (end - start <= max_raw_size)
+            return value_extent(raw_extent(start, end));
+        return value_extent();
+    };
+
+    return m4_aggregate(bounds, value_at, extent);
+}
+
+// Aggregates a line using only final blocks of level 0 of its pyramid,
+// for lines whose values are not in memory.
+// Column bounds are rounded to the nearest boundary of blocks,
+// which shifts them by at most half a block, so columns should
+// contain many more values than a block.
+// Columns not covered by final blocks have an empty extent,
+// so they are drawn once reduced. Columns covering no whole block
+// are left without values, so lines continue across them.
+inline
+std::vector<m4_column> m4_aggregate_blocks(const std::vector<int64_t> & bounds,
+                                           const minmax_pyramid & pyramid)
+{
+    std::vector<m4_column> columns(bounds.empty() ? 0 : bounds.size() - 1);
+
+    if (pyramid.level_count() == 0)
+        return columns;
+
+    int64_t block_size = pyramid.block_size(0);
+    int64_t block_count = pyramid.block_count(0);
+    int64_t filled = pyramid.filled(0);
+
+    // Nearest block boundary, where the end of the line ends the last block.
+    auto block_of = [&](int64_t index)
+    {
+        if (index >= pyramid.size())
+            return block_count;
+        return std::min(block_count, (index + block_size / 2) / block_size);
+    };
+
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        int64_t first = block_of(bounds[c]);
+        int64_t end = block_of(bounds[c + 1]);
+        if (end <= first)
+            continue;
+
+        auto & column = columns[c];
+        column.count = bounds[c + 1] - bounds[c];
+
+        if (end > filled)
+            continue;
+
+        column.first = pyramid.block_first(first);
+        column.last = pyramid.block_last(end - 1);
+        column.extent = pyramid.blocks_extent(0, first, end);
+    }
+
+    return columns;
+}
+
+}
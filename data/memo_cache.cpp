@@ -0,0 +1,215 @@
+#include "memo_cache.hpp"
+
+#include <atomic>
+#include <functional>
+
+namespace datavis {
+
+static void hash_combine(std::size_t & seed, std::size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+std::size_t memo_key_hash::operator()(const memo_key & k) const
+{
+    std::size_t h = std::hash<std::uint64_t>()(k.source);
+    for (auto v : k.offset)
+        hash_combine(h, std::hash<std::int64_t>()(v));
+    for (auto v : k.size)
+        hash_combine(h, std::hash<std::int64_t>()(v));
+    hash_combine(h, std::hash<std::string>()(k.operation));
+    for (auto v : k.parameters)
+        hash_combine(h, std::hash<double>()(v));
+    return h;
+}
+
+memo_cache & memo_cache::global()
+{
+    static memo_cache cache(std::size_t(256) << 20);
+    return cache;
+}
+
+std::uint64_t memo_cache::new_source_id()
+{
+    static std::atomic<std::uint64_t> next_id { 1 };
+    return next_id++;
+}
+
+std::size_t memo_cache::budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+void memo_cache::set_budget(std::size_t bytes)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict(nullptr, dropped);
+}
+
+std::size_t memo_cache::used() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+std::size_t memo_cache::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+bool memo_cache::contains(const memo_key & key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return false;
+
+    return it->second.value || !it->second.pending.expired();
+}
+
+std::shared_ptr<void> memo_cache::find(const memo_key & key)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return nullptr;
+
+    auto & e = it->second;
+
+    std::shared_ptr<void> value = e.value ? e.value : e.pending.lock();
+
+    if (!value)
+    {
+        // Computation was cancelled.
+        erase(it, dropped);
+        return nullptr;
+    }
+
+    m_uses.splice(m_uses.begin(), m_uses, e.use);
+
+    return value;
+}
+
+std::shared_ptr<void> memo_cache::insert(const memo_key & key, const std::shared_ptr<void> & value)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        auto & e = it->second;
+        std::shared_ptr<void> existing = e.value ? e.value : e.pending.lock();
+        if (existing)
+            return existing;
+        erase(it, dropped);
+    }
+
+    m_uses.push_front(key);
+
+    entry e;
+    e.pending = value;
+    e.use = m_uses.begin();
+    m_entries.emplace(key, e);
+
+    return value;
+}
+
+void memo_cache::complete(const memo_key & key, const std::shared_ptr<void> & value, std::size_t cost)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return;
+
+    auto & e = it->second;
+
+    // The entry may have been replaced meanwhile.
+    if (e.value || e.pending.lock() != value)
+        return;
+
+    e.value = value;
+    e.pending.reset();
+    e.cost = cost;
+    m_used += cost;
+
+    evict(&key, dropped);
+}
+
+void memo_cache::erase(entry_map::iterator it, dropped_list & dropped)
+{
+    dropped.push_back(std::move(it->second.value));
+    m_used -= it->second.cost;
+    m_uses.erase(it->second.use);
+    m_entries.erase(it);
+}
+
+void memo_cache::evict(const memo_key * keep, dropped_list & dropped)
+{
+    auto it = m_uses.end();
+    while (m_used > m_budget && it != m_uses.begin())
+    {
+        --it;
+
+        if (keep && *it == *keep)
+            continue;
+
+        auto e = m_entries.find(*it);
+
+        // Computations in flight cost nothing yet.
+        if (!e->second.value)
+            continue;
+
+        dropped.push_back(std::move(e->second.value));
+        m_used -= e->second.cost;
+        m_entries.erase(e);
+        it = m_uses.erase(it);
+    }
+}
+
+void memo_cache::remove(std::uint64_t source)
+{
+    dropped_list dropped;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if (it->first.source == source)
+        {
+            dropped.push_back(std::move(it->second.value));
+            m_used -= it->second.cost;
+            m_uses.erase(it->second.use);
+            it = m_entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void memo_cache::clear()
+{
+    entry_map entries;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entries.swap(m_entries);
+    m_uses.clear();
+    m_used = 0;
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../reactive/value.hpp"
+
+#include <memory>
+#include <mutex>
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace datavis {
+
+// Identifies a derived computation:
+// an operation with parameters over a region of some source data.
+
+struct memo_key
+{
+    // Identity of the source data, for example DataSet::cacheId().
+    std::uint64_t source = 0;
+    std::vector<std::int64_t> offset;
+    std::vector<std::int64_t> size;
+    std::string operation;
+    std::vector<double> parameters;
+
+    bool operator==(const memo_key & other) const
+    {
+        return source == other.source &&
+                offset == other.offset &&
+                size == other.size &&
+                operation == other.operation &&
+                parameters == other.parameters;
+    }
+};
+
+struct memo_key_hash
+{
+    std::size_t operator()(const memo_key & k) const;
+};
+
+// Cache of results of derived computations, such as images or value ranges,
+// limited by a memory budget.
+//
+// Results are Reactive values. Requests for a key that is being computed
+// join the computation in flight, instead of starting another one.
+// A computation in flight is not kept alive by the cache, so it is
+// still cancelled when nobody needs its result anymore.
+// Once computed, results are kept until the total cost of cached results
+// exceeds the budget, and then the least recently used ones are dropped.
+
+class memo_cache
+{
+public:
+    memo_cache(std::size_t budget): m_budget(budget) {}
+
+    // Cache shared by all plots.
+    static memo_cache & global();
+
+    // A new source id, never used before.
+    static std::uint64_t new_source_id();
+
+    std::size_t budget() const;
+    void set_budget(std::size_t bytes);
+
+    // Total cost of cached results.
+    std::size_t used() const;
+
+    // Number of cached results and computations in flight.
+    std::size_t count() const;
+
+    // Returns the cached or in-flight result for the key.
+    // Otherwise returns the value returned by start(),
+    // and caches it once ready, with the cost returned by cost(result).
+    // The cache must outlive the value.
+    template <typename T, typename Start, typename Cost>
+    Reactive::Value<T> get(const memo_key & key, Start start, Cost cost)
+    {
+        if (auto existing = find(key))
+            return std::static_pointer_cast<Reactive::Value_Data<T>>(existing);
+
+        Reactive::Value<T> value = start();
+        if (!value)
+            return value;
+
+        // Another thread may have started the same computation meanwhile.
+        auto inserted = insert(key, value);
+        if (inserted != value)
+            return std::static_pointer_cast<Reactive::Value_Data<T>>(inserted);
+
+        std::weak_ptr<Reactive::Value_Data<T>> weak_value = value;
+
+        value->subscribe([this, key, weak_value, cost]()
+        {
+            auto value = weak_value.lock();
+            if (value)
+                complete(key, value, cost(value->value));
+        });
+
+        return value;
+    }
+
+    // Whether the result for the key is cached or in flight.
+    bool contains(const memo_key &) const;
+
+    // Drops all results of a source.
+    void remove(std::uint64_t source);
+
+    void clear();
+
+private:
+    struct entry
+    {
+        // Set when ready
+        std::shared_ptr<void> value;
+        // Set while in flight
+        std::weak_ptr<void> pending;
+        std::size_t cost = 0;
+        std::list<memo_key>::iterator use;
+    };
+
+    using entry_map = std::unordered_map<memo_key, entry, memo_key_hash>;
+
+    // Results dropped while the mutex is held, released after.
+    // Releasing a result may run arbitrary destructors,
+    // which may use the cache.
+    using dropped_list = std::vector<std::shared_ptr<void>>;
+
+    std::shared_ptr<void> find(const memo_key &);
+    std::shared_ptr<void> insert(const memo_key &, const std::shared_ptr<void> & value);
+    void complete(const memo_key &, const std::shared_ptr<void> & value, std::size_t cost);
+    void erase(entry_map::iterator, dropped_list &);
+    void evict(const memo_key * keep, dropped_list &);
+
+    mutable std::mutex m_mutex;
+    std::size_t m_budget;
+    std::size_t m_used = 0;
+    entry_map m_entries;
+    // Most recently used first
+    std::list<memo_key> m_uses;
+};
+
+}
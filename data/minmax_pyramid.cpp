@@ -0,0 +1,340 @@
+#include "minmax_pyramid.hpp"
+#include "../reactive/trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace datavis {
+
+// Number of values added between checks of the status.
+static const int64_t build_part_size = 1 << 20;
+
+// Number of values of each line added in turn when building several pyramids.
+static const int64_t interleave_part_size = 1 << 16;
+
+minmax_pyramid::minmax_pyramid(int64_t size, int64_t base_block_size, int factor):
+    m_size(size),
+    m_factor(factor)
+{
+    if (size < 0)
+        throw std::invalid_argument("Negative pyramid size.");
+    if (base_block_size < 1)
+        throw std::invalid_argument("Pyramid block size must be positive.");
+    if (factor < 2)
+        throw std::invalid_argument("Pyramid factor must be at least 2.");
+
+    if (size == 0)
+        return;
+
+    int64_t block_size = base_block_size;
+
+    while(true)
+    {
+        auto l = make_unique<level>();
+        l->block_size = block_size;
+        int64_t count = (size + block_size - 1) / block_size;
+        l->blocks.resize(count);
+        m_levels.push_back(std::move(l));
+
+        if (count == 1)
+            break;
+
+        block_size *= factor;
+    }
+
+    m_block_ends.resize(block_count(0));
+}
+
+int minmax_pyramid::level_for(double max_block_size) const
+{
+    int result = -1;
+    for (int l = 0; l < level_count(); ++l)
+    {
+        if (block_size(l) > max_block_size)
+            break;
+        result = l;
+    }
+    return result;
+}
+
+value_extent minmax_pyramid::blocks_extent(int level_index, int64_t first, int64_t end) const
+{
+    value_extent result;
+
+    while (first < end)
+    {
+        auto & blocks = m_levels[level_index]->blocks;
+
+        // Blocks of the next level within the range
+        int64_t upper_first = 0;
+        int64_t upper_end = 0;
+
+        if (level_index + 1 < level_count())
+        {
+            upper_first = (first + m_factor - 1) / m_factor;
+            upper_end = end == block_count(level_index) ?
+                        block_count(level_index + 1) : end / m_factor;
+        }
+
+        if (upper_first >= upper_end)
+        {
+            for (int64_t i = first; i < end; ++i)
+                result = merge(result, blocks[i]);
+            break;
+        }
+
+        // Edges not covered by the next level
+
+        for (int64_t i = first; i < upper_first * m_factor; ++i)
+            result = merge(result, blocks[i]);
+        for (int64_t i = upper_end * m_factor; i < end; ++i)
+            result = merge(result, blocks[i]);
+
+        ++level_index;
+        first = upper_first;
+        end = upper_end;
+    }
+
+    return result;
+}
+
+void minmax_pyramid::append(const array_span<double> & span)
+{
+    if (m_levels.empty())
+        return;
+
+    auto & base = *m_levels[0];
+
+    int64_t added = m_added.load(std::memory_order_relaxed);
+
+    if (span.size > m_size - added)
+        throw std::invalid_argument("Too many values added to pyramid.");
+
+    int64_t i = 0;
+    while (i < span.size)
+    {
+        int64_t count = std::min(base.block_size - base.partial_count, span.size - i);
+
+        array_span<double> part;
+        part.data = span.data + i * span.stride;
+        part.size = count;
+        part.stride = span.stride;
+
+        // Written before the block is completed, which publishes them.
+        int64_t block_index = added / base.block_size;
+        if (base.partial_count == 0)
+            m_block_ends[block_index].first = part.data[0];
+        m_block_ends[block_index].last = part.data[(count - 1) * part.stride];
+
+        base.partial = merge(base.partial, min_max(part));
+        base.partial_count += count;
+        added += count;
+        i += count;
+
+        if (base.partial_count == base.block_size || added == m_size)
+            complete_block(0);
+    }
+
+    m_added.store(added, std::memory_order_release);
+}
+
+void minmax_pyramid::complete_block(int level_index)
+{
+    auto & l = *m_levels[level_index];
+
+    int64_t index = l.filled.load(std::memory_order_relaxed);
+    l.blocks[index] = l.partial;
+    l.filled.store(index + 1, std::memory_order_release);
+
+    value_extent block = l.partial;
+    l.partial = value_extent();
+    l.partial_count = 0;
+
+    if (level_index + 1 >= level_count())
+        return;
+
+    auto & upper = *m_levels[level_index + 1];
+    upper.partial = merge(upper.partial, block);
+    ++upper.partial_count;
+
+    bool level_complete = index + 1 == block_count(level_index);
+    if (upper.partial_count == m_factor || level_complete)
+        complete_block(level_index + 1);
+}
+
+void minmax_pyramid::build(const array_region<double> & line, Reactive::Status * status)
+{
+    Reactive::Trace_Span span("Min/max pyramid", "compute");
+    span.set_bytes(flat_size(line.size()) * int64_t(sizeof(double)));
+
+    add(line, status);
+}
+
+void minmax_pyramid::build(tiled_array<double> & data, const vector<int64_t> & offset,
+                           const vector<int64_t> & size, Reactive::Status * status)
+{
+    Reactive::Trace_Span span("Min/max pyramid", "compute");
+    span.set_bytes(flat_size(size) * int64_t(sizeof(double)));
+
+    data.for_each_block(offset, size,
+                        [&](const array_region<double> & block, const vector<int64_t> &)
+    {
+        add(block, status);
+    });
+}
+
+void minmax_pyramid::add(const array_region<double> & line, Reactive::Status * status)
+{
+    for_each_span(line, [&](const array_span<double> & s)
+    {
+        for (int64_t i = 0; i < s.size; i += build_part_size)
+        {
+            if (status)
+                status->yield();
+
+            array_span<double> part;
+            part.data = s.data + i * s.stride;
+            part.size = std::min(build_part_size, s.size - i);
+            part.stride = s.stride;
+
+            append(part);
+
+            if (status)
+            {
+                int64_t done = added();
+                status->report_progress(double(done) / m_size,
+                                        done * int64_t(sizeof(double)), "Reducing");
+            }
+        }
+    });
+}
+
+std::size_t minmax_pyramid::memory_size() const
+{
+    std::size_t size = 0;
+    for (auto & l : m_levels)
+        size += l->blocks.size() * sizeof(value_extent);
+    size += m_block_ends.size() * sizeof(block_ends);
+    return size;
+}
+
+// Adds the same part of each line in turn, using add_part(line, start, count).
+template <typename F>
+static void build_interleaved(const vector<minmax_pyramid*> & pyramids,
+                              Reactive::Status * status, F add_part)
+{
+    int64_t total_size = 0;
+    int64_t max_size = 0;
+
+    for (auto * pyramid : pyramids)
+    {
+        total_size += pyramid->size();
+        max_size = std::max(max_size, pyramid->size());
+    }
+
+    Reactive::Trace_Span span("Min/max pyramids", "compute");
+    span.set_bytes(total_size * int64_t(sizeof(double)));
+
+    int64_t added = 0;
+
+    for (int64_t start = 0; start < max_size; start += interleave_part_size)
+    {
+        if (status)
+            status->yield();
+
+        for (size_t i = 0; i < pyramids.size(); ++i)
+        {
+            int64_t part_size = std::min(interleave_part_size, pyramids[i]->size() - start);
+            if (part_size <= 0)
+                continue;
+
+            add_part(i, start, part_size);
+
+            added += part_size;
+        }
+
+        if (status)
+        {
+            status->report_progress(double(added) / total_size,
+                                    added * int64_t(sizeof(double)), "Reducing");
+        }
+    }
+}
+
+// The dimension along a line, or 0 for a line of a single value.
+static int line_dimension(const vector<int64_t> & size)
+{
+    int line_dim = 0;
+    for (int d = 0; d < int(size.size()); ++d)
+    {
+        if (size[d] > 1)
+            line_dim = d;
+    }
+    return line_dim;
+}
+
+void build_pyramids(const vector<minmax_pyramid*> & pyramids,
+                    const vector<array_region<double>> & lines,
+                    Reactive::Status * status)
+{
+    if (pyramids.size() != lines.size())
+        throw std::invalid_argument("Number of pyramids and lines differ.");
+
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        if (flat_size(lines[i].size()) != pyramids[i]->size())
+            throw std::invalid_argument("Line size differs from pyramid size.");
+    }
+
+    build_interleaved(pyramids, status, [&](size_t i, int64_t start, int64_t count)
+    {
+        int d = line_dimension(lines[i].size());
+        auto offset = lines[i].offset();
+        auto size = lines[i].size();
+        offset[d] += start;
+        size[d] = count;
+
+        lines[i].sub_region(offset, size).for_each_span([&](const array_span<double> & s)
+        {
+            pyramids[i]->append(s);
+        });
+    });
+}
+
+void build_pyramids(const vector<minmax_pyramid*> & pyramids,
+                    const vector<tiled_array<double>*> & arrays,
+                    const vector<int64_t> & offset, const vector<int64_t> & size,
+                    Reactive::Status * status)
+{
+    if (pyramids.size() != arrays.size())
+        throw std::invalid_argument("Number of pyramids and lines differ.");
+
+    for (auto * pyramid : pyramids)
+    {
+        if (flat_size(size) != pyramid->size())
+            throw std::invalid_argument("Line size differs from pyramid size.");
+    }
+
+    int d = line_dimension(size);
+
+    build_interleaved(pyramids, status, [&](size_t i, int64_t start, int64_t count)
+    {
+        auto part_offset = offset;
+        auto part_size = size;
+        part_offset[d] += start;
+        part_size[d] = count;
+
+        arrays[i]->for_each_block(part_offset, part_size,
+                                  [&](const array_region<double> & block, const vector<int64_t> &)
+        {
+            block.for_each_span([&](const array_span<double> & s)
+            {
+                pyramids[i]->append(s);
+            });
+        });
+    });
+}
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "array.hpp"
+#include "tiled_array.hpp"
+#include "reduction.hpp"
+#include "../reactive/status.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+namespace datavis {
+
+// Minimum and maximum of blocks of a line of values, at several
+// block sizes, for drawing the line at any zoom level
+// without visiting every value.
+//
+// Blocks of level 0 contain base_block_size values, and blocks of
+// each further level contain factor blocks of the level below.
+// The last block of a level may be smaller. The last level has a single block.
+// NaN values are ignored, so blocks of only NaN values are empty.
+//
+// The pyramid is built incrementally from the start of the line,
+// reducing each level from the level below, and can be read while
+// it is being built: blocks below filled(level) are final.
+// Blocks of all levels are completed as the values are added,
+// so all levels cover about the same start of the line.
+//
+// The extent of any range of values is found in logarithmic time,
+// from a few blocks of each level, like in a segment tree.
+//
+// The first and last value of each block of level 0 are kept too,
+// so lines can be drawn at block resolution without reading their values.
+
+class minmax_pyramid
+{
+public:
+    minmax_pyramid(int64_t size, int64_t base_block_size = 64, int factor = 8);
+
+    minmax_pyramid(const minmax_pyramid &) = delete;
+    minmax_pyramid & operator=(const minmax_pyramid &) = delete;
+
+    // Number of values of the line.
+    int64_t size() const { return m_size; }
+    int factor() const { return m_factor; }
+
+    int level_count() const { return int(m_levels.size()); }
+    int64_t block_size(int level) const { return m_levels[level]->block_size; }
+    int64_t block_count(int level) const { return int64_t(m_levels[level]->blocks.size()); }
+
+    // Number of final blocks of the level.
+    int64_t filled(int level) const
+    {
+        return m_levels[level]->filled.load(std::memory_order_acquire);
+    }
+
+    // A final block of the level.
+    const value_extent & block(int level, int64_t index) const
+    {
+        return m_levels[level]->blocks[index];
+    }
+
+    // First and last value of a final block of level 0,
+    // including NaN values.
+    double block_first(int64_t index) const { return m_block_ends[index].first; }
+    double block_last(int64_t index) const { return m_block_ends[index].last; }
+
+    // Number of values added so far.
+    int64_t added() const { return m_added.load(std::memory_order_acquire); }
+
+    bool is_complete() const { return added() == m_size; }
+
+    // The coarsest level with blocks of at most max_block_size values,
+    // or -1 if blocks of level 0 are larger.
+    int level_for(double max_block_size) const;
+
+    // Extent of blocks [first, end) of the level, which must be final.
+    // Uses blocks of coarser levels where they cover whole blocks.
+    value_extent blocks_extent(int level, int64_t first, int64_t end) const;
+
+    // Extent of values [start, end) of the line, which must have been added.
+    // Values at the edges not covering whole blocks are reduced
+    // by edge_extent(start, end), returning their value_extent.
+    template <typename F>
+    value_extent extent(int64_t start, int64_t end, F edge_extent) const
+    {
+        if (end <= start)
+            return value_extent();
+
+        if (m_levels.empty())
+            return edge_extent(start, end);
+
+        int64_t size = block_size(0);
+        int64_t first = (start + size - 1) / size;
+        int64_t last = end == m_size ? block_count(0) : end / size;
+
+        if (first >= last)
+            return edge_extent(start, end);
+
+        value_extent result = blocks_extent(0, first, last);
+
+        int64_t blocks_start = first * size;
+        int64_t blocks_end = std::min(last * size, m_size);
+
+        if (start < blocks_start)
+            result = merge(result, edge_extent(start, blocks_start));
+        if (blocks_end < end)
+            result = merge(result, edge_extent(blocks_end, end));
+
+        return result;
+    }
+
+    // Adds the next values of the line, after those added before.
+    // Only one thread may add values at a time.
+    void append(const array_span<double> &);
+
+    // Adds all values of a region with a single dimension of size
+    // larger than 1, after those added before.
+    // Yields to the status and reports progress between parts.
+    void build(const array_region<double> & line, Reactive::Status * status = nullptr);
+
+    // Adds all values of a line of a tiled array at offset with size,
+    // one block of a tile at a time, so only tiles in the cache are held in memory.
+    void build(tiled_array<double> & data, const std::vector<int64_t> & offset,
+               const std::vector<int64_t> & size, Reactive::Status * status = nullptr);
+
+    // Approximate memory used by the blocks.
+    std::size_t memory_size() const;
+
+private:
+    struct level
+    {
+        int64_t block_size = 0;
+        std::vector<value_extent> blocks;
+        std::atomic<int64_t> filled { 0 };
+
+        // The block being filled and the number of its
+        // values (level 0) or blocks of the level below.
+        value_extent partial;
+        int64_t partial_count = 0;
+    };
+
+    void complete_block(int level);
+    void add(const array_region<double> &, Reactive::Status *);
+
+    struct block_ends
+    {
+        double first = 0;
+        double last = 0;
+    };
+
+    int64_t m_size;
+    int m_factor;
+    std::vector<std::unique_ptr<level>> m_levels;
+    std::vector<block_ends> m_block_ends;
+    std::atomic<int64_t> m_added { 0 };
+};
+
+using minmax_pyramid_ptr = std::shared_ptr<minmax_pyramid>;
+
+// Builds the pyramids of several lines together, like minmax_pyramid::build(),
+// adding the same part of each line in turn, so that all pyramids
+// cover about the same start of their lines at any time.
+// Each line must have the size of its pyramid, and no values added before.
+void build_pyramids(const std::vector<minmax_pyramid*> & pyramids,
+                    const std::vector<array_region<double>> & lines,
+                    Reactive::Status * status = nullptr);
+
+// Same as above, for lines at offset with size of tiled arrays,
+// reading one block of a tile at a time.
+void build_pyramids(const std::vector<minmax_pyramid*> & pyramids,
+                    const std::vector<tiled_array<double>*> & arrays,
+                    const std::vector<int64_t> & offset, const std::vector<int64_t> & size,
+                    Reactive::Status * status = nullptr);
+
+}
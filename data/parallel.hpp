@@ -0,0 +1,123 @@
+#pragma once
+
+#include "array.hpp"
+#include "../utility/threads.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace datavis {
+
+using std::vector;
+
+// Default number of elements in a block of parallel work.
+// 32K doubles take 256 KB, which fits in L2 cache on most machines.
+const int64_t parallel_block_size = 1 << 15;
+
+namespace detail {
+
+template <typename T>
+void split_region(const array_region<T> & region, int first_dim, int64_t block_size,
+                  vector<array_region<T>> & blocks)
+{
+    const auto & offset = region.offset();
+    const auto & size = region.size();
+    int n_dim = size.size();
+
+    int d = first_dim;
+    while (d < n_dim && size[d] == 1)
+        ++d;
+
+    if (d == n_dim || flat_size(size) <= block_size)
+    {
+        blocks.push_back(region);
+        return;
+    }
+
+    int64_t inner_size = 1;
+    for (int i = d + 1; i < n_dim; ++i)
+        inner_size *= size[i];
+
+    int64_t extent = std::max(int64_t(1), block_size / inner_size);
+
+    for (int64_t start = 0; start < size[d]; start += extent)
+    {
+        auto block_offset = offset;
+        auto block_region_size = size;
+        block_offset[d] += start;
+        block_region_size[d] = std::min(extent, size[d] - start);
+
+        auto block = region.sub_region(block_offset, block_region_size);
+
+        if (inner_size > block_size)
+            split_region(block, d + 1, block_size, blocks);
+        else
+            blocks.push_back(block);
+    }
+}
+
+}
+
+// Splits a region into blocks of at most block_size elements, in iteration order.
+// The outermost dimensions are split first, so blocks consist of whole
+// inner runs whenever possible.
+// A region with only one dimension larger than 1 is split into blocks
+// of exactly block_size elements, except for the last one.
+template <typename T>
+vector<array_region<T>> split_region(const array_region<T> & region, int64_t block_size = parallel_block_size)
+{
+    vector<array_region<T>> blocks;
+
+    if (!region.is_valid())
+        return blocks;
+
+    for (auto s : region.size())
+    {
+        if (s < 1)
+            return blocks;
+    }
+
+    detail::split_region(region, 0, std::max(int64_t(1), block_size), blocks);
+
+    return blocks;
+}
+
+// Calls fn(const array_region<T> & block) for each block of the region,
+// in parallel on the compute pool.
+// Returns when all blocks are done.
+template <typename T, typename F>
+void parallel_for(const array_region<T> & region, F fn, int64_t block_size = parallel_block_size)
+{
+    auto blocks = split_region(region, block_size);
+
+    compute_pool().for_each_index(blocks.size(), [&](int i)
+    {
+        fn(blocks[i]);
+    });
+}
+
+// Maps each block of the region to a result in parallel,
+// then merges results in block order, starting with identity.
+// The result therefore only depends on the region and block size,
+// not on the number of threads or their timing.
+template <typename R, typename T, typename Map, typename Merge>
+R parallel_reduce(const array_region<T> & region, const R & identity, Map map, Merge merge,
+                  int64_t block_size = parallel_block_size)
+{
+    auto blocks = split_region(region, block_size);
+
+    vector<R> results(blocks.size(), identity);
+
+    compute_pool().for_each_index(blocks.size(), [&](int i)
+    {
+        results[i] = map(blocks[i]);
+    });
+
+    R result = identity;
+    for (auto & r : results)
+        result = merge(result, r);
+
+    return result;
+}
+
+}
@@ -0,0 +1,525 @@
+#include "reduction.hpp"
+#include "parallel.hpp"
+
+#include <cmath>
+#include <functional>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DATAVIS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace datavis {
+
+namespace {
+
+// Moments are computed in two passes over chunks small enough
+// to stay in cache between passes.
+const long moments_chunk_size = 4096;
+
+struct reduction_kernels
+{
+    const char * name;
+    void (*min_max)(const double * data, long size, double & min, double & max);
+    double (*sum)(const double * data, long size);
+    double (*sum_sq_dev)(const double * data, long size, double mean);
+};
+
+// Scalar
+
+void scalar_min_max(const double * data, long size, double & min, double & max)
+{
+    for (long i = 0; i < size; ++i)
+    {
+        double v = data[i];
+        if (v < min) min = v;
+        if (v > max) max = v;
+    }
+}
+
+double scalar_sum(const double * data, long size)
+{
+    double s = 0;
+    for (long i = 0; i < size; ++i)
+        s += data[i];
+    return s;
+}
+
+double scalar_sum_sq_dev(const double * data, long size, double mean)
+{
+    double s = 0;
+    for (long i = 0; i < size; ++i)
+    {
+        double d = data[i] - mean;
+        s += d * d;
+    }
+    return s;
+}
+
+#ifdef DATAVIS_X86_KERNELS
+
+// SSE2
+// Note: _mm_min_pd(x, acc) returns acc when x is NaN, so NaN is ignored.
+
+void sse2_min_max(const double * data, long size, double & min, double & max)
+{
+    __m128d min0 = _mm_set1_pd(min);
+    __m128d min1 = min0;
+    __m128d max0 = _mm_set1_pd(max);
+    __m128d max1 = max0;
+
+    long i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m128d a = _mm_loadu_pd(data + i);
+        __m128d b = _mm_loadu_pd(data + i + 2);
+        min0 = _mm_min_pd(a, min0);
+        min1 = _mm_min_pd(b, min1);
+        max0 = _mm_max_pd(a, max0);
+        max1 = _mm_max_pd(b, max1);
+    }
+
+    alignas(16) double mins[4];
+    alignas(16) double maxs[4];
+    _mm_store_pd(mins, min0);
+    _mm_store_pd(mins + 2, min1);
+    _mm_store_pd(maxs, max0);
+    _mm_store_pd(maxs + 2, max1);
+
+    for (int k = 0; k < 4; ++k)
+    {
+        min = std::min(min, mins[k]);
+        max = std::max(max, maxs[k]);
+    }
+
+    scalar_min_max(data + i, size - i, min, max);
+}
+
+double sse2_sum(const double * data, long size)
+{
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+
+    long i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(data + i));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(data + i + 2));
+    }
+
+    alignas(16) double s[2];
+    _mm_store_pd(s, _mm_add_pd(s0, s1));
+
+    return s[0] + s[1] + scalar_sum(data + i, size - i);
+}
+
+double sse2_sum_sq_dev(const double * data, long size, double mean)
+{
+    __m128d m = _mm_set1_pd(mean);
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+
+    long i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m128d a = _mm_sub_pd(_mm_loadu_pd(data + i), m);
+        __m128d b = _mm_sub_pd(_mm_loadu_pd(data + i + 2), m);
+        s0 = _mm_add_pd(s0, _mm_mul_pd(a, a));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(b, b));
+    }
+
+    alignas(16) double s[2];
+    _mm_store_pd(s, _mm_add_pd(s0, s1));
+
+    return s[0] + s[1] + scalar_sum_sq_dev(data + i, size - i, mean);
+}
+
+// AVX2
+
+__attribute__((target("avx2")))
+void avx2_min_max(const double * data, long size, double & min, double & max)
+{
+    __m256d min0 = _mm256_set1_pd(min);
+    __m256d min1 = min0;
+    __m256d max0 = _mm256_set1_pd(max);
+    __m256d max1 = max0;
+
+    long i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256d a = _mm256_loadu_pd(data + i);
+        __m256d b = _mm256_loadu_pd(data + i + 4);
+        min0 = _mm256_min_pd(a, min0);
+        min1 = _mm256_min_pd(b, min1);
+        max0 = _mm256_max_pd(a, max0);
+        max1 = _mm256_max_pd(b, max1);
+    }
+
+    alignas(32) double mins[8];
+    alignas(32) double maxs[8];
+    _mm256_store_pd(mins, min0);
+    _mm256_store_pd(mins + 4, min1);
+    _mm256_store_pd(maxs, max0);
+    _mm256_store_pd(maxs + 4, max1);
+
+    for (int k = 0; k < 8; ++k)
+    {
+        min = std::min(min, mins[k]);
+        max = std::max(max, maxs[k]);
+    }
+
+    scalar_min_max(data + i, size - i, min, max);
+}
+
+__attribute__((target("avx2")))
+double avx2_sum(const double * data, long size)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+
+    long i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(data + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(data + i + 4));
+    }
+
+    alignas(32) double s[4];
+    _mm256_store_pd(s, _mm256_add_pd(s0, s1));
+
+    return s[0] + s[1] + s[2] + s[3] + scalar_sum(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+double avx2_sum_sq_dev(const double * data, long size, double mean)
+{
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+
+    long i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256d a = _mm256_sub_pd(_mm256_loadu_pd(data + i), m);
+        __m256d b = _mm256_sub_pd(_mm256_loadu_pd(data + i + 4), m);
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(a, a));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(b, b));
+    }
+
+    alignas(32) double s[4];
+    _mm256_store_pd(s, _mm256_add_pd(s0, s1));
+
+    return s[0] + s[1] + s[2] + s[3] + scalar_sum_sq_dev(data + i, size - i, mean);
+}
+
+#endif // DATAVIS_X86_KERNELS
+
+reduction_kernels select_kernels()
+{
+#ifdef DATAVIS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { "avx2", &avx2_min_max, &avx2_sum, &avx2_sum_sq_dev };
+    return { "sse2", &sse2_min_max, &sse2_sum, &sse2_sum_sq_dev };
+#else
+    return { "scalar", &scalar_min_max, &scalar_sum, &scalar_sum_sq_dev };
+#endif
+}
+
+const reduction_kernels & kernels()
+{
+    static reduction_kernels k = select_kernels();
+    return k;
+}
+
+}
+
+const char * reduction_instruction_set()
+{
+    return kernels().name;
+}
+
+value_extent min_max(const array_span<double> & span)
+{
+    value_extent r;
+
+    if (span.stride == 1)
+    {
+        kernels().min_max(span.data, span.size, r.min, r.max);
+    }
+    else
+    {
+        const double * p = span.data;
+        for (long i = 0; i < span.size; ++i, p += span.stride)
+        {
+            double v = *p;
+            if (v < r.min) r.min = v;
+            if (v > r.max) r.max = v;
+        }
+    }
+
+    return r;
+}
+
+double sum(const array_span<double> & span)
+{
+    if (span.stride == 1)
+        return kernels().sum(span.data, span.size);
+
+    double s = 0;
+    const double * p = span.data;
+    for (long i = 0; i < span.size; ++i, p += span.stride)
+        s += *p;
+    return s;
+}
+
+value_moments moments(const array_span<double> & span)
+{
+    const auto & k = kernels();
+
+    value_moments r;
+
+    for (long start = 0; start < span.size; start += moments_chunk_size)
+    {
+        long size = std::min(moments_chunk_size, span.size - start);
+
+        value_moments chunk;
+        chunk.count = size;
+
+        if (span.stride == 1)
+        {
+            const double * data = span.data + start;
+            chunk.mean = k.sum(data, size) / size;
+            chunk.m2 = k.sum_sq_dev(data, size, chunk.mean);
+        }
+        else
+        {
+            const double * data = span.data + start * span.stride;
+            double s = 0;
+            for (long i = 0; i < size; ++i)
+                s += data[i * span.stride];
+            chunk.mean = s / size;
+            for (long i = 0; i < size; ++i)
+            {
+                double d = data[i * span.stride] - chunk.mean;
+                chunk.m2 += d * d;
+            }
+        }
+
+        r = merge(r, chunk);
+    }
+
+    return r;
+}
+
+value_statistics statistics(const array_span<double> & span)
+{
+    value_statistics r;
+
+    // (v - v) is NaN for NaN and infinity, and 0 otherwise.
+    // This loop is branch-free and vectorizes well.
+    int64_t non_finite_count = 0;
+    const double * p = span.data;
+    for (long i = 0; i < span.size; ++i, p += span.stride)
+        non_finite_count += !(*p - *p == 0);
+
+    r.non_finite_count = non_finite_count;
+
+    if (non_finite_count == 0)
+    {
+        r.extent = min_max(span);
+        r.moments = moments(span);
+        return r;
+    }
+
+    // Slow path: Skip non-finite values.
+
+    double s = 0;
+    long count = 0;
+    p = span.data;
+    for (long i = 0; i < span.size; ++i, p += span.stride)
+    {
+        double v = *p;
+        if (!(v - v == 0))
+            continue;
+        r.extent.min = std::min(r.extent.min, v);
+        r.extent.max = std::max(r.extent.max, v);
+        s += v;
+        ++count;
+    }
+
+    r.moments.count = count;
+    if (count > 0)
+    {
+        r.moments.mean = s / count;
+        p = span.data;
+        for (long i = 0; i < span.size; ++i, p += span.stride)
+        {
+            double d = *p - r.moments.mean;
+            if (d - d == 0)
+                r.moments.m2 += d * d;
+        }
+    }
+
+    return r;
+}
+
+value_statistics merge(const value_statistics & a, const value_statistics & b)
+{
+    value_statistics r;
+    r.extent = merge(a.extent, b.extent);
+    r.moments = merge(a.moments, b.moments);
+    r.non_finite_count = a.non_finite_count + b.non_finite_count;
+
+    if (a.histogram.size() == b.histogram.size())
+    {
+        r.histogram = a.histogram;
+        for (size_t i = 0; i < b.histogram.size(); ++i)
+            r.histogram[i] += b.histogram[i];
+    }
+    else
+    {
+        r.histogram = a.histogram.empty() ? b.histogram : a.histogram;
+    }
+
+    return r;
+}
+
+value_extent min_max(const array_region<double> & region)
+{
+    auto map = [](const array_region<double> & block)
+    {
+        value_extent r;
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            r = merge(r, min_max(span));
+        });
+        return r;
+    };
+
+    auto reduce = [](const value_extent & a, const value_extent & b)
+    {
+        return merge(a, b);
+    };
+
+    return parallel_reduce(region, value_extent(), map, reduce);
+}
+
+double minimum(const array_region<double> & region)
+{
+    auto r = min_max(region);
+    return r.is_empty() ? 0 : r.min;
+}
+
+double maximum(const array_region<double> & region)
+{
+    auto r = min_max(region);
+    return r.is_empty() ? 0 : r.max;
+}
+
+double sum(const array_region<double> & region)
+{
+    auto map = [](const array_region<double> & block)
+    {
+        double s = 0;
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            s += sum(span);
+        });
+        return s;
+    };
+
+    return parallel_reduce(region, 0.0, map, std::plus<double>());
+}
+
+value_moments moments(const array_region<double> & region)
+{
+    auto map = [](const array_region<double> & block)
+    {
+        value_moments r;
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            r = merge(r, moments(span));
+        });
+        return r;
+    };
+
+    auto reduce = [](const value_moments & a, const value_moments & b)
+    {
+        return merge(a, b);
+    };
+
+    return parallel_reduce(region, value_moments(), map, reduce);
+}
+
+value_statistics statistics(const array_region<double> & region)
+{
+    auto map = [](const array_region<double> & block)
+    {
+        value_statistics r;
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            r = merge(r, statistics(span));
+        });
+        return r;
+    };
+
+    auto reduce = [](const value_statistics & a, const value_statistics & b)
+    {
+        return merge(a, b);
+    };
+
+    return parallel_reduce(region, value_statistics(), map, reduce);
+}
+
+std::vector<int64_t> histogram(const array_region<double> & region, double min, double max, int bin_count)
+{
+    using bins = std::vector<int64_t>;
+
+    if (bin_count < 1)
+        return bins();
+
+    double extent = max - min;
+    double scale = extent > 0 ? bin_count / extent : 0;
+
+    auto map = [&](const array_region<double> & block)
+    {
+        bins r(bin_count, 0);
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            const double * p = span.data;
+            for (long i = 0; i < span.size; ++i, p += span.stride)
+            {
+                double v = *p;
+                // Also excludes NaN
+                if (!(v >= min && v <= max))
+                    continue;
+                int bin = std::min(int((v - min) * scale), bin_count - 1);
+                ++r[bin];
+            }
+        });
+        return r;
+    };
+
+    auto reduce = [](const bins & a, const bins & b)
+    {
+        bins r(a);
+        for (size_t i = 0; i < b.size(); ++i)
+            r[i] += b[i];
+        return r;
+    };
+
+    return parallel_reduce(region, bins(bin_count, 0), map, reduce);
+}
+
+double mean(const array_region<double> & region)
+{
+    return moments(region).mean;
+}
+
+double variance(const array_region<double> & region)
+{
+    return moments(region).variance();
+}
+
+}
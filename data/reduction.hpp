@@ -0,0 +1,110 @@
+#pragma once
+
+#include "array.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+namespace datavis {
+
+// Minimum and maximum of a set of values.
+// NaN values are ignored.
+// An empty set has min > max.
+struct value_extent
+{
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    bool is_empty() const { return !(min <= max); }
+};
+
+inline
+value_extent merge(const value_extent & a, const value_extent & b)
+{
+    value_extent r;
+    r.min = std::min(a.min, b.min);
+    r.max = std::max(a.max, b.max);
+    return r;
+}
+
+// Count, mean and sum of squared deviations from the mean.
+struct value_moments
+{
+    long count = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    double sum() const { return mean * count; }
+    double variance() const { return count > 0 ? m2 / count : 0; }
+};
+
+// Combines moments of two disjoint sets (Chan et al.).
+inline
+value_moments merge(const value_moments & a, const value_moments & b)
+{
+    if (a.count == 0)
+        return b;
+    if (b.count == 0)
+        return a;
+
+    value_moments r;
+    r.count = a.count + b.count;
+    double delta = b.mean - a.mean;
+    r.mean = a.mean + delta * (double(b.count) / r.count);
+    r.m2 = a.m2 + b.m2 + delta * delta * (double(a.count) * b.count / r.count);
+    return r;
+}
+
+// Statistics of a set of values.
+// Extent and moments only include finite values.
+// The histogram is optional. Its bins have equal width and
+// cover the extent, with the maximum included in the last bin.
+struct value_statistics
+{
+    value_extent extent;
+    value_moments moments;
+    int64_t non_finite_count = 0;
+    std::vector<int64_t> histogram;
+
+    int64_t count() const { return moments.count + non_finite_count; }
+};
+
+// Combines statistics of two disjoint sets.
+// Histograms are added if they have the same number of bins,
+// assuming they cover the same extent.
+value_statistics merge(const value_statistics & a, const value_statistics & b);
+
+// Reductions over a single span.
+// Contiguous spans use SIMD kernels selected at runtime
+// according to the instruction set supported by the CPU.
+
+value_extent min_max(const array_span<double> &);
+double sum(const array_span<double> &);
+value_moments moments(const array_span<double> &);
+value_statistics statistics(const array_span<double> &);
+
+// Reductions over regions.
+// Large regions are reduced in parallel on the compute pool.
+// Minimum and maximum of an empty region are 0.
+
+value_extent min_max(const array_region<double> &);
+double minimum(const array_region<double> &);
+double maximum(const array_region<double> &);
+double sum(const array_region<double> &);
+value_moments moments(const array_region<double> &);
+double mean(const array_region<double> &);
+double variance(const array_region<double> &);
+
+// Statistics without histogram.
+value_statistics statistics(const array_region<double> &);
+
+// Counts finite values in bin_count bins of equal width between min and max.
+// Values outside [min, max] are not counted.
+std::vector<int64_t> histogram(const array_region<double> &, double min, double max, int bin_count);
+
+// Name of the instruction set used by the kernels.
+const char * reduction_instruction_set();
+
+}
@@ -0,0 +1,171 @@
+#include "tile_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+
+namespace datavis {
+
+tile_cache & tile_cache::global()
+{
+    static tile_cache cache(std::size_t(1) << 30);
+    return cache;
+}
+
+std::uint64_t tile_cache::new_array_id()
+{
+    static std::atomic<std::uint64_t> next_id { 1 };
+    return next_id++;
+}
+
+std::size_t tile_cache::budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+void tile_cache::set_budget(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict(key { 0, -1 });
+}
+
+std::size_t tile_cache::used() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+std::size_t tile_cache::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+bool tile_cache::contains(std::uint64_t array_id, std::int64_t tile_index) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.count(key { array_id, tile_index }) > 0;
+}
+
+tile_cache::tile_ptr tile_cache::get(std::uint64_t array_id, std::int64_t tile_index,
+                                     std::size_t byte_size, const loader & load)
+{
+    key k { array_id, tile_index };
+
+    std::promise<tile_ptr> promise;
+    std::shared_future<tile_ptr> pending;
+    std::uint64_t load_id = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(k);
+        if (it != m_entries.end())
+        {
+            auto & e = it->second;
+            m_uses.splice(m_uses.begin(), m_uses, e.use);
+            pending = e.tile;
+        }
+        else
+        {
+            m_uses.push_front(k);
+
+            entry e;
+            e.tile = promise.get_future().share();
+            e.byte_size = byte_size;
+            e.use = m_uses.begin();
+            e.load_id = load_id = m_next_load_id++;
+            m_entries.emplace(k, e);
+            m_used += byte_size;
+        }
+    }
+
+    // Cached or being loaded by another thread
+    if (pending.valid())
+        return pending.get();
+
+    tile_ptr tile;
+
+    try
+    {
+        tile = load();
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+
+        // The entry may have been removed and replaced by another load meanwhile.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(k);
+        if (it != m_entries.end() && it->second.load_id == load_id)
+        {
+            m_used -= it->second.byte_size;
+            m_uses.erase(it->second.use);
+            m_entries.erase(it);
+        }
+
+        throw;
+    }
+
+    promise.set_value(tile);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        evict(k);
+    }
+
+    return tile;
+}
+
+void tile_cache::evict(const key & keep)
+{
+    auto it = m_uses.end();
+    while (m_used > m_budget && it != m_uses.begin())
+    {
+        --it;
+
+        if (*it == keep)
+            continue;
+
+        auto e = m_entries.find(*it);
+
+        // Still loading
+        if (e->second.tile.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        m_used -= e->second.byte_size;
+        m_entries.erase(e);
+        it = m_uses.erase(it);
+    }
+}
+
+void tile_cache::remove(std::uint64_t array_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_uses.begin(); it != m_uses.end(); )
+    {
+        if (it->array_id == array_id)
+        {
+            auto e = m_entries.find(*it);
+            m_used -= e->second.byte_size;
+            m_entries.erase(e);
+            it = m_uses.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void tile_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_uses.clear();
+    m_used = 0;
+}
+
+}
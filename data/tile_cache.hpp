@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace datavis {
+
+// Least-recently-used cache of data tiles, limited by a memory budget.
+//
+// Tiles are identified by the id of the array they belong to
+// and the index of the tile within the array.
+// A tile is loaded on first request. Concurrent requests for a tile
+// that is being loaded wait for the same load.
+// When the total size of cached tiles exceeds the budget,
+// the least recently used tiles are dropped from the cache.
+// Tiles being loaded are not dropped, so they are loaded only once.
+// Tiles still in use elsewhere stay in memory until released.
+
+class tile_cache
+{
+public:
+    using tile_ptr = std::shared_ptr<void>;
+    using loader = std::function<tile_ptr()>;
+
+    tile_cache(std::size_t budget): m_budget(budget) {}
+
+    // Cache shared by all tiled arrays.
+    static tile_cache & global();
+
+    // A new id for an array, never used before.
+    static std::uint64_t new_array_id();
+
+    std::size_t budget() const;
+    void set_budget(std::size_t bytes);
+
+    // Total size of cached tiles.
+    std::size_t used() const;
+
+    // Number of cached tiles.
+    std::size_t count() const;
+
+    // Returns the tile, loading it if not cached.
+    // Rethrows exceptions thrown by load.
+    tile_ptr get(std::uint64_t array_id, std::int64_t tile_index, std::size_t byte_size, const loader & load);
+
+    // Whether the tile is cached or being loaded.
+    bool contains(std::uint64_t array_id, std::int64_t tile_index) const;
+
+    // Drops all tiles of an array.
+    void remove(std::uint64_t array_id);
+
+    void clear();
+
+private:
+    struct key
+    {
+        std::uint64_t array_id;
+        std::int64_t tile_index;
+
+        bool operator==(const key & other) const
+        {
+            return array_id == other.array_id && tile_index == other.tile_index;
+        }
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(const key & k) const
+        {
+            return std::hash<std::uint64_t>()(k.array_id * 0x9e3779b97f4a7c15ull ^ k.tile_index);
+        }
+    };
+
+    struct entry
+    {
+        std::shared_future<tile_ptr> tile;
+        std::size_t byte_size;
+        std::list<key>::iterator use;
+        // Identifies the load, in case the entry is replaced meanwhile.
+        std::uint64_t load_id;
+    };
+
+    void evict(const key & keep);
+
+    mutable std::mutex m_mutex;
+    std::size_t m_budget;
+    std::size_t m_used = 0;
+    std::uint64_t m_next_load_id = 0;
+    std::unordered_map<key, entry, key_hash> m_entries;
+    // Most recently used first
+    std::list<key> m_uses;
+};
+
+}
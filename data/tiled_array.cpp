@@ -0,0 +1,46 @@
+#include "tiled_array.hpp"
+#include "../utility/error.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+namespace datavis {
+
+file_reader::file_reader(const std::string & path):
+    m_path(path)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw Error("Failed to open file " + path + ": " + std::strerror(errno));
+}
+
+file_reader::~file_reader()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+void file_reader::read(int64_t offset, int64_t byte_count, void * buffer)
+{
+    // pread does not change the file position,
+    // so multiple threads can read at the same time.
+
+    char * dest = (char*) buffer;
+
+    while (byte_count > 0)
+    {
+        auto count = ::pread(m_fd, dest, byte_count, offset);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            throw Error("Failed to read file " + m_path);
+
+        dest += count;
+        offset += count;
+        byte_count -= count;
+    }
+}
+
+}
@@ -0,0 +1,386 @@
+#pragma once
+
+#include "array.hpp"
+#include "tile_cache.hpp"
+#include "../utility/threads.hpp"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace datavis {
+
+using std::vector;
+
+// Provides elements of an array that is not held in memory.
+
+template <typename T>
+class tile_source
+{
+public:
+    virtual ~tile_source() {}
+
+    // Reads the elements of the region at offset with size
+    // into buffer, in row-major order.
+    virtual void read(const vector<int64_t> & offset, const vector<int64_t> & size, T * buffer) = 0;
+};
+
+// Reads elements stored in a file in row-major order, starting at byte offset,
+// in native byte order.
+
+class file_reader
+{
+public:
+    // Throws Error if the file can not be opened.
+    file_reader(const std::string & path);
+    ~file_reader();
+
+    file_reader(const file_reader &) = delete;
+    file_reader & operator=(const file_reader &) = delete;
+
+    // Throws Error if not all bytes can be read.
+    void read(int64_t offset, int64_t byte_count, void * buffer);
+
+private:
+    std::string m_path;
+    int m_fd = -1;
+};
+
+template <typename T>
+class file_tile_source : public tile_source<T>
+{
+public:
+    file_tile_source(const std::string & path, int64_t offset, const vector<int64_t> & size):
+        m_reader(path),
+        m_offset(offset),
+        m_size(size)
+    {}
+
+    void read(const vector<int64_t> & offset, const vector<int64_t> & size, T * buffer) override
+    {
+        int n_dim = size.size();
+        if (n_dim == 0)
+            return;
+
+        // Read one row of the innermost dimension at a time.
+
+        int64_t row_size = size[n_dim-1];
+        vector<int64_t> location(offset);
+
+        while(true)
+        {
+            int64_t index = flat_index(location, m_size);
+            m_reader.read(m_offset + index * sizeof(T), row_size * sizeof(T), buffer);
+            buffer += row_size;
+
+            int d = n_dim - 2;
+            for (; d >= 0; --d)
+            {
+                if (++location[d] < offset[d] + size[d])
+                    break;
+                location[d] = offset[d];
+            }
+            if (d < 0)
+                break;
+        }
+    }
+
+private:
+    file_reader m_reader;
+    int64_t m_offset;
+    vector<int64_t> m_size;
+};
+
+// An array stored as tiles of equal size, except at the upper edges.
+// Tiles are loaded from a tile_source when accessed,
+// and kept in a tile_cache.
+
+template <typename T>
+class tiled_array
+{
+public:
+    using tile_type = array<T>;
+    using tile_ptr = std::shared_ptr<tile_type>;
+
+    tiled_array(const vector<int64_t> & size, const vector<int64_t> & tile_size,
+                std::shared_ptr<tile_source<T>> source,
+                tile_cache & cache = tile_cache::global()):
+        m_id(tile_cache::new_array_id()),
+        m_size(size),
+        m_tile_size(tile_size),
+        m_tile_count(size.size()),
+        m_source(source),
+        m_cache(cache)
+    {
+        for (int d = 0; d < (int) m_size.size(); ++d)
+        {
+            m_tile_size[d] = std::max(int64_t(1), std::min(m_tile_size[d], m_size[d]));
+            m_tile_count[d] = (m_size[d] + m_tile_size[d] - 1) / m_tile_size[d];
+        }
+    }
+
+    ~tiled_array()
+    {
+        // Prefetch tasks use the cache.
+        std::unique_lock<std::mutex> lock(m_prefetch->mutex);
+        m_prefetch->done.wait(lock, [&]{ return m_prefetch->pending == 0; });
+
+        m_cache.remove(m_id);
+    }
+
+    tiled_array(const tiled_array &) = delete;
+    tiled_array & operator=(const tiled_array &) = delete;
+
+    const vector<int64_t> & size() const { return m_size; }
+
+    const vector<int64_t> & tile_size() const { return m_tile_size; }
+
+    // Number of tiles in each dimension.
+    const vector<int64_t> & tile_count() const { return m_tile_count; }
+
+    // Number of tiles to load in advance while iterating.
+    int prefetch_count() const { return m_prefetch_count; }
+    void set_prefetch_count(int count) { m_prefetch_count = count; }
+
+    // Offset of the tile at a location in the grid of tiles.
+    vector<int64_t> tile_offset(const vector<int64_t> & tile_location) const
+    {
+        vector<int64_t> offset(tile_location.size());
+        for (int d = 0; d < (int) offset.size(); ++d)
+            offset[d] = tile_location[d] * m_tile_size[d];
+        return offset;
+    }
+
+    // Size of the tile at a location in the grid of tiles.
+    vector<int64_t> tile_extent(const vector<int64_t> & tile_location) const
+    {
+        vector<int64_t> size(tile_location.size());
+        for (int d = 0; d < (int) size.size(); ++d)
+            size[d] = std::min(m_tile_size[d], m_size[d] - tile_location[d] * m_tile_size[d]);
+        return size;
+    }
+
+    // The tile at a location in the grid of tiles.
+    // Blocks while the tile is loaded.
+    tile_ptr tile(const vector<int64_t> & tile_location)
+    {
+        auto index = flat_index(tile_location, m_tile_count);
+        auto byte_size = flat_size(tile_extent(tile_location)) * sizeof(T);
+
+        auto t = m_cache.get(m_id, index, byte_size, loader(tile_location));
+
+        return std::static_pointer_cast<tile_type>(t);
+    }
+
+    // Starts loading the tile on the IO pool, unless it is cached.
+    void prefetch(const vector<int64_t> & tile_location)
+    {
+        auto index = flat_index(tile_location, m_tile_count);
+
+        if (m_cache.contains(m_id, index))
+            return;
+
+        auto byte_size = flat_size(tile_extent(tile_location)) * sizeof(T);
+        auto load = loader(tile_location);
+        auto id = m_id;
+        auto & cache = m_cache;
+        auto state = m_prefetch;
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            ++state->pending;
+        }
+
+        // Prefetching must not delay loading what is needed now,
+        // but work that is not needed at all stays less urgent.
+        static auto prefetch_priority = Reactive::make_priority(Reactive::Priority::prefetch);
+        auto priority = Reactive::Priority_Scope::current();
+        if (Reactive::Priority_Scope::current_priority() < Reactive::Priority::prefetch)
+            priority = prefetch_priority;
+        Reactive::Priority_Scope scope(priority);
+
+        io_pool().submit([=, &cache]()
+        {
+            try { cache.get(id, index, byte_size, load); }
+            catch (...) {}
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->pending == 0)
+                state->done.notify_all();
+        });
+    }
+
+    // Calls fn(block, block_offset) for the part of each tile
+    // that intersects the region at offset with size,
+    // in row-major order of tiles.
+    // The block is a region of the tile, and block_offset is
+    // the offset of the block within this array.
+    // Tiles following the current one are prefetched.
+    template <typename F>
+    void for_each_block(const vector<int64_t> & offset, const vector<int64_t> & size, F fn)
+    {
+        int n_dim = m_size.size();
+
+        if (n_dim == 0 || (int) offset.size() != n_dim || (int) size.size() != n_dim)
+            return;
+
+        for (auto s : size)
+        {
+            if (s < 1)
+                return;
+        }
+
+        vector<int64_t> first(n_dim);
+        vector<int64_t> last(n_dim);
+        for (int d = 0; d < n_dim; ++d)
+        {
+            first[d] = offset[d] / m_tile_size[d];
+            last[d] = (offset[d] + size[d] - 1) / m_tile_size[d];
+        }
+
+        auto next = [&](vector<int64_t> & location) -> bool
+        {
+            for (int d = n_dim - 1; d >= 0; --d)
+            {
+                if (++location[d] <= last[d])
+                    return true;
+                location[d] = first[d];
+            }
+            return false;
+        };
+
+        vector<int64_t> location = first;
+
+        // Tiles ahead of the current one
+        vector<int64_t> ahead = first;
+        int ahead_count = 0;
+        bool more_ahead = true;
+
+        do
+        {
+            while (more_ahead && ahead_count < m_prefetch_count)
+            {
+                more_ahead = next(ahead);
+                if (more_ahead)
+                {
+                    prefetch(ahead);
+                    ++ahead_count;
+                }
+            }
+            if (ahead_count > 0)
+                --ahead_count;
+
+            auto current = tile(location);
+
+            auto origin = tile_offset(location);
+            auto extent = tile_extent(location);
+
+            vector<int64_t> block_offset(n_dim);
+            vector<int64_t> block_size(n_dim);
+            vector<int64_t> offset_in_tile(n_dim);
+            for (int d = 0; d < n_dim; ++d)
+            {
+                int64_t start = std::max(offset[d], origin[d]);
+                int64_t end = std::min(offset[d] + size[d], origin[d] + extent[d]);
+                block_offset[d] = start;
+                block_size[d] = end - start;
+                offset_in_tile[d] = start - origin[d];
+            }
+
+            fn(get_region(*current, offset_in_tile, block_size), block_offset);
+        }
+        while(next(location));
+    }
+
+    // Reads the region at offset with size into a new array.
+    array<T> read(const vector<int64_t> & offset, const vector<int64_t> & size)
+    {
+        array<T> result(size);
+        T * dest = result.data();
+
+        int n_dim = size.size();
+
+        for_each_block(offset, size,
+                       [&](const array_region<T> & block, const vector<int64_t> & block_offset)
+        {
+            const auto & tile_offset = block.offset();
+            const auto & tile_size = block.size();
+
+            block.for_each_span([&](const array_span<T> & span)
+            {
+                // Spans may wrap across rows of the block,
+                // so copy one row at a time.
+
+                vector<int64_t> location = span.location;
+                vector<int64_t> dest_location(n_dim);
+
+                int64_t i = 0;
+                while (i < span.size)
+                {
+                    int64_t row_end = tile_offset[n_dim-1] + tile_size[n_dim-1];
+                    int64_t count = std::min(span.size - i, row_end - location[n_dim-1]);
+
+                    for (int d = 0; d < n_dim; ++d)
+                        dest_location[d] = location[d] - tile_offset[d] + block_offset[d] - offset[d];
+
+                    T * dest_row = dest + flat_index(dest_location, size);
+                    const T * src = span.data + i * span.stride;
+                    for (int64_t k = 0; k < count; ++k)
+                        dest_row[k] = src[k * span.stride];
+
+                    i += count;
+                    location[n_dim-1] += count;
+
+                    for (int d = n_dim - 1; d > 0; --d)
+                    {
+                        if (location[d] < tile_offset[d] + tile_size[d])
+                            break;
+                        location[d] = tile_offset[d];
+                        ++location[d-1];
+                    }
+                }
+            });
+        });
+
+        return result;
+    }
+
+private:
+    // Loads a tile without reference to this array,
+    // so it can outlive the array.
+    tile_cache::loader loader(const vector<int64_t> & tile_location) const
+    {
+        auto offset = tile_offset(tile_location);
+        auto size = tile_extent(tile_location);
+        auto source = m_source;
+
+        return [=]() -> tile_cache::tile_ptr
+        {
+            auto t = std::make_shared<tile_type>(size);
+            source->read(offset, size, t->data());
+            return t;
+        };
+    }
+
+    struct prefetch_state
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        int pending = 0;
+    };
+
+    uint64_t m_id;
+    vector<int64_t> m_size;
+    vector<int64_t> m_tile_size;
+    vector<int64_t> m_tile_count;
+    std::shared_ptr<tile_source<T>> m_source;
+    tile_cache & m_cache;
+    int m_prefetch_count = 2;
+    std::shared_ptr<prefetch_state> m_prefetch = std::make_shared<prefetch_state>();
+};
+
+}
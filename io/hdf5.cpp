@@ -1,10 +1,15 @@
 #include "hdf5.hpp"
 #include "../data/data_library.hpp"
 #include "../utility/threads.hpp"
+#include "../reactive/reactive.hpp"
+#include "../reactive/coroutine.hpp"
+#include "../reactive/trace.hpp"
+#include "../utility/error.hpp"
 
 #include <QFileInfo>
 
 #include <stdexcept>
+#include <mutex>
 
 using namespace H5;
 
@@ -45,7 +50,7 @@ array<T> read_hdf5(const string & file_path, const string & location)
     vector<hsize_t> file_data_size(dim_count);
     dataspace.getSimpleExtentDims(file_data_size.data());
 
-    vector<int> size(file_data_size.begin(), file_data_size.end());
+    vector<int64_t> size(file_data_size.begin(), file_data_size.end());
     datavis::array<T> array(size);
 
     dataset.read(array.data(), hdf5_type<T>::native_type());
@@ -167,21 +172,191 @@ vector<DataSet::Dimension> readDimensions(H5::DataSet & dataset)
     return dims;
 }
 
-DataSetPtr Hdf5Source::readDataset(string id, H5::DataSet & dataset)
+// Whether the data can be mapped from the file directly,
+// instead of being read.
+// This requires the data to be stored in one piece, without
+// compression or other filters, as doubles in native byte order.
+static
+bool canMap(H5::H5File & file, H5::DataSet & dataset)
+{
+    if (file.getCreatePlist().getUserblock() != 0)
+        return false;
+
+    auto plist = dataset.getCreatePlist();
+    if (plist.getLayout() != H5D_CONTIGUOUS)
+        return false;
+    if (plist.getNfilters() != 0 || plist.getExternalCount() != 0)
+        return false;
+
+    if (!(dataset.getDataType() == hdf5_type<double>::native_type()))
+        return false;
+
+    return dataset.getOffset() != HADDR_UNDEF;
+}
+
+// The HDF5 library is not thread-safe.
+// Data is read on the background thread, and tiles are read on the IO pool,
+// so these reads are serialized.
+static std::recursive_mutex & hdf5_mutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+// Reads tiles of a dataset.
+class Hdf5TileSource : public tile_source<double>
+{
+public:
+    Hdf5TileSource(std::shared_ptr<H5::H5File> file, const string & id):
+        m_file(file),
+        m_dataset(file->openDataSet(id))
+    {}
+
+    ~Hdf5TileSource()
+    {
+        std::lock_guard<std::recursive_mutex> lock(hdf5_mutex());
+        m_dataset.close();
+    }
+
+    void read(const vector<int64_t> & offset, const vector<int64_t> & size, double * buffer) override
+    {
+        Reactive::Trace_Span span("HDF5 tile read", "io");
+        span.set_bytes(flat_size(size) * int64_t(sizeof(double)));
+
+        std::lock_guard<std::recursive_mutex> lock(hdf5_mutex());
+
+        vector<hsize_t> start(offset.begin(), offset.end());
+        vector<hsize_t> count(size.begin(), size.end());
+
+        auto file_space = m_dataset.getSpace();
+        file_space.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+
+        H5::DataSpace memory_space(count.size(), count.data());
+
+        m_dataset.read(buffer, hdf5_type<double>::native_type(), memory_space, file_space);
+    }
+
+private:
+    std::shared_ptr<H5::H5File> m_file;
+    H5::DataSet m_dataset;
+};
+
+// Size of tiles if the data should be loaded in tiles,
+// otherwise an empty vector.
+// Chunked data larger than a quarter of the tile memory budget
+// is loaded in tiles the size of chunks.
+static
+vector<int64_t> tileSize(H5::DataSet & dataset, const vector<int64_t> & size)
 {
+    auto plist = dataset.getCreatePlist();
+    if (plist.getLayout() != H5D_CHUNKED)
+        return {};
+
+    if (flat_size(size) * sizeof(double) < tile_cache::global().budget() / 4)
+        return {};
+
+    vector<hsize_t> chunk_size(size.size());
+    plist.getChunk(chunk_size.size(), chunk_size.data());
+
+    return vector<int64_t>(chunk_size.begin(), chunk_size.end());
+}
+
+// Number of elements read at once when reading an entire dataset,
+// so that cancellation is noticed in between.
+static const int64_t read_block_element_count = 1 << 22;
+
+// Reads an entire dataset in blocks along the first dimension.
+static
+void readAll(H5::DataSet & dataset, const vector<int64_t> & size, double * buffer,
+             Reactive::Status & status)
+{
+    int64_t count = flat_size(size);
+
+    Reactive::Trace_Span span("HDF5 read", "io");
+    span.set_bytes(count * int64_t(sizeof(double)));
+
+    if (size.empty() || count <= read_block_element_count)
+    {
+        dataset.read(buffer, hdf5_type<double>::native_type());
+        return;
+    }
+
+    int64_t row_size = count / size[0];
+    int64_t rows_per_block = std::max(int64_t(1), read_block_element_count / row_size);
+
+    auto file_space = dataset.getSpace();
+
+    for (int64_t row = 0; row < size[0]; row += rows_per_block)
+    {
+        // Only checks for cancellation, without yielding to more urgent work,
+        // because the HDF5 lock is held meanwhile, and that work may need it.
+        status.check();
+
+        vector<hsize_t> start(size.size(), 0);
+        vector<hsize_t> block_size(size.begin(), size.end());
+        start[0] = row;
+        block_size[0] = std::min(rows_per_block, size[0] - row);
+
+        file_space.selectHyperslab(H5S_SELECT_SET, block_size.data(), start.data());
+
+        H5::DataSpace memory_space(block_size.size(), block_size.data());
+
+        dataset.read(buffer + row * row_size, hdf5_type<double>::native_type(),
+                     memory_space, file_space);
+
+        int64_t rows_read = row + block_size[0];
+        status.report_progress(double(rows_read) / size[0],
+                               rows_read * row_size * int64_t(sizeof(double)), "Reading");
+    }
+}
+
+DataSetPtr Hdf5Source::readDataset(string id, std::shared_ptr<H5::H5File> file, const string & file_path,
+                                   Reactive::Status & status)
+{
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex());
+
+    auto dataset = file->openDataSet(id);
+
     auto dataspace = dataset.getSpace();
     if (!dataspace.isSimple())
         throw std::runtime_error("Data space is not simple.");
 
     auto dimensions = readDimensions(dataset);
 
-    vector<int> object_size;
+    vector<int64_t> object_size;
     for (auto & dim : dimensions)
         object_size.push_back(dim.size);
 
-    auto client_dataset = make_shared<DataSet>(id, object_size);
+    DataSetPtr client_dataset;
 
-    dataset.read(client_dataset->data()->data(), hdf5_type<double>::native_type());
+    auto tile_size = tileSize(dataset, object_size);
+
+    if (!tile_size.empty())
+    {
+        vector<std::shared_ptr<tiled_array<double>>> data;
+        data.push_back(std::make_shared<tiled_array<double>>
+                       (object_size, tile_size, std::make_shared<Hdf5TileSource>(file, id)));
+        client_dataset = make_shared<DataSet>(id, std::move(data));
+    }
+    else if (canMap(*file, dataset))
+    {
+        try
+        {
+            auto data = map_array<double>(file_path, dataset.getOffset(), object_size);
+            client_dataset = make_shared<DataSet>(id, std::move(data));
+        }
+        catch (Error & e)
+        {
+            cerr << "Failed to map dataset " << id << ": " << e.what() << endl;
+        }
+    }
+
+    if (!client_dataset)
+    {
+        datavis::array<double> data(object_size);
+        readAll(dataset, object_size, data.data(), status);
+        client_dataset = make_shared<DataSet>(id, std::move(data));
+    }
 
     for (int d = 0; d < dimensions.size(); ++d)
     {
@@ -263,48 +438,66 @@ FutureDataset Hdf5Source::dataset(const string & id)
     if (!d_infos.count(id))
         return nullptr;
 
+    auto cache = datasetCache();
+
+    if (cache)
+    {
+        if (auto dataset = cache->find(this, id))
+            return dataset;
+    }
+
+    // Still in use, but dropped from the cache.
     {
         auto dataset = d_datasets[id].lock();
-        if (dataset) return dataset;
+        if (dataset)
+        {
+            if (cache)
+                cache->insert(this, id, dataset);
+            return dataset;
+        }
     }
 
-    auto file = m_file;
+    auto & gui = Reactive::Qt_Executor::for_thread(QThread::currentThread());
 
-    auto raw_dataset = Reactive::apply(background_thread(), [file, id](Reactive::Status &)
-    {
-        printf("HDF5: Reading data...\n");
+    auto dataset = load(io_pool(), gui, id, m_file, m_file_path);
 
-        // NOTE: Using file is safe, because:
-        // - Only one thread at a time uses it
-        // - It is a shared pointer, so it will live after this object dies.
-        auto hdf_dataset = file->openDataSet(id);
-        auto dataset = readDataset(id, hdf_dataset);
-        return dataset;
-    });
+    d_datasets[id] = dataset;
 
-    auto prepared_dataset = Reactive::apply([=](Reactive::Status &, DataSetPtr dataset)
-    {
-        printf("HDF5: Preparing dataset...\n");
+    if (cache)
+        cache->insert(this, id, dataset);
 
-        dataset->setSource(this);
+    return dataset;
+}
 
-        for (int d = 0; d < dataset->dimensionCount(); ++d)
-        {
-            string name = dataset->dimension(d).name;
-            DimensionPtr gdim = library()->dimension(name);
-            if (gdim)
-                dataset->setGlobalDimension(d, gdim);
-        }
+FutureDataset Hdf5Source::load(Reactive::Executor & io, Reactive::Executor & gui,
+                               string id, std::shared_ptr<H5::H5File> file, string file_path)
+{
+    Reactive::Status & status = co_await Reactive::current_status;
+
+    printf("HDF5: Reading data...\n");
 
-        printf("HDF5: Dataset ready.\n");
+    // NOTE: Using file is safe, because:
+    // - Only one thread at a time uses it
+    // - It is a shared pointer, so it will live after this object dies.
+    auto dataset = readDataset(id, file, file_path, status);
 
-        return dataset;
-    },
-    raw_dataset);
+    co_await Reactive::resume_on(gui);
+
+    printf("HDF5: Preparing dataset...\n");
+
+    dataset->setSource(this);
+
+    for (int d = 0; d < dataset->dimensionCount(); ++d)
+    {
+        string name = dataset->dimension(d).name;
+        DimensionPtr gdim = library()->dimension(name);
+        if (gdim)
+            dataset->setGlobalDimension(d, gdim);
+    }
 
-    d_datasets[id] = prepared_dataset;
+    printf("HDF5: Dataset ready.\n");
 
-    return prepared_dataset;
+    co_return dataset;
 }
 
 }
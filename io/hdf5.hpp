@@ -26,12 +26,19 @@ public:
     virtual FutureDataset dataset(const string & id) override;
 
 private:
-    static DataSetPtr readDataset(string id, H5::DataSet & dataset);
+    // Reads on io, then connects the data set to this source on gui.
+    FutureDataset load(Reactive::Executor & io, Reactive::Executor & gui,
+                       string id, std::shared_ptr<H5::H5File>, string file_path);
+
+    // Throws Reactive::Cancelled if cancelled while reading.
+    static DataSetPtr readDataset(string id, std::shared_ptr<H5::H5File>, const string & file_path,
+                                  Reactive::Status &);
 
     string m_file_path;
     string m_name;
     std::shared_ptr<H5::H5File> m_file;
     std::unordered_map<string, DataSetInfo> d_infos;
+    // Data sets in use, even if dropped from the library's cache.
     std::unordered_map<string, FutureDataset::weak_type> d_datasets;
 };
 
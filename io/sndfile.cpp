@@ -2,6 +2,9 @@
 #include "../data/data_library.hpp"
 #include "../utility/error.hpp"
 #include "../utility/threads.hpp"
+#include "../reactive/reactive.hpp"
+#include "../reactive/coroutine.hpp"
+#include "../reactive/trace.hpp"
 
 #include <QFileInfo>
 
@@ -53,7 +56,9 @@ void SoundFileSource::getInfo()
     sf_close(file);
 }
 
-SoundFileSource::Read_Result SoundFileSource::read_file(const string & file_path)
+SoundFileSource::Read_Result SoundFileSource::read_file(const string & file_path,
+                                                       DataSource * source,
+                                                       Reactive::Status & status)
 {
     SF_INFO sf_info;
     sf_info.format = 0;
@@ -66,7 +71,10 @@ SoundFileSource::Read_Result SoundFileSource::read_file(const string & file_path
 
     auto info = datavis::getInfo(sf_info);
 
-    vector<int> data_size = { int(sf_info.frames) };
+    Reactive::Trace_Span span("Sound decode", "io");
+    span.set_bytes(int64_t(sf_info.frames) * sf_info.channels * int64_t(sizeof(double)));
+
+    vector<int64_t> data_size = { int64_t(sf_info.frames) };
     int attribute_count = sf_info.channels;
 
     auto dataset = make_shared<DataSet>(info.id, data_size, attribute_count);
@@ -90,6 +98,16 @@ SoundFileSource::Read_Result SoundFileSource::read_file(const string & file_path
 
     for (sf_count_t f = 0; f < sf_info.frames; f += batch_size)
     {
+        try
+        {
+            status.yield();
+        }
+        catch (Reactive::Cancelled &)
+        {
+            sf_close(file);
+            throw;
+        }
+
         auto read_frames = sf_readf_double(file, buffer.data(), batch_size);
         if (read_frames < batch_size && dest_frame + read_frames < sf_info.frames)
         {
@@ -105,6 +123,19 @@ SoundFileSource::Read_Result SoundFileSource::read_file(const string & file_path
                 dataset->data(c).data()[dest_frame] = buffer[buffer_index];
             }
         }
+
+        status.report_progress(double(dest_frame) / sf_info.frames,
+                               int64_t(dest_frame * sf_info.channels * sizeof(double)),
+                               "Decoding");
+
+        // Publish the frames decoded so far as a view,
+        // which does not copy and is not affected by further decoding.
+        if (status.partial_due() && dest_frame > 0)
+        {
+            auto partial = dataset->view(info.id, { { 0, 0, 1, int64_t(dest_frame) } });
+            partial->setSource(source);
+            status.publish_partial(partial);
+        }
     }
 
 end:
@@ -116,41 +147,53 @@ end:
     return result;
 }
 
-//DataSetPtr SoundFileSource::dataset(int index)
 FutureDataset SoundFileSource::dataset(const string & id)
 {
-    if (m_dataset)
-        return m_dataset;
+    auto cache = datasetCache();
 
-    auto reading = Reactive::apply(background_thread(), [=](Reactive::Status&)
+    if (cache)
     {
-        return read_file(m_file_path);
-    });
+        if (auto dataset = cache->find(this, id))
+            return dataset;
+    }
 
-    m_dataset = Reactive::apply([=](Reactive::Status&, const Read_Result & result)
-    {
-        // FIXME: Notify anyone about potentially updated info?
-        m_info = result.info;
+    auto & gui = Reactive::Qt_Executor::for_thread(QThread::currentThread());
 
-        auto & dataset = result.dataset;
+    auto dataset = load(io_pool(), gui, m_file_path);
 
-        dataset->setSource(this);
+    if (cache)
+        cache->insert(this, id, dataset);
 
-        for (int d = 0; d < dataset->dimensionCount(); ++d)
-        {
-            const auto & name = dataset->dimension(d).name;
-            DimensionPtr gdim = library()->dimension(name);
-            if (gdim)
-                dataset->setGlobalDimension(d, gdim);
-        }
+    return dataset;
+}
+
+FutureDataset SoundFileSource::load(Reactive::Executor & io, Reactive::Executor & gui,
+                                    string file_path)
+{
+    Reactive::Status & status = co_await Reactive::current_status;
+
+    auto result = read_file(file_path, this, status);
 
-        printf("SoundFileSource: dataset ready.\n");
+    co_await Reactive::resume_on(gui);
+
+    // FIXME: Notify anyone about potentially updated info?
+    m_info = result.info;
+
+    auto & dataset = result.dataset;
+
+    dataset->setSource(this);
+
+    for (int d = 0; d < dataset->dimensionCount(); ++d)
+    {
+        const auto & name = dataset->dimension(d).name;
+        DimensionPtr gdim = library()->dimension(name);
+        if (gdim)
+            dataset->setGlobalDimension(d, gdim);
+    }
 
-        return dataset;
-    },
-    reading);
+    printf("SoundFileSource: dataset ready.\n");
 
-    return m_dataset;
+    co_return dataset;
 }
 
 }
@@ -31,12 +31,17 @@ private:
         DataSetPtr dataset;
     };
 
-    static Read_Result read_file(const string & file_path);
+    // Reads on io, then connects the data set to this source on gui.
+    FutureDataset load(Reactive::Executor & io, Reactive::Executor & gui, string file_path);
+
+    // Publishes partial data sets with the given source.
+    // Throws Reactive::Cancelled if cancelled while reading.
+    static Read_Result read_file(const string & file_path, DataSource * source,
+                                 Reactive::Status &);
 
     string m_file_path;
     string m_name;
     DataSetInfo m_info;
-    FutureDataset m_dataset;
 };
 
 }
@@ -1,5 +1,8 @@
 #include "text.hpp"
 #include "../data/data_library.hpp"
+#include "../reactive/reactive.hpp"
+#include "../reactive/trace.hpp"
+#include "../utility/threads.hpp"
 #include "../utility/error.hpp"
 #include "../json/json.hpp"
 
@@ -238,20 +241,42 @@ DataSetInfo TextSource::inferInfo() const
 
 FutureDataset TextSource::dataset(const string & id)
 {
-    // FIXME: Make asynchronous
+    auto cache = datasetCache();
 
-    if (!m_dataset)
-        m_dataset = getData();
+    if (cache)
+    {
+        if (auto dataset = cache->find(this, id))
+            return dataset;
+    }
+
+    auto file_path = m_file_path;
+
+    auto raw_dataset = Reactive::apply(io_pool(), [file_path](Reactive::Status &)
+    {
+        return readData(file_path);
+    });
+
+    auto dataset = Reactive::apply([=, this](Reactive::Status &, DataSetPtr dataset)
+    {
+        dataset->setSource(this);
+        return dataset;
+    },
+    raw_dataset);
 
-    return Reactive::value<DataSetPtr>(m_dataset);
+    if (cache)
+        cache->insert(this, id, dataset);
+
+    return dataset;
 }
 
-DataSetPtr TextSource::getData()
+DataSetPtr TextSource::readData(const string & file_path)
 {
+    Reactive::Trace_Span span("Text read", "io");
+
     vector<string> lines;
 
     {
-        ifstream file(m_file_path);
+        ifstream file(file_path);
         if (!file.is_open())
             throw Error("Failed to open file.");
 
@@ -275,9 +300,8 @@ DataSetPtr TextSource::getData()
     size_t record_count = lines.size();
     if (has_field_names) record_count -= 1;
 
-    vector<int> data_size { int(record_count) };
+    vector<int64_t> data_size { int64_t(record_count) };
     auto dataset = make_shared<DataSet>("data", data_size, format.count);
-    dataset->setSource(this);
 
     if (has_field_names)
     {
@@ -300,6 +324,8 @@ DataSetPtr TextSource::getData()
         }
     }
 
+    span.set_bytes(dataset->memorySize());
+
     return dataset;
 }
 
@@ -326,13 +352,33 @@ DataSetInfo TextPackageSource::dataset_info(const string & id) const
 
 FutureDataset TextPackageSource::dataset(const string & id)
 {
-    // FIXME: Make asynchronous
+    auto cache = datasetCache();
+
+    if (cache)
+    {
+        if (auto dataset = cache->find(this, id))
+            return dataset;
+    }
+
+    auto dir_path = m_dir_path;
+    auto member = m_members.at(id);
+
+    auto raw_dataset = Reactive::apply(io_pool(), [dir_path, member](Reactive::Status &)
+    {
+        return readDataSet(dir_path, member);
+    });
+
+    auto dataset = Reactive::apply([=, this](Reactive::Status &, DataSetPtr dataset)
+    {
+        prepareDataSet(member, dataset);
+        return dataset;
+    },
+    raw_dataset);
 
-    auto & member = m_members.at(id);
-    if (!member.dataset)
-        loadDataSet(member);
+    if (cache)
+        cache->insert(this, id, dataset);
 
-    return Reactive::value<DataSetPtr>(member.dataset);
+    return dataset;
 }
 
 using nlohmann::json;
@@ -475,10 +521,12 @@ void TextPackageSource::parseDescriptor()
     }
 }
 
-void TextPackageSource::loadDataSet(Member & member)
+DataSetPtr TextPackageSource::readDataSet(const string & dir_path, const Member & member)
 {
+    Reactive::Trace_Span span("Text read", "io");
+
     // FIXME:
-    string path = m_dir_path + '/' + member.path;
+    string path = dir_path + '/' + member.path;
 
     vector<string> lines;
 
@@ -509,14 +557,13 @@ void TextPackageSource::loadDataSet(Member & member)
 
     // Create DataSet
 
-    vector<int> data_size;
+    vector<int64_t> data_size;
     for (int i = 0; i < member.info.dimensions.size(); ++i)
     {
         data_size.push_back(member.info.dimensions[i].size);
     }
 
     auto dataset = make_shared<DataSet>(member.path, data_size, member.info.attributes.size());
-    dataset->setSource(this);
 
     for (int i = 0; i < member.info.attributes.size(); ++i)
     {
@@ -524,17 +571,7 @@ void TextPackageSource::loadDataSet(Member & member)
     }
     for (int i = 0; i < member.info.dimensions.size(); ++i)
     {
-        const auto & dim = member.info.dimensions[i];
-
-        dataset->setDimension(i, dim);
-
-        DimensionPtr gdim = library()->dimension(dim.name);
-        if (gdim)
-        {
-            cout << "TextPackageSource: Setting global dimension: " << dim.name << endl;
-            dataset->setGlobalDimension(i, gdim);
-        }
-
+        dataset->setDimension(i, member.info.dimensions[i]);
     }
 
     // Fill DataSet with data
@@ -551,7 +588,26 @@ void TextPackageSource::loadDataSet(Member & member)
         }
     }
 
-    member.dataset = dataset;
+    span.set_bytes(dataset->memorySize());
+
+    return dataset;
+}
+
+void TextPackageSource::prepareDataSet(const Member & member, const DataSetPtr & dataset)
+{
+    dataset->setSource(this);
+
+    for (int i = 0; i < member.info.dimensions.size(); ++i)
+    {
+        const auto & dim = member.info.dimensions[i];
+
+        DimensionPtr gdim = library()->dimension(dim.name);
+        if (gdim)
+        {
+            cout << "TextPackageSource: Setting global dimension: " << dim.name << endl;
+            dataset->setGlobalDimension(i, gdim);
+        }
+    }
 }
 
 }
@@ -30,11 +30,11 @@ public:
 
 private:
     DataSetInfo inferInfo() const;
-    DataSetPtr getData();
+    // Runs on the IO pool, so it must not use the source.
+    static DataSetPtr readData(const string & file_path);
 
     string m_file_path;
     string m_name;
-    DataSetPtr m_dataset;
 };
 
 class TextSourceParser
@@ -78,12 +78,14 @@ public:
         string path;
         TextSourceParser::Format format;
         DataSetInfo info;
-        DataSetPtr dataset = nullptr;
     };
 
 private:
     void parseDescriptor();
-    void loadDataSet(Member&);
+    // Runs on the IO pool, so it must not use the source.
+    static DataSetPtr readDataSet(const string & dir_path, const Member &);
+    // Connects a loaded data set to the source and library.
+    void prepareDataSet(const Member &, const DataSetPtr &);
 
     string m_dir_path;
     string m_file_path;
@@ -1,5 +1,8 @@
 #include "heat_map.hpp"
 #include "../utility/threads.hpp"
+#include "../data/reduction.hpp"
+#include "../data/parallel.hpp"
+#include "../reactive/trace.hpp"
 
 #include <QPainter>
 #include <QPainterPath>
@@ -27,10 +30,14 @@ json HeatMap::save()
 
 void HeatMap::setDataSet(FutureDataset dataset, const vector_t & dim)
 {
+    Reactive::Priority_Scope priority_scope(priority());
+
     // Clear current data
 
     d_prepration = nullptr;
     d_plot_data = nullptr;
+    d_image = nullptr;
+    d_on_image = nullptr;
     m_dataset = nullptr;
 
     emit xRangeChanged();
@@ -44,20 +51,19 @@ void HeatMap::setDataSet(FutureDataset dataset, const vector_t & dim)
     auto plot_data = make_shared<PlotData>();
     plot_data->dimensions = dim;
 
-    auto preparePlot = [=](Reactive::Status&, DataSetPtr dataset) -> PlotDataPtr
+    auto preparePlot = [=](Reactive::Status & status, DataSetPtr dataset) -> PlotDataPtr
     {
         printf("HeatMap: Preparing...\n");
 
         plot_data->dataset = dataset;
         plot_data->update_selected_region();
         plot_data->update_value_range();
-        plot_data->generate_image();
         return plot_data;
     };
 
-    d_plot_data = Reactive::apply(background_thread(), preparePlot, dataset);
+    d_plot_data = Reactive::apply(compute_pool(), preparePlot, dataset);
 
-    d_prepration = Reactive::apply([=](Reactive::Status&, PlotDataPtr plot_data)
+    d_prepration = Reactive::apply([=, this](Reactive::Status&, PlotDataPtr plot_data)
     {
         m_dataset = plot_data->dataset;
         connect(m_dataset.get(), &DataSet::selectionChanged,
@@ -71,6 +77,8 @@ void HeatMap::setDataSet(FutureDataset dataset, const vector_t & dim)
         emit xRangeChanged();
         emit yRangeChanged();
         emit contentChanged();
+
+        requestImage();
     },
     d_plot_data);
 }
@@ -100,7 +108,7 @@ void HeatMap::setDataSet(DataSetPtr dataset, const vector_t & dims)
         connect(m_dataset.get(), &DataSet::selectionChanged,
                 this, &HeatMap::onSelectionChanged);
 
-        auto size = dataset->data()->size();
+        auto size = dataset->size();
 
         m_dim = dims;
 
@@ -131,7 +139,7 @@ void HeatMap::setDimensions(const vector_t & dims)
     if (m_dim == dims)
         return;
 
-    auto data_size = m_dataset->data()->size();
+    auto data_size = m_dataset->size();
 
     m_dim = dims;
     m_start = { 0, 0 };
@@ -160,31 +168,70 @@ void HeatMap::onSelectionChanged()
     if (!m_dataset)
         return;
 
-    auto old_region = d_plot_data->value->data_region;
+    auto old_offset = d_plot_data->value->slice_offset;
 
     d_plot_data->value->update_selected_region();
 
-    if (old_region != d_plot_data->value->data_region)
+    if (old_offset != d_plot_data->value->slice_offset)
     {
-        // FIXME: Do this asynchronously
-        d_plot_data->value->generate_image();
-        emit contentChanged();
+        requestImage();
     }
 }
 
+void HeatMap::requestImage()
+{
+    Reactive::Priority_Scope priority_scope(priority());
+
+    auto plot_data = d_plot_data->value;
+
+    if (!plot_data->has_slice())
+        return;
+
+    // Image generation keeps what it uses alive,
+    // so the selection may change meanwhile.
+
+    auto dataset = plot_data->dataset;
+    auto offset = plot_data->slice_offset;
+    auto size = plot_data->slice_size;
+    auto dimensions = plot_data->dimensions;
+    auto value_range = plot_data->value_range;
+
+    auto start = [=]()
+    {
+        return Reactive::apply(compute_pool(), [=](Reactive::Status & status)
+        {
+            return generate_image(*dataset, offset, size, dimensions, value_range, &status);
+        });
+    };
+
+    auto cost = [](const QImage & image)
+    {
+        return size_t(image.bytesPerLine()) * image.height();
+    };
+
+    d_image = memo_cache::global().get<QImage>(plot_data->image_key(), start, cost);
+
+    d_on_image = Reactive::apply([=, this](Reactive::Status&, const QImage & image)
+    {
+        plot_data->pixmap = QPixmap::fromImage(image);
+        emit contentChanged();
+    },
+    d_image);
+}
+
 void HeatMap::PlotData::update_selected_region()
 {
+    slice_offset.clear();
+    slice_size.clear();
+
     if (!dataset)
-    {
-        data_region = data_region_type();
         return;
-    }
 
-    auto data_size = dataset->data()->size();
+    auto data_size = dataset->size();
     auto data_dim_count = data_size.size();
 
-    vector<int> offset = dataset->selectedIndex();
-    vector<int> size(data_dim_count, 1);
+    vector<int64_t> offset = dataset->selectedIndex();
+    vector<int64_t> size(data_dim_count, 1);
 
     for (int d = 0; d < 2; ++d)
     {
@@ -192,7 +239,6 @@ void HeatMap::PlotData::update_selected_region()
         if (data_dim < 0 || data_dim >= data_dim_count)
         {
             cerr << "Selected dimension is invalid: " << data_dim << endl;
-            data_region = data_region_type();
             return;
         }
 
@@ -200,73 +246,141 @@ void HeatMap::PlotData::update_selected_region()
         size[data_dim] = data_size[data_dim];
     }
 
-    data_region = get_region(*dataset->data(), offset, size);
+    // The data is only read when generating the image,
+    // from tiles for a tiled data set.
+    slice_offset = offset;
+    slice_size = size;
 }
 
 void HeatMap::PlotData::update_value_range()
 {
-    if (!data_region.is_valid())
+    if (!has_slice())
         return;
 
     // qDebug() << "Computing value range.";
 
-    double min = 0;
-    double max = 0;
-
-    auto it = data_region.begin();
-    if (it != data_region.end())
-    {
-        min = max = (*it).value();
-        while(++it != data_region.end())
-        {
-            auto value = (*it).value();
-            min = std::min(value, min);
-            max = std::max(value, max);
-        }
-    }
-
-    value_range = Range(min, max);
+    // Shared with other plots of the same slice
+    auto extent = dataset->statistics(0, slice_offset, slice_size).extent;
+    if (extent.is_empty())
+        value_range = Range();
+    else
+        value_range = Range(extent.min, extent.max);
 
     // qDebug() << "Done computing value range.";
 }
 
-void HeatMap::PlotData::generate_image()
+memo_key HeatMap::PlotData::image_key() const
+{
+    memo_key key;
+    key.source = dataset->cacheId();
+    key.offset = slice_offset;
+    key.size = slice_size;
+    key.operation = "heat-map-image";
+    key.parameters = { double(dimensions[0]), double(dimensions[1]),
+                       value_range.min, value_range.max };
+    return key;
+}
+
+QImage HeatMap::generate_image(DataSet & dataset, const vector<int64_t> & offset,
+                               const vector<int64_t> & size, const vector_t & dimensions,
+                               const Range & value_range,
+                               const Reactive::Status * status)
 {
     // qDebug() << "Generating image";
 
-    if (!data_region.is_valid())
-    {
-        return;
-    }
+    int width = size[dimensions[0]];
+    int height = size[dimensions[1]];
+
+    Reactive::Trace_Span span("Heat map image", "compute");
+    span.set_bytes(flat_size(size) * int64_t(sizeof(double)));
 
     double value_extent = value_range.extent();
     double value_scale = value_extent != 0 ? 1 / value_extent : 1;
     double value_offset = -value_range.min;
 
-    int width = dataset->dimension(dimensions[0]).size;
-    int height = dataset->dimension(dimensions[1]).size;
     QImage image(width, height, QImage::Format_RGB888);
 
-    for (auto & element : data_region)
+    // Pixels are written directly, from several threads at once,
+    // so make sure the image data is detached beforehand.
+
+    uchar * bits = image.bits();
+    int bytes_per_line = image.bytesPerLine();
+
+    // Spans run along the inner one of the two dimensions
+    // and possibly wrap around into the outer one.
+
+    bool x_is_inner = dimensions[0] > dimensions[1];
+    int inner_dim = x_is_inner ? dimensions[0] : dimensions[1];
+    int outer_dim = x_is_inner ? dimensions[1] : dimensions[0];
+
+    // Writes the pixels of a block, whose locations plus shift
+    // are locations in the data set.
+    auto write_block = [&](const data_region_type & block, const vector<int64_t> & shift)
     {
-        auto loc = element.location();
-        int x = loc[dimensions[0]];
-        int y = image.height() - 1 - loc[dimensions[1]];
+        parallel_for(block, [&](const data_region_type & part)
+        {
+            if (status)
+                status->yield();
+
+            int64_t inner_begin = part.offset()[inner_dim];
+            int64_t inner_end = inner_begin + part.size()[inner_dim];
 
-        double v = element.value();
-        v += value_offset;
-        v *= value_scale;
+            for_each_span(part, [&](const array_span<double> & span)
+            {
+                int64_t inner = span.location[inner_dim];
+                int64_t outer = span.location[outer_dim];
+
+                const double * data = span.data;
+
+                for (int i = 0; i < span.size; ++i)
+                {
+                    double v = data[i * span.stride];
+                    v += value_offset;
+                    v *= value_scale;
+
+                    uchar c = uchar(255 * v);
 
-        int c = 255 * v;
+                    int x = int((x_is_inner ? inner : outer) + shift[dimensions[0]]);
+                    int y = int((x_is_inner ? outer : inner) + shift[dimensions[1]]);
 
-        image.setPixel(x,y,qRgb(c,c,c));
+                    uchar * pixel = bits + (height - 1 - y) * bytes_per_line + x * 3;
+                    pixel[0] = pixel[1] = pixel[2] = c;
+
+                    if (++inner == inner_end)
+                    {
+                        inner = inner_begin;
+                        ++outer;
+                    }
+                }
+            });
+        });
+    };
+
+    if (dataset.isTiled())
+    {
+        dataset.tiledData(0).for_each_block(offset, size,
+                                            [&](const data_region_type & block,
+                                                const vector<int64_t> & block_offset)
+        {
+            vector<int64_t> shift(block_offset.size());
+            for (int d = 0; d < int(shift.size()); ++d)
+                shift[d] = block_offset[d] - block.offset()[d];
+
+            write_block(block, shift);
+        });
     }
+    else
+    {
+        auto region = dataset.region(0, offset, size);
+        if (!region.is_valid())
+            return QImage();
 
-    // qDebug() << "Image generated.";
+        write_block(region, vector<int64_t>(size.size(), 0));
+    }
 
-    pixmap = QPixmap::fromImage(image);
+    // qDebug() << "Image generated.";
 
-    // qDebug() << "Pixmap generated.";
+    return image;
 }
 
 Plot::Range HeatMap::xRange()
@@ -306,7 +420,7 @@ tuple<vector<double>, vector<double>> HeatMap::dataLocation(const QPointF & poin
     if (!m_dataset)
         return {};
 
-    auto offset = d_plot_data->value->data_region.offset();
+    auto offset = m_dataset->selectedIndex();
 
     vector<double> location(m_dataset->dimensionCount(), 0);
 
@@ -321,7 +435,7 @@ tuple<vector<double>, vector<double>> HeatMap::dataLocation(const QPointF & poin
 
     auto index = m_dataset->indexForPoint(location);
 
-    auto size = m_dataset->data()->size();
+    auto size = m_dataset->size();
     bool in_bounds = true;
     for (int d = 0; d < size.size(); ++d)
         in_bounds &= (index[d] >= 0 && index[d] < size[d]);
@@ -332,7 +446,7 @@ tuple<vector<double>, vector<double>> HeatMap::dataLocation(const QPointF & poin
     {
         for (int a = 0; a < m_dataset->attributeCount(); ++a)
         {
-            attributes[a] = m_dataset->data(0)(index);
+            attributes[a] = m_dataset->value(a, index);
         }
     }
 
@@ -344,6 +458,8 @@ void HeatMap::plot(QPainter * painter,  const Mapping2d & transform, const QRect
     if (!m_dataset)
         return;
 
+    Reactive::Trace_Span span("Heat map", "plot");
+
     painter->save();
 
     auto x_range = xRange();
@@ -11,6 +11,7 @@
 #include "../data/array.hpp"
 #include "../data/data_set.hpp"
 #include "../data/data_source.hpp"
+#include "../data/memo_cache.hpp"
 #include "../reactive/reactive.hpp"
 
 namespace datavis {
@@ -47,18 +48,36 @@ private:
     {
         vector_t dimensions;
         DataSetPtr dataset;
-        data_region_type data_region;
+        // Selected slice: the region at offset with size,
+        // at the selected index of the other dimensions.
+        // Empty if the dimensions are invalid.
+        vector<int64_t> slice_offset;
+        vector<int64_t> slice_size;
         Range value_range;
         QPixmap pixmap;
 
+        bool has_slice() const { return !slice_size.empty(); }
+
         void update_selected_region();
         void update_value_range();
-        void generate_image();
+        // Identifies the image of the selected region in memo_cache.
+        memo_key image_key() const;
     };
 
     using PlotDataPtr = std::shared_ptr<PlotData>;
 
+    // Generates the image of the slice at offset with size.
+    // Reads a tiled data set's slice from tiles, one block at a time.
+    // Throws Reactive::Cancelled if the status is cancelled meanwhile.
+    static QImage generate_image(DataSet & dataset, const vector<int64_t> & offset,
+                                 const vector<int64_t> & size, const vector_t & dimensions,
+                                 const Range & value_range,
+                                 const Reactive::Status * status = nullptr);
+
     void onSelectionChanged();
+    // Requests the image of the selected region,
+    // from memo_cache if another plot already generated it.
+    void requestImage();
 
     struct
     {
@@ -68,6 +87,8 @@ private:
 
     Reactive::Value<PlotDataPtr> d_plot_data;
     Reactive::Value<void> d_prepration;
+    Reactive::Value<QImage> d_image;
+    Reactive::Value<void> d_on_image;
 
     DataSetPtr m_dataset = nullptr;
 
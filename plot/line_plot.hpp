@@ -3,12 +3,14 @@
 #include <QTransform>
 
 #include "plot.hpp"
+#include "selected_lines.hpp"
 #include "../data/array.hpp"
 #include "../data/data_set.hpp"
 #include "../data/data_source.hpp"
 
 #include <list>
 #include <vector>
+#include <memory>
 
 namespace datavis {
 
@@ -31,9 +33,10 @@ public:
     QColor color() const { return m_color; }
     void setColor(const QColor & c);
 
-    virtual bool isEmpty() const override { return !m_data_region.is_valid(); }
+    virtual bool isEmpty() const override { return m_line.isEmpty(); }
     virtual Range xRange() override;
     virtual Range yRange() override;
+    virtual Range visibleYRange(const Range & xRange) override;
     virtual tuple<vector<double>, vector<double>> dataLocation(const QPointF & point) override;
     virtual void plot(QPainter *,  const Mapping2d &, const QRectF & region) override;
 
@@ -46,28 +49,9 @@ signals:
     void colorChanged();
 
 private:
-    struct DataRange
-    {
-        DataRange() {}
-        DataRange(double min, double max): min(min), max(max) {}
-        double min = 0;
-        double max = 0;
-    };
-
-    struct DataCache
-    {
-        int block_size = 0;
-        vector<DataRange> data;
-    };
-
+    void onPartialDataSet(DataSetPtr) override;
+    void prepareDataSet(DataSetPtr);
     void onSelectionChanged();
-    static Range findEntireValueRange(DataSetPtr);
-    void update_selected_region();
-    data_region_type getDataRegion(int start, int size);
-
-
-    DataCache * getCache(double dataPerPixel);
-    void makeCache(DataCache &, int blockSize);
 
     int m_dim = -1;
     QColor m_color { Qt::black };
@@ -75,14 +59,11 @@ private:
     Reactive::Value<void> m_on_dataset;
 
     DataSetPtr m_dataset = nullptr;
-    data_region_type m_data_region;
+    // Line of the first attribute
+    SelectedLines m_line { this };
 
     Reactive::Value<Range> m_value_range;
     Reactive::Value<void> m_on_value_range;
-
-    double m_cache_use_factor = 5;
-    double m_cache_factor = 10;
-    list<DataCache> m_cache;
 };
 
 }
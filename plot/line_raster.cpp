@@ -0,0 +1,127 @@
+#include "line_raster.hpp"
+#include "../utility/threads.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+namespace datavis {
+
+LineRaster::LineRaster(QImage & image, const QColor & color):
+    m_bits(image.bits()),
+    m_bytes_per_line(image.bytesPerLine()),
+    m_width(image.width()),
+    m_height(image.height()),
+    m_pixel(qPremultiply(color.rgba())),
+    m_clip_begin(0),
+    m_clip_end(image.width())
+{}
+
+void LineRaster::setClipColumns(int begin, int end)
+{
+    m_clip_begin = std::max(0, begin);
+    m_clip_end = std::min(m_width, end);
+}
+
+void LineRaster::drawVertical(int x, int y0, int y1)
+{
+    if (x < m_clip_begin || x >= m_clip_end)
+        return;
+
+    if (y0 > y1)
+        std::swap(y0, y1);
+
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, m_height - 1);
+
+    uchar * row = m_bits + y0 * m_bytes_per_line;
+    for (int y = y0; y <= y1; ++y, row += m_bytes_per_line)
+        reinterpret_cast<uint32_t*>(row)[x] = m_pixel;
+}
+
+void LineRaster::drawLine(int x0, int y0, int x1, int y1)
+{
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    if (x0 == x1)
+    {
+        drawVertical(x0, y0, y1);
+        return;
+    }
+
+    // Fills the span of rows covered by the line in each column,
+    // so the cost is bounded by the clipped width and the image height.
+
+    double slope = double(y1 - y0) / (x1 - x0);
+    bool steep = std::abs(slope) > 1;
+
+    int begin = std::max(x0, m_clip_begin);
+    int end = std::min(x1 + 1, m_clip_end);
+
+    for (int x = begin; x < end; ++x)
+    {
+        if (!steep)
+        {
+            setPixel(x, int(std::lround(y0 + slope * (x - x0))));
+            continue;
+        }
+
+        // Part of the line within half a pixel of the column center
+        double left = std::max(x - 0.5, double(x0));
+        double right = std::min(x + 0.5, double(x1));
+
+        int top = int(std::lround(y0 + slope * (left - x0)));
+        int bottom = int(std::lround(y0 + slope * (right - x0)));
+
+        drawVertical(x, top, bottom);
+    }
+}
+
+void drawLineLayersBand(QImage & image, const std::vector<LineLayer> & layers, int begin, int end)
+{
+    for (const auto & layer : layers)
+    {
+        LineRaster raster(image, layer.color);
+        raster.setClipColumns(begin, end);
+
+        // Segments ending at or after the band, up to those starting after it.
+        const auto & segments = layer.segments;
+        auto first = std::partition_point(segments.begin(), segments.end(),
+                                          [&](const LineSegment & s) { return s.x1 < begin; });
+        auto last = std::partition_point(first, segments.end(),
+                                         [&](const LineSegment & s) { return s.x0 < end; });
+
+        for (auto segment = first; segment != last; ++segment)
+            raster.drawLine(segment->x0, segment->y0, segment->x1, segment->y1);
+    }
+}
+
+void drawLineLayers(QImage & image, const std::vector<LineLayer> & layers)
+{
+    size_t segment_count = 0;
+    for (const auto & layer : layers)
+        segment_count += layer.segments.size();
+
+    int width = image.width();
+    if (width <= 0 || image.height() <= 0 || !segment_count)
+        return;
+
+    // Detach before writing the bits from several threads.
+    image.bits();
+
+    int band_count = segment_count > 2048 ? compute_pool().thread_count() : 1;
+    band_count = std::min(band_count, width);
+    int band_width = (width + band_count - 1) / band_count;
+
+    compute_pool().for_each_index(band_count, [&](int band)
+    {
+        int begin = band * band_width;
+        drawLineLayersBand(image, layers, begin, begin + band_width);
+    });
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../data/m4.hpp"
+
+#include <QImage>
+#include <QColor>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+namespace datavis {
+
+// Draws lines one pixel wide without antialiasing directly into
+// the scanlines of an image, which is much faster than QPainter
+// for the many short lines of a dense plot.
+//
+// The image must have a 32-bit format, such as Format_ARGB32_Premultiplied,
+// and must be detached before drawing, since its bits are written directly.
+// Pixels are replaced by the color, without blending.
+//
+// Drawing can be limited to a band of columns, so separate rasters
+// can draw different bands of the same image in parallel.
+
+class LineRaster
+{
+public:
+    LineRaster(QImage & image, const QColor & color);
+
+    // Limits drawing to columns [begin, end).
+    void setClipColumns(int begin, int end);
+
+    // Pixels from y0 to y1, inclusive, in column x.
+    void drawVertical(int x, int y0, int y1);
+
+    // Pixels of a line from (x0, y0) to (x1, y1), inclusive.
+    // Steep lines fill the rows they cross in each column.
+    void drawLine(int x0, int y0, int x1, int y1);
+
+private:
+    void setPixel(int x, int y)
+    {
+        if (x >= m_clip_begin && x < m_clip_end && y >= 0 && y < m_height)
+            reinterpret_cast<uint32_t*>(m_bits + y * m_bytes_per_line)[x] = m_pixel;
+    }
+
+    uchar * m_bits;
+    int m_bytes_per_line;
+    int m_width;
+    int m_height;
+    uint32_t m_pixel;
+    int m_clip_begin;
+    int m_clip_end;
+};
+
+// A line between pixels, inclusive.
+struct LineSegment
+{
+    int x0, y0, x1, y1;
+};
+
+// Segments drawn with the same color, ordered by column:
+// each has x0 <= x1, and both x0 and x1 never decrease from one
+// segment to the next, like those of appendM4Segments().
+struct LineLayer
+{
+    QColor color;
+    std::vector<LineSegment> segments;
+};
+
+// Appends segments drawing M4 columns (see m4.hpp) at image columns [0, columns.size()):
+// a vertical line from the minimum to the maximum of each column,
+// and a line from the last value of each column to the first value of the next.
+// y_of(value) returns the image row of a value.
+// Lines continue across columns without values, and end at columns
+// of only NaN values, or with an empty extent because they are not reduced yet.
+template <typename Y_Of>
+void appendM4Segments(std::vector<LineSegment> & segments,
+                      const std::vector<m4_column> & columns, Y_Of y_of)
+{
+    // Last value of the previous column with values
+    bool has_last = false;
+    int last_x = 0;
+    int last_y = 0;
+
+    for (int x = 0; x < int(columns.size()); ++x)
+    {
+        const auto & column = columns[x];
+
+        if (column.count == 0)
+            continue;
+
+        if (column.extent.is_empty())
+        {
+            has_last = false;
+            continue;
+        }
+
+        if (has_last && !std::isnan(column.first))
+            segments.push_back({ last_x, last_y, x, y_of(column.first) });
+
+        segments.push_back({ x, y_of(column.extent.min), x, y_of(column.extent.max) });
+
+        has_last = !std::isnan(column.last);
+        if (has_last)
+        {
+            last_x = x;
+            last_y = y_of(column.last);
+        }
+    }
+}
+
+// Draws the layers in order into the image.
+// With many segments, bands of columns are drawn in parallel
+// on the compute pool, each drawing the parts of segments within it.
+// Each band finds the segments crossing it by binary search,
+// so the total work does not grow with the number of bands.
+void drawLineLayers(QImage & image, const std::vector<LineLayer> & layers);
+
+// Draws the parts of the layers within columns [begin, end) into the image,
+// as drawLineLayers() does for each band.
+void drawLineLayersBand(QImage & image, const std::vector<LineLayer> & layers, int begin, int end);
+
+}
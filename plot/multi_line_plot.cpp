@@ -0,0 +1,300 @@
+#include "multi_line_plot.hpp"
+#include "../reactive/trace.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QPainter>
+
+using namespace std;
+
+namespace datavis {
+
+// Space above and below the line in each stacked lane,
+// as a fraction of the lane height.
+static const double lane_margin = 0.05;
+
+MultiLinePlot::MultiLinePlot(QObject * parent):
+    Plot(parent)
+{}
+
+json MultiLinePlot::save()
+{
+    json d;
+    d["type"] = "multi_line";
+    d["dim"] = m_dim;
+    d["layout"] = m_layout == Stacked ? "stacked" : "overlaid";
+    return d;
+}
+
+void MultiLinePlot::restore(const FutureDataset & dataset, const json & options)
+{
+    int dim = options.at("dim");
+    string layout = options.value("layout", "overlaid");
+    setLayout(layout == "stacked" ? Stacked : Overlaid);
+    setDataSet(dataset, dim);
+}
+
+void MultiLinePlot::setDataSet(FutureDataset dataset, int dimension)
+{
+    Reactive::Priority_Scope priority_scope(priority());
+
+    // Clear scheduled work
+    m_on_dataset = nullptr;
+    m_dataset = nullptr;
+    m_channels.clear();
+    m_lines.clear();
+    m_statistics.clear();
+    m_on_statistics.clear();
+
+    emit xRangeChanged();
+    emit yRangeChanged();
+    emit contentChanged();
+
+    trackProgress(dataset);
+
+    if (!dataset)
+        return;
+
+    m_dim = dimension;
+
+    m_on_dataset = Reactive::apply([=, this](Reactive::Status&, DataSetPtr dataset)
+    {
+        prepareDataSet(dataset);
+    },
+    dataset);
+}
+
+void MultiLinePlot::onPartialDataSet(DataSetPtr dataset)
+{
+    if (m_on_dataset && m_on_dataset->done)
+        return;
+
+    prepareDataSet(dataset);
+}
+
+void MultiLinePlot::prepareDataSet(DataSetPtr dataset)
+{
+    if (m_dataset)
+        m_dataset->disconnect(this);
+
+    m_dataset = dataset;
+    m_channels.clear();
+
+    connect(m_dataset.get(), &DataSet::selectionChanged,
+            this, &MultiLinePlot::onSelectionChanged);
+
+    int dim_count = dataset->dimensionCount();
+
+    if (!dim_count || !dataset->attributeCount())
+    {
+        m_dataset = nullptr;
+        m_lines.clear();
+        return;
+    }
+
+    if (m_dim < 0 || m_dim >= dim_count)
+    {
+        m_dim = 0;
+    }
+
+    int channel_count = dataset->attributeCount();
+
+    m_channels.resize(channel_count);
+
+    vector<int> attributes(channel_count);
+
+    // Hues spread by the golden ratio, so neighbouring lines differ.
+    for (int c = 0; c < channel_count; ++c)
+    {
+        double hue = std::fmod(c * 0.618034, 1.0);
+        m_channels[c].color = QColor::fromHsvF(hue, 0.8, 0.75);
+        attributes[c] = c;
+    }
+
+    m_lines.setLines(dataset, m_dim, attributes);
+    updateValueRanges();
+
+    emit xRangeChanged();
+    emit yRangeChanged();
+    emit contentChanged();
+    emit sourceChanged();
+}
+
+void MultiLinePlot::setLayout(Layout layout)
+{
+    if (layout == m_layout)
+        return;
+
+    m_layout = layout;
+
+    emit layoutChanged();
+    emit yRangeChanged();
+    emit contentChanged();
+}
+
+void MultiLinePlot::onSelectionChanged()
+{
+    Reactive::Priority_Scope priority_scope(priority());
+
+    if (m_lines.updateSelection())
+        emit contentChanged();
+}
+
+void MultiLinePlot::updateValueRanges()
+{
+    m_statistics.clear();
+    m_on_statistics.clear();
+
+    // Statistics are shared with other plots of the same data.
+
+    for (int c = 0; c < channelCount(); ++c)
+    {
+        auto statistics = m_dataset->statisticsValue(c);
+
+        auto on_statistics = Reactive::apply([=, this](Reactive::Status&, value_statistics stats)
+        {
+            auto & channel = m_channels[c];
+            channel.has_value_range = !stats.extent.is_empty();
+            if (channel.has_value_range)
+                channel.value_range = Range(stats.extent.min, stats.extent.max);
+
+            emit yRangeChanged();
+            // Stacked lanes are scaled to the value range.
+            if (m_layout == Stacked)
+                emit contentChanged();
+        },
+        statistics);
+
+        m_statistics.push_back(statistics);
+        m_on_statistics.push_back(on_statistics);
+    }
+}
+
+Mapping1d MultiLinePlot::valueMapping(int channel) const
+{
+    Mapping1d map;
+
+    if (m_layout == Overlaid)
+        return map;
+
+    // The first channel is in the top lane.
+    double lane = channelCount() - 1 - channel;
+
+    const auto & c = m_channels[channel];
+
+    if (!c.has_value_range || !(c.value_range.extent() > 0))
+    {
+        map.scale = 0;
+        map.offset = lane + 0.5;
+        return map;
+    }
+
+    map.scale = (1 - 2 * lane_margin) / c.value_range.extent();
+    map.offset = lane + lane_margin - c.value_range.min * map.scale;
+    return map;
+}
+
+Plot::Range MultiLinePlot::xRange()
+{
+    return m_lines.xRange();
+}
+
+Plot::Range MultiLinePlot::yRange()
+{
+    if (m_channels.empty())
+        return Range();
+
+    if (m_layout == Stacked)
+        return Range(0, channelCount());
+
+    bool has_range = false;
+    Range range;
+
+    for (auto & channel : m_channels)
+    {
+        if (!channel.has_value_range)
+            continue;
+
+        if (!has_range)
+        {
+            range = channel.value_range;
+            has_range = true;
+            continue;
+        }
+
+        range.min = std::min(range.min, channel.value_range.min);
+        range.max = std::max(range.max, channel.value_range.max);
+    }
+
+    return range;
+}
+
+Plot::Range MultiLinePlot::visibleYRange(const Range & x_range)
+{
+    // Stacked lanes are scaled to the value range of entire lines.
+    if (m_layout == Stacked)
+        return yRange();
+
+    auto extent = m_lines.visibleExtent(x_range);
+
+    if (extent.is_empty())
+        return yRange();
+
+    return Range(extent.min, extent.max);
+}
+
+tuple<vector<double>, vector<double>> MultiLinePlot::dataLocation(const QPointF & point)
+{
+    if (isEmpty())
+        return {};
+
+    auto dim = m_dataset->dimension(m_dim);
+
+    vector<double> location(m_dataset->dimensionCount());
+    for (int d = 0; d < int(location.size()); ++d)
+    {
+        if (d == m_dim)
+            location[d] = point.x();
+        else
+            location[d] = m_dataset->dimension(d).map * m_lines.selectedIndex()[d];
+    }
+
+    // Values of all attributes at the nearest index.
+
+    int64_t index = std::llround(point.x() / dim.map);
+    index = std::max(int64_t(0), std::min(int64_t(dim.size) - 1, index));
+
+    vector<double> attributes(channelCount(), NAN);
+    for (int c = 0; c < channelCount(); ++c)
+        attributes[c] = m_lines.valueAt(c, index);
+
+    return { location, attributes };
+}
+
+void MultiLinePlot::plot(QPainter * painter,  const Mapping2d & transform, const QRectF & region)
+{
+    if (m_channels.empty())
+        return;
+
+    Reactive::Trace_Span span("Multi-line plot", "plot");
+
+    // Maps values of each channel to pixels.
+
+    vector<Mapping2d> transforms;
+    vector<QColor> colors;
+
+    for (int c = 0; c < channelCount(); ++c)
+    {
+        auto map = valueMapping(c);
+        Mapping2d t = transform;
+        t.y_scale = transform.y_scale * map.scale;
+        t.y_offset = transform.y_scale * map.offset + transform.y_offset;
+        transforms.push_back(t);
+        colors.push_back(m_channels[c].color);
+    }
+
+    m_lines.plot(painter, transform, region, transforms, colors);
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QColor>
+
+#include "plot.hpp"
+#include "selected_lines.hpp"
+#include "../data/array.hpp"
+#include "../data/data_set.hpp"
+#include "../data/data_source.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace datavis {
+
+using std::vector;
+
+// Lines of all attributes of a data set along a dimension,
+// at the selected index of the other dimensions.
+//
+// Lines are either overlaid, sharing the y axis, or stacked in lanes
+// of height 1, each scaled to the value range of its attribute.
+// Dense lines of all attributes are drawn into a single image.
+
+class MultiLinePlot : public Plot
+{
+    Q_OBJECT
+
+public:
+    using data_type = array<double>;
+    using data_region_type = array_region<double>;
+
+    enum Layout
+    {
+        Overlaid,
+        Stacked
+    };
+
+    MultiLinePlot(QObject * parent = 0);
+
+    DataSetPtr dataSet() override { return m_dataset; }
+    void setDataSet(FutureDataset access, int dimension);
+
+    int dimension() const { return m_dim; }
+
+    Layout layout() const { return m_layout; }
+    void setLayout(Layout);
+
+    int channelCount() const { return int(m_channels.size()); }
+    QColor color(int channel) const { return m_channels[channel].color; }
+
+    virtual bool isEmpty() const override { return m_channels.empty(); }
+    virtual Range xRange() override;
+    virtual Range yRange() override;
+    virtual Range visibleYRange(const Range & xRange) override;
+    virtual tuple<vector<double>, vector<double>> dataLocation(const QPointF & point) override;
+    virtual void plot(QPainter *,  const Mapping2d &, const QRectF & region) override;
+
+    virtual json save() override;
+    virtual void restore(const FutureDataset &, const json &) override;
+
+signals:
+    void sourceChanged();
+    void layoutChanged();
+
+private:
+    struct Channel
+    {
+        QColor color;
+        // Value range of the attribute, once known.
+        Range value_range;
+        bool has_value_range = false;
+    };
+
+    void onPartialDataSet(DataSetPtr) override;
+    void prepareDataSet(DataSetPtr);
+    void onSelectionChanged();
+    void updateValueRanges();
+    // Maps values of the channel to y coordinates of the plot.
+    Mapping1d valueMapping(int channel) const;
+
+    int m_dim = -1;
+    Layout m_layout = Overlaid;
+
+    Reactive::Value<void> m_on_dataset;
+
+    DataSetPtr m_dataset = nullptr;
+    vector<Channel> m_channels;
+    // Line of each channel
+    SelectedLines m_lines { this };
+
+    vector<Reactive::Value<value_statistics>> m_statistics;
+    vector<Reactive::Value<void>> m_on_statistics;
+};
+
+}
@@ -3,6 +3,7 @@
 #include "../data/math.hpp"
 #include "../data/data_set.hpp"
 #include "../data/data_source.hpp"
+#include "../reactive/reactive.hpp"
 #include "../json/json.hpp"
 
 #include <QObject>
@@ -45,18 +46,69 @@ public:
     virtual bool isEmpty() const = 0;
     virtual Range xRange() = 0;
     virtual Range yRange() = 0;
+    // Range of y values within the x range, for fitting the view to them.
+    virtual Range visibleYRange(const Range & xRange) { return yRange(); }
     virtual void plot(QPainter *, const Mapping2d &, const QRectF & region) = 0;
     virtual tuple<vector<double>, vector<double>> dataLocation(const QPointF & point) = 0;
 
     virtual json save() { return {}; }
     virtual void restore(const FutureDataset &, const json &) {}
 
+    // Progress of loading the data set.
+    const Reactive::Progress & progress() const { return m_progress; }
+    bool isLoading() const { return !(m_progress.fraction >= 1); }
+
+    // Priority of work for this plot, set by its view.
+    // Work started within a Priority_Scope of it has this priority,
+    // even after it is changed.
+    const Reactive::Priority_Pointer & priority() const { return m_priority; }
+    void setPriority(Reactive::Priority p) { m_priority->set(p); }
+
 signals:
     void xRangeChanged();
     void yRangeChanged();
     void contentChanged();
+    void progressChanged();
+
+protected:
+    // Tracks progress of loading the data set,
+    // and passes partial data sets to onPartialDataSet().
+    void trackProgress(const FutureDataset & dataset)
+    {
+        m_tracked_dataset = dataset;
+
+        m_progress = dataset ? dataset->get_progress() : Reactive::Progress { 1, 0, "" };
+        emit progressChanged();
+
+        if (!dataset)
+            return;
+
+        auto tracked = dataset.get();
+
+        Reactive::on_progress(dataset, this,
+                              [this, tracked](const Reactive::Progress & progress,
+                                              std::shared_ptr<const DataSetPtr> partial)
+        {
+            // Ignore data sets that were replaced meanwhile.
+            if (m_tracked_dataset.lock().get() != tracked)
+                return;
+
+            m_progress = progress;
+            emit progressChanged();
+
+            if (partial && *partial)
+                onPartialDataSet(*partial);
+        });
+    }
+
+    // Called with snapshots of a data set while it is loading.
+    virtual void onPartialDataSet(DataSetPtr) {}
 
 private:
+    Reactive::Priority_Pointer m_priority = Reactive::make_priority(Reactive::Priority::visible);
+    std::weak_ptr<Reactive::Value_Data<DataSetPtr>> m_tracked_dataset;
+    Reactive::Progress m_progress { 1, 0, "" };
+
     friend class PlotView;
     void setView(PlotView *view) { m_view = view; }
     PlotView * m_view = nullptr;
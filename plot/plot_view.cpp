@@ -88,6 +88,16 @@ void PlotGridView::makeContextMenu()
         connect(action, &QAction::triggered,
                 this, &PlotGridView::removeSelectedColumn);
     }
+
+    menu->addSeparator();
+
+    {
+        auto action = menu->addAction("Fit Y to Visible Data");
+        action->setCheckable(true);
+        action->setChecked(m_fit_visible_y);
+        connect(action, &QAction::toggled,
+                this, &PlotGridView::setFitVisibleY);
+    }
 }
 
 PlotView * PlotGridView::makeView()
@@ -251,6 +261,12 @@ void PlotGridView::addColumn()
     auto x_ctl = new PlotRangeController;
     m_x_range_ctls.push_back(x_ctl);
 
+    connect(x_ctl, &PlotRangeController::changed, this, [this]()
+    {
+        if (m_fit_visible_y)
+            fitVisibleY();
+    });
+
     auto x_bar = new RangeView(Qt::Horizontal, x_ctl);
     m_x_range_views.push_back(x_bar);
 
@@ -504,6 +520,12 @@ void PlotGridView::addPlot(Plot * plot, int row, int column)
             this, &PlotGridView::updateDataRange);
     connect(plot, &Plot::yRangeChanged,
             this, &PlotGridView::updateDataRange);
+    // More data may be visible as it is loaded or reduced.
+    connect(plot, &Plot::contentChanged, this, [this]()
+    {
+        if (m_fit_visible_y)
+            fitVisibleY();
+    });
 
     updateDataRange();
 
@@ -809,9 +831,64 @@ void PlotGridView::updateDataRange()
         m_x_range_ctls[col]->setValue(total_range);
     }
 
+    if (m_fit_visible_y)
+        fitVisibleY();
+
     update();
 }
 
+void PlotGridView::setFitVisibleY(bool enabled)
+{
+    m_fit_visible_y = enabled;
+
+    if (enabled)
+    {
+        fitVisibleY();
+    }
+    else
+    {
+        for (auto * y_ctl : m_y_range_ctls)
+            y_ctl->setValue(y_ctl->limit());
+    }
+}
+
+void PlotGridView::fitVisibleY()
+{
+    for (int row = 0; row < rowCount(); ++row)
+    {
+        Plot::Range total_range;
+
+        bool first = true;
+        for (int col = 0; col < columnCount(); ++col)
+        {
+            auto plot = plotAtCell(row, col);
+            if (!plot || plot->isEmpty())
+                continue;
+
+            auto range = plot->visibleYRange(m_x_range_ctls[col]->value());
+
+            if (first)
+            {
+                total_range = range;
+                first = false;
+            }
+            else
+            {
+                total_range.min = std::min(total_range.min, range.min);
+                total_range.max = std::max(total_range.max, range.max);
+            }
+        }
+
+        // Keep the range of a flat line, which can not be fitted.
+        if (first || !(total_range.extent() > 0))
+            continue;
+
+        auto & current = m_y_range_ctls[row]->value();
+        if (current.min != total_range.min || current.max != total_range.max)
+            m_y_range_ctls[row]->setValue(total_range);
+    }
+}
+
 bool PlotGridView::eventFilter(QObject * object, QEvent * event)
 {
     switch(event->type())
@@ -1299,11 +1376,30 @@ void PlotView::setPlot(Plot *plot)
     {
         connect(plot, SIGNAL(contentChanged()),
                 this, SLOT(update()));
+        connect(plot, SIGNAL(progressChanged()),
+                this, SLOT(update()));
     }
 
+    updatePriority(isVisible());
     update();
 }
 
+void PlotView::updatePriority(bool shown)
+{
+    if (!m_plot)
+        return;
+
+    // The selected plot is the one the user interacts with.
+    // Hidden plots do not need anything until shown again.
+
+    if (!shown)
+        m_plot->setPriority(Reactive::Priority::idle);
+    else if (m_is_selected)
+        m_plot->setPriority(Reactive::Priority::interactive);
+    else
+        m_plot->setPriority(Reactive::Priority::visible);
+}
+
 void PlotView::setRangeController(PlotRangeController * ctl, Qt::Orientation orientation)
 {
     PlotRangeController * old_ctl = nullptr;
@@ -1383,6 +1479,16 @@ void PlotView::selectDataAt(const QPoint & pos)
     }
 }
 
+void PlotView::showEvent(QShowEvent*)
+{
+    updatePriority(true);
+}
+
+void PlotView::hideEvent(QHideEvent*)
+{
+    updatePriority(false);
+}
+
 void PlotView::enterEvent(QEvent*)
 {
     update();
@@ -1554,6 +1660,32 @@ void PlotView::paintEvent(QPaintEvent*)
         painter.drawText(QPoint(10, fm.ascent()), name);
     }
 
+    // Draw loading progress
+
+    if (plot->isLoading())
+    {
+        const auto & progress = plot->progress();
+
+        QString text = progress.phase.empty() ? QString("Loading")
+                                              : QString::fromStdString(progress.phase);
+
+        QRect bar_rect(plot_rect.x(), plot_rect.y(), plot_rect.width(), 3);
+
+        if (progress.fraction >= 0)
+        {
+            text += QString(" %1%").arg(int(progress.fraction * 100));
+            bar_rect.setWidth(int(plot_rect.width() * progress.fraction));
+            painter.fillRect(bar_rect, QColor(80,130,200));
+        }
+
+        if (progress.bytes > 0)
+            text += QString(" (%1 MB)").arg(progress.bytes / (1024.0 * 1024.0), 0, 'f', 1);
+
+        auto fm = fontMetrics();
+        painter.setPen(Qt::gray);
+        painter.drawText(QPoint(plot_rect.x() + 10, plot_rect.y() + 10 + fm.ascent()), text);
+    }
+
     if (plot->isEmpty())
         return;
 
@@ -67,10 +67,13 @@ public:
     void onSelectedPlotChanged(QWidget * selected_plot)
     {
         m_is_selected = selected_plot == this;
+        updatePriority(isVisible());
         update();
     }
 
 protected:
+    virtual void showEvent(QShowEvent*) override;
+    virtual void hideEvent(QHideEvent*) override;
     virtual void enterEvent(QEvent*) override;
     virtual void leaveEvent(QEvent*) override;
     virtual void mouseMoveEvent(QMouseEvent*) override;
@@ -87,6 +90,8 @@ private:
         MouseFocusData
     };
 
+    void updatePriority(bool shown);
+
     Plot * m_plot = nullptr;
     PlotRangeController * m_x_range = nullptr;
     PlotRangeController * m_y_range = nullptr;
@@ -194,6 +199,11 @@ public:
     Plot * plotAt(const QPoint & pos);
     Plot * plotAtCell(int row, int column);
 
+    // When enabled, the y range of each row is fitted to the data
+    // visible in the x ranges of its plots, as they change.
+    bool fitsVisibleY() const { return m_fit_visible_y; }
+    void setFitVisibleY(bool enabled);
+
     bool hasSelectedCell() const { return m_selected_view != nullptr; }
     QPoint selectedCell() const { return m_selected_cell; }
 
@@ -228,6 +238,7 @@ private:
     QRect columnRect(int col);
 
     void updateDataRange();
+    void fitVisibleY();
 
     virtual bool eventFilter(QObject*, QEvent*) override;
     virtual bool event(QEvent *event) override;
@@ -273,6 +284,8 @@ private:
     RectWidget * m_drag_target_indicator = nullptr;
 
     PlotReticle * m_reticle = nullptr;
+
+    bool m_fit_visible_y = false;
 };
 
 }
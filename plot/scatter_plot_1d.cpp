@@ -1,4 +1,5 @@
 #include "scatter_plot_1d.hpp"
+#include "../data/reduction.hpp"
 
 namespace datavis {
 
@@ -33,8 +34,14 @@ void ScatterPlot1d::setData(const FutureDataset & data, int attribute, Orientati
     emit yRangeChanged();
     emit contentChanged();
 
-    m_preparation = Reactive::apply([=](Reactive::Status&, DataSetPtr dataset)
+    m_preparation = Reactive::apply([=, this](Reactive::Status&, DataSetPtr dataset)
     {
+            if (dataset->isTiled())
+            {
+                cerr << "ScatterPlot1d: Tiled data sets are not supported." << endl;
+                return;
+            }
+
             m_dataset = dataset;
             m_attribute = attribute;
             m_orientation = orientation;
@@ -56,13 +63,11 @@ void ScatterPlot1d::make_points()
 {
     // FIXME: Implement selection in other dimensions
 
-    auto data_region = get_region(m_dataset->data(m_attribute),
-                                  vector<int>(m_dataset->dimensionCount(), 0),
-                                  m_dataset->data()->size());
+    auto data_region = m_dataset->region(m_attribute);
 
     for(auto item : data_region)
     {
-        double v =  m_dataset->data(m_attribute).data()[item.index()];
+        double v = data_region.data()[item.index()];
 
         Point2d p;
         if (m_orientation == Horizontal)
@@ -108,13 +113,10 @@ tuple<vector<double>, vector<double>> ScatterPlot1d::dataLocation(const QPointF
 
 Plot::Range ScatterPlot1d::find_range()
 {
-    int ndim = m_dataset->dimensionCount();
-    auto data_region = get_region(m_dataset->data(m_attribute),
-                                  vector<int>(ndim, 0),
-                                  m_dataset->data()->size());
-    auto min = std::min_element(data_region.begin(), data_region.end());
-    auto max = std::max_element(data_region.begin(), data_region.end());
-    return Range(min.value(), max.value());
+    auto extent = m_dataset->statistics(m_attribute).extent;
+    if (extent.is_empty())
+        return Range();
+    return Range(extent.min, extent.max);
 }
 
 void ScatterPlot1d::plot(QPainter * painter,  const Mapping2d & view_map, const QRectF & region)
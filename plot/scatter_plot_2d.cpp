@@ -1,4 +1,5 @@
 #include "scatter_plot_2d.hpp"
+#include "../data/reduction.hpp"
 
 namespace datavis {
 
@@ -39,8 +40,14 @@ void ScatterPlot2d::setData(const FutureDataset & data, int xDim, int yDim)
     emit yRangeChanged();
     emit contentChanged();
 
-    m_preparation = Reactive::apply([=](Reactive::Status&, DataSetPtr dataset)
+    m_preparation = Reactive::apply([=, this](Reactive::Status&, DataSetPtr dataset)
     {
+        if (dataset->isTiled())
+        {
+            cerr << "ScatterPlot2d: Tiled data sets are not supported." << endl;
+            return;
+        }
+
         m_dataset = dataset;
 
         m_x_dim = xDim;
@@ -73,15 +80,18 @@ void ScatterPlot2d::setShowLine(bool value)
 
 void ScatterPlot2d::make_points()
 {
-    auto data_region = get_region(*m_dataset->data(),
-                                  vector<int>(m_dataset->dimensionCount(), 0),
-                                  m_dataset->data()->size());
+    auto data_region = m_dataset->region(0);
+
+    // Attributes share the layout of data_region.
+    vector<const double*> attribute_data;
+    for (int a = 0; a < m_dataset->attributeCount(); ++a)
+        attribute_data.push_back(m_dataset->region(a).data());
 
     for(auto item : data_region)
     {
         Point2d p;
-        p.x = value(m_x_dim, item);
-        p.y = value(m_y_dim, item);
+        p.x = value(m_x_dim, item, attribute_data);
+        p.y = value(m_y_dim, item, attribute_data);
 
         m_points.push_back(p);
     }
@@ -133,17 +143,15 @@ Plot::Range ScatterPlot2d::range(int dim_index)
     else
     {
         int att_idx = dim_index - m_dataset->dimensionCount();
-        int ndim = m_dataset->dimensionCount();
-        auto data_region = get_region(m_dataset->data(att_idx),
-                                      vector<int>(ndim, 0),
-                                      m_dataset->data()->size());
-        auto min = std::min_element(data_region.begin(), data_region.end());
-        auto max = std::max_element(data_region.begin(), data_region.end());
-        return Range(min.value(), max.value());
+        auto extent = m_dataset->statistics(att_idx).extent;
+        if (extent.is_empty())
+            return Range();
+        return Range(extent.min, extent.max);
     }
 }
 
-inline double ScatterPlot2d::value(int dim_index,  const array_region<double>::iterator & iter)
+inline double ScatterPlot2d::value(int dim_index,  const array_region<double>::iterator & iter,
+                                   const vector<const double*> & attribute_data)
 {
     if (dim_index < m_dataset->dimensionCount())
     {
@@ -153,7 +161,7 @@ inline double ScatterPlot2d::value(int dim_index,  const array_region<double>::i
     else
     {
         int att_idx = dim_index - m_dataset->dimensionCount();
-        return m_dataset->data(att_idx).data()[iter.index()];
+        return attribute_data[att_idx][iter.index()];
     }
 }
 
@@ -162,7 +170,7 @@ void ScatterPlot2d::plot(QPainter * painter,  const Mapping2d & view_map, const
 #if 0
     int ndim = m_dataset->dimensionCount();
 
-    auto data_region = get_region(*m_dataset->data(), vector<int>(ndim, 0),  m_dataset->data()->size());
+    auto data_region = get_region(*m_dataset->data(), vector<int64_t>(ndim, 0),  m_dataset->size());
 
     QColor c;
 
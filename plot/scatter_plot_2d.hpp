@@ -42,7 +42,8 @@ public:
 
 public:
     Range range(int dim);
-    double value(int dim, const array_region<double>::iterator &);
+    double value(int dim, const array_region<double>::iterator &,
+                 const vector<const double*> & attribute_data);
     void make_points();
 
     DataSetPtr m_dataset = nullptr;
@@ -0,0 +1,490 @@
+#include "selected_lines.hpp"
+#include "line_raster.hpp"
+#include "../utility/threads.hpp"
+#include "../data/m4.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QPainter>
+#include <QPainterPath>
+
+using namespace std;
+
+namespace datavis {
+
+// Largest number of values in a pixel column to reduce directly,
+// while the pyramids are not built for them yet.
+static const int64_t max_unreduced_column_size = 4096;
+
+void SelectedLines::clear()
+{
+    m_dataset = nullptr;
+    m_attributes.clear();
+    m_selected_index.clear();
+    m_regions.clear();
+    m_window = Window();
+    m_window_read = nullptr;
+    m_on_window = nullptr;
+    m_pyramids.clear();
+    m_pyramids_value = nullptr;
+}
+
+void SelectedLines::setLines(DataSetPtr dataset, int dim, const vector<int> & attributes)
+{
+    clear();
+
+    m_dataset = dataset;
+    m_dim = dim;
+    m_attributes = attributes;
+
+    updateSelection();
+}
+
+bool SelectedLines::updateSelection()
+{
+    if (isEmpty())
+        return false;
+
+    auto offset = m_dataset->selectedIndex();
+    offset[m_dim] = 0;
+
+    if (offset == m_selected_index)
+        return false;
+
+    // Values of other lines
+    m_window = Window();
+    m_window_read = nullptr;
+    m_on_window = nullptr;
+
+    m_selected_index = offset;
+
+    // Values of a tiled data set are read in the background when drawn.
+    m_regions.assign(lineCount(), data_region_type());
+    if (!m_dataset->isTiled())
+    {
+        int64_t size = m_dataset->dimension(m_dim).size;
+        for (int line = 0; line < lineCount(); ++line)
+            m_regions[line] = getDataRegion(line, 0, size);
+    }
+
+    updatePyramids();
+
+    return true;
+}
+
+Plot::Range SelectedLines::xRange() const
+{
+    if (!m_dataset)
+        return Plot::Range();
+
+    auto dim = m_dataset->dimension(m_dim);
+
+    return Plot::Range(dim.minimum(), dim.maximum());
+}
+
+value_extent SelectedLines::visibleExtent(const Plot::Range & x_range)
+{
+    value_extent extent;
+
+    if (isEmpty() || int(m_pyramids.size()) != lineCount())
+        return extent;
+
+    auto dim = m_dataset->dimension(m_dim);
+
+    int64_t start = int64_t(std::floor(x_range.min / dim.map));
+    int64_t end = int64_t(std::ceil(x_range.max / dim.map)) + 1;
+
+    start = std::max(start, int64_t(0));
+
+    for (int line = 0; line < lineCount(); ++line)
+    {
+        auto & pyramid = m_pyramids[line];
+
+        auto line_extent = pyramid->extent(start, std::min(end, pyramid->added()),
+                                           [&](int64_t edge_start, int64_t edge_end)
+        {
+            if (hasValues(edge_start, edge_end) || pyramid->level_count() == 0)
+                return min_max(getDataRegion(line, edge_start, edge_end - edge_start));
+
+            // Values of a tiled data set not read yet:
+            // the extent of the final blocks containing them.
+            int64_t block_size = pyramid->block_size(0);
+            int64_t first = edge_start / block_size;
+            int64_t last = std::min(pyramid->filled(0), (edge_end + block_size - 1) / block_size);
+            return pyramid->blocks_extent(0, first, last);
+        });
+
+        extent = merge(extent, line_extent);
+    }
+
+    return extent;
+}
+
+SelectedLines::data_region_type SelectedLines::getDataRegion(int line, int64_t start, int64_t size)
+{
+    if (isEmpty())
+        return data_region_type();
+
+    auto region_offset = m_selected_index;
+    vector<int64_t> region_size(region_offset.size(), 1);
+
+    region_offset[m_dim] = start;
+    region_size[m_dim] = size;
+
+    if (m_dataset->isTiled())
+    {
+        if (!hasValues(start, start + size))
+            return data_region_type();
+
+        vector<int64_t> window_offset(region_offset.size(), 0);
+        window_offset[m_dim] = start - m_window.start;
+        return get_region(*m_window.data[line], window_offset, region_size);
+    }
+
+    return m_dataset->region(m_attributes[line], region_offset, region_size);
+}
+
+double SelectedLines::valueAt(int line, int64_t index)
+{
+    auto region = getDataRegion(line, index, 1);
+    if (!region.is_valid())
+        return NAN;
+
+    double value = NAN;
+    for_each_span(region, [&](const array_span<double> & span)
+    {
+        value = span.data[0];
+    });
+    return value;
+}
+
+bool SelectedLines::hasValues(int64_t start, int64_t end) const
+{
+    if (!m_dataset)
+        return false;
+
+    if (!m_dataset->isTiled())
+        return true;
+
+    if (m_window.data.empty())
+        return false;
+
+    return start >= m_window.start && end <= m_window.start + m_window.size;
+}
+
+void SelectedLines::requestWindow(int64_t start, int64_t end)
+{
+    // Already being read
+    if (m_on_window && !m_on_window->done &&
+            start >= m_window_request_start && end <= m_window_request_end)
+        return;
+
+    Reactive::Priority_Scope priority_scope(m_plot->priority());
+
+    // Read more than requested, so panning does not need another read at once.
+    int64_t line_size = m_dataset->dimension(m_dim).size;
+    int64_t margin = (end - start) / 2;
+    m_window_request_start = std::max(int64_t(0), start - margin);
+    m_window_request_end = std::min(line_size, end + margin);
+
+    auto dataset = m_dataset;
+    auto attributes = m_attributes;
+    auto offset = m_selected_index;
+    vector<int64_t> size(offset.size(), 1);
+    offset[m_dim] = m_window_request_start;
+    size[m_dim] = m_window_request_end - m_window_request_start;
+
+    m_window_read = Reactive::apply(io_pool(),
+                                    [=, start = m_window_request_start,
+                                     window_size = size[m_dim]](Reactive::Status & status)
+    {
+        Window window;
+        window.start = start;
+        window.size = window_size;
+
+        for (int attribute : attributes)
+        {
+            status.yield();
+            window.data.push_back(make_shared<data_type>(dataset->readRegion(attribute, offset, size)));
+        }
+
+        return window;
+    });
+
+    m_on_window = Reactive::apply([=, this](Reactive::Status&, Window window)
+    {
+        m_window = window;
+        emit m_plot->contentChanged();
+    },
+    m_window_read);
+}
+
+void SelectedLines::updatePyramids()
+{
+    Reactive::Priority_Scope priority_scope(m_plot->priority());
+
+    m_pyramids.clear();
+    m_pyramids_value = nullptr;
+
+    if (isEmpty())
+        return;
+
+    // The build keeps the data set alive,
+    // so the selection may change meanwhile.
+
+    auto dataset = m_dataset;
+    auto attributes = m_attributes;
+    auto lines = m_regions;
+    auto offset = m_selected_index;
+    vector<int64_t> line_size(offset.size(), 1);
+    line_size[m_dim] = m_dataset->dimension(m_dim).size;
+    int64_t size = line_size[m_dim];
+
+    auto start = [=]()
+    {
+        return Reactive::apply(compute_pool(), [=](Reactive::Status & status)
+        {
+            vector<minmax_pyramid_ptr> pyramids;
+            vector<minmax_pyramid*> built;
+            for (size_t line = 0; line < attributes.size(); ++line)
+            {
+                pyramids.push_back(make_shared<minmax_pyramid>(size));
+                built.push_back(pyramids.back().get());
+            }
+
+            // Published first, so plots can draw them while they are being built.
+            status.publish_partial(pyramids);
+
+            // Tiles of a tiled data set are read as the build proceeds.
+            if (dataset->isTiled())
+            {
+                vector<tiled_array<double>*> arrays;
+                for (int attribute : attributes)
+                    arrays.push_back(&dataset->tiledData(attribute));
+                build_pyramids(built, arrays, offset, line_size, &status);
+            }
+            else
+            {
+                build_pyramids(built, lines, &status);
+            }
+
+            return pyramids;
+        });
+    };
+
+    auto cost = [](const vector<minmax_pyramid_ptr> & pyramids)
+    {
+        size_t size = 0;
+        for (auto & pyramid : pyramids)
+            size += pyramid->memory_size();
+        return size;
+    };
+
+    auto value = memo_cache::global().get<vector<minmax_pyramid_ptr>>(pyramidsKey(), start, cost);
+    m_pyramids_value = value;
+
+    if (value->ready)
+    {
+        m_pyramids = value->value;
+        return;
+    }
+
+    if (auto partial = value->get_partial())
+        m_pyramids = *partial;
+
+    // Draw more of the lines as more of the pyramids are built.
+    // Not keeping the value alive, so the build is still
+    // cancelled when no plot needs it anymore.
+
+    auto * requested = value.get();
+
+    Reactive::on_progress(value, m_plot,
+                          [this, requested](const Reactive::Progress &,
+                                            std::shared_ptr<const vector<minmax_pyramid_ptr>> partial)
+    {
+        if (m_pyramids_value.get() != requested)
+            return;
+
+        if (m_pyramids_value->ready)
+            m_pyramids = m_pyramids_value->value;
+        else if (partial)
+            m_pyramids = *partial;
+
+        emit m_plot->contentChanged();
+    });
+}
+
+memo_key SelectedLines::pyramidsKey() const
+{
+    vector<int64_t> size(m_selected_index.size(), 1);
+    size[m_dim] = m_dataset->dimension(m_dim).size;
+
+    memo_key key;
+    key.source = m_dataset->cacheId();
+    key.offset = m_selected_index;
+    key.size = size;
+    key.operation = "minmax-pyramids";
+    // Dimension and attributes of the lines
+    key.parameters = { double(m_dim) };
+    for (int attribute : m_attributes)
+        key.parameters.push_back(attribute);
+    return key;
+}
+
+void SelectedLines::plot(QPainter * painter, const Mapping2d & transform, const QRectF & region,
+                         const vector<Mapping2d> & line_transforms, const vector<QColor> & colors)
+{
+    if (isEmpty())
+        return;
+
+    auto dim = m_dataset->dimension(m_dim);
+
+    int64_t region_start = int64_t(region.x() / dim.map);
+    int64_t region_end = int64_t((region.x() + region.width()) / dim.map);
+
+    region_start = std::max(region_start, int64_t(0));
+    region_end = std::min(region_end, int64_t(dim.size) - 1);
+
+    int64_t region_size = region_end - region_start + 1;
+
+    if (region_size <= 0)
+        return;
+
+    auto min_x = transform.x_scale * region.x() + transform.x_offset;
+    auto max_x = transform.x_scale * (region.x() + region.width()) + transform.x_offset;
+
+    if (max_x <= min_x)
+        return;
+
+    if (max_x - min_x < region_size * 0.8)
+    {
+        // Draws the first, last, minimum and maximum value in each pixel column,
+        // which gives the same pixels as drawing lines between all values.
+        // The extent of values in a column is found using the pyramids.
+
+        // Values are at pixel positions offset + scale * index.
+        double offset = transform.x_scale * dim.map.offset + transform.x_offset;
+        double scale = transform.x_scale * dim.map.scale;
+
+        int first_column = int(std::floor(min_x));
+        int column_count = int(std::ceil(max_x)) - first_column;
+
+        auto bounds = m4_column_bounds(offset, scale, first_column, column_count, dim.size);
+
+        bool has_pyramids = int(m_pyramids.size()) == lineCount();
+
+        // Columns containing many blocks of a tiled data set are drawn
+        // from blocks of the pyramids, without reading values.
+        // Otherwise, values are drawn once read.
+
+        bool from_blocks = m_dataset->isTiled() && has_pyramids &&
+                m_pyramids[0]->level_count() > 0 && 1.0 / scale >= m_pyramids[0]->block_size(0);
+
+        if (!from_blocks && !hasValues(bounds.front(), bounds.back()))
+        {
+            requestWindow(bounds.front(), bounds.back());
+            return;
+        }
+
+        // The lines are drawn into an image covering the region,
+        // which is then drawn at once.
+
+        double region_top = transform.y_scale * (region.y() + region.height()) + transform.y_offset;
+        double region_bottom = transform.y_scale * region.y() + transform.y_offset;
+        int top = int(std::floor(std::min(region_top, region_bottom)));
+        int height = int(std::ceil(std::max(region_top, region_bottom))) - top;
+
+        vector<LineLayer> layers(lineCount());
+
+        // Lines are aggregated in parallel.
+
+        compute_pool().for_each_index(lineCount(), [&](int line)
+        {
+            auto raw_extent = [&](int64_t start, int64_t end)
+            {
+                return min_max(getDataRegion(line, start, end - start));
+            };
+
+            auto value_at = [&](int64_t index)
+            {
+                return valueAt(line, index);
+            };
+
+            auto pyramid = has_pyramids ? m_pyramids[line].get() : nullptr;
+
+            auto columns = from_blocks ?
+                        m4_aggregate_blocks(bounds, *pyramid) :
+                        m4_aggregate(bounds, pyramid, value_at, raw_extent,
+                                     max_unreduced_column_size);
+
+            const auto & t = line_transforms[line];
+
+            // Row in the image, limited to keep lines far outside it cheap.
+            auto y_of = [&](double value)
+            {
+                double y = t.y_scale * value + t.y_offset - top;
+                y = std::max(-1.0, std::min(double(height), y));
+                return int(std::lround(y));
+            };
+
+            layers[line].color = colors[line];
+            appendM4Segments(layers[line].segments, columns, y_of);
+        });
+
+        if (height > 0 && column_count > 0)
+        {
+            QImage image(column_count, height, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            drawLineLayers(image, layers);
+
+            painter->drawImage(first_column, top, image);
+        }
+    }
+    else
+    {
+        if (!hasValues(region_start, region_end + 1))
+        {
+            requestWindow(region_start, region_end + 1);
+            return;
+        }
+
+        painter->save();
+
+        painter->setBrush(Qt::NoBrush);
+        painter->setRenderHint(QPainter::Antialiasing, true);
+
+        for (int line = 0; line < lineCount(); ++line)
+        {
+            QPen line_pen;
+            line_pen.setWidth(1);
+            line_pen.setColor(colors[line]);
+            painter->setPen(line_pen);
+
+            const auto & t = line_transforms[line];
+
+            QPainterPath path;
+
+            bool first = true;
+            for (auto & element : getDataRegion(line, region_start, region_size))
+            {
+                double loc = dim.map * element.location()[m_dim];
+                auto point = t * QPointF(loc, element.value());
+
+                if (first)
+                    path.moveTo(point);
+                else
+                    path.lineTo(point);
+
+                first = false;
+            }
+
+            painter->drawPath(path);
+        }
+
+        painter->restore();
+    }
+}
+
+}
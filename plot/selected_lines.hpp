@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QColor>
+
+#include "plot.hpp"
+#include "../data/array.hpp"
+#include "../data/data_set.hpp"
+#include "../data/minmax_pyramid.hpp"
+#include "../data/memo_cache.hpp"
+#include "../data/reduction.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace datavis {
+
+using std::vector;
+
+// Lines of attributes of a data set along a dimension,
+// at the selected index of the other dimensions,
+// for plots drawing them, like LinePlot and MultiLinePlot.
+//
+// Values of a tiled data set are read in the background
+// for the range being drawn, so the lines are not read whole.
+// Min/max pyramids of all lines are built together in the background,
+// and shared with other plots of the same lines.
+// Work is done with the priority of the plot,
+// and its content changes when more of the lines can be drawn.
+
+class SelectedLines
+{
+public:
+    using data_type = array<double>;
+    using data_region_type = array_region<double>;
+
+    SelectedLines(Plot * plot): m_plot(plot) {}
+
+    void clear();
+    // Selects lines of the attributes along the dimension,
+    // at the selected index of the data set.
+    void setLines(DataSetPtr, int dim, const vector<int> & attributes);
+    // Selects lines at the current selected index of the data set.
+    // Returns whether they changed.
+    bool updateSelection();
+
+    bool isEmpty() const { return m_attributes.empty(); }
+    int lineCount() const { return int(m_attributes.size()); }
+    // Index of the lines, with 0 along the dimension.
+    const vector<int64_t> & selectedIndex() const { return m_selected_index; }
+
+    Plot::Range xRange() const;
+    // Extent of values of all lines within the x range,
+    // including the ones just outside it, connected by lines to it,
+    // as far as the pyramids reduced them. Empty without pyramids.
+    value_extent visibleExtent(const Plot::Range & x_range);
+
+    // Values [start, start + size) of a line.
+    // For a tiled data set, invalid unless they are in the window.
+    data_region_type getDataRegion(int line, int64_t start, int64_t size);
+    // NaN if the value is not in the window of a tiled data set.
+    double valueAt(int line, int64_t index);
+
+    // Draws each line with its color, mapping its values to pixels
+    // using its transform, and x to pixels using the plot transform.
+    // Dense lines are drawn from M4 columns into a single image.
+    void plot(QPainter *, const Mapping2d & transform, const QRectF & region,
+              const vector<Mapping2d> & line_transforms, const vector<QColor> & colors);
+
+private:
+    // Whether values [start, end) of the lines can be read
+    // without reading tiles.
+    bool hasValues(int64_t start, int64_t end) const;
+    // Reads values around [start, end) of the lines
+    // of a tiled data set into the window, in the background.
+    void requestWindow(int64_t start, int64_t end);
+    // Requests the pyramids of the lines,
+    // from memo_cache if another plot already built them.
+    void updatePyramids();
+    // Identifies the pyramids of the lines in memo_cache.
+    memo_key pyramidsKey() const;
+
+    Plot * m_plot;
+
+    DataSetPtr m_dataset = nullptr;
+    int m_dim = -1;
+    vector<int> m_attributes;
+    vector<int64_t> m_selected_index;
+    // Lines of an in-memory data set, one per attribute.
+    vector<data_region_type> m_regions;
+
+    struct Window
+    {
+        int64_t start = 0;
+        int64_t size = 0;
+        // One per line
+        vector<std::shared_ptr<data_type>> data;
+    };
+
+    Window m_window;
+    int64_t m_window_request_start = 0;
+    int64_t m_window_request_end = 0;
+    Reactive::Value<Window> m_window_read;
+    Reactive::Value<void> m_on_window;
+
+    // One per line, set while they are being built.
+    vector<minmax_pyramid_ptr> m_pyramids;
+    Reactive::Value<vector<minmax_pyramid_ptr>> m_pyramids_value;
+};
+
+}
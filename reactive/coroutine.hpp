@@ -0,0 +1,311 @@
+#pragma once
+
+#include "value.hpp"
+
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <iostream>
+
+// Coroutines computing Reactive values.
+//
+// A function returning Value<T> becomes a coroutine when it uses
+// co_await or co_return. Its first parameter must be the executor
+// to run on (after the object, for member functions):
+//
+//   Value<Image> render(Executor & pool, Value<DataSetPtr> data)
+//   {
+//       Status & status = co_await current_status;
+//       auto dataset = co_await data;
+//       auto region = reduce(dataset, status);
+//       co_await resume_on(gui_executor);
+//       co_return draw(region);
+//   }
+//
+// The coroutine starts on the executor. Awaiting a value suspends
+// until it is ready and then continues on the same executor,
+// without a round trip through other threads. A coroutine can move
+// to another executor with co_await resume_on(executor).
+//
+// Like functions run by apply(), coroutines are cancelled when their
+// result is no longer referenced: a suspended coroutine is destroyed,
+// releasing the values it awaits; a running one sees the status
+// cancelled, and co_await throws Cancelled.
+// Coroutines inherit the priority of the scope they were called in.
+
+namespace Reactive {
+
+// co_await current_status gives the coroutine's Status.
+struct Current_Status {};
+inline constexpr Current_Status current_status {};
+
+// co_await resume_on(executor) continues the coroutine on the executor.
+struct Resume_On
+{
+    Executor & executor;
+};
+
+inline Resume_On resume_on(Executor & executor) { return { executor }; }
+
+// A point where a coroutine is suspended.
+// Either resumed or destroyed, whichever is claimed first.
+
+struct Coroutine_Suspension
+{
+    Coroutine_Suspension(std::coroutine_handle<> handle): handle(handle) {}
+
+    bool claim() { return !claimed.exchange(true); }
+
+    std::coroutine_handle<> handle;
+    std::atomic<bool> claimed { false };
+};
+
+using Coroutine_Suspension_Pointer = std::shared_ptr<Coroutine_Suspension>;
+
+// State of a coroutine, owned by its result.
+
+struct Coroutine_Worker : public Worker
+{
+    void cancel() override
+    {
+        Coroutine_Suspension_Pointer suspended;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            status.cancelled = true;
+            suspended.swap(suspension);
+        }
+
+        // Released awaited values may cancel their own workers here.
+        if (suspended && suspended->claim())
+            suspended->handle.destroy();
+    }
+
+    // Returns null if cancelled.
+    Coroutine_Suspension_Pointer suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status.is_cancelled())
+            return nullptr;
+        suspension = std::make_shared<Coroutine_Suspension>(handle);
+        return suspension;
+    }
+
+    void resumed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        suspension = nullptr;
+    }
+
+    // Resumes the coroutine on the executor, unless it is destroyed first.
+    void schedule(const Coroutine_Suspension_Pointer & suspended)
+    {
+        auto priority = this->priority;
+        Priority_Scope scope(priority);
+        executor->execute([suspended, priority]()
+        {
+            Priority_Scope scope(priority);
+            if (suspended->claim())
+                suspended->handle.resume();
+        });
+    }
+
+    Status status;
+    Executor * executor = nullptr;
+    Priority_Pointer priority;
+    std::mutex mutex;
+    Coroutine_Suspension_Pointer suspension;
+};
+
+template <typename T>
+class Value_Awaiter
+{
+public:
+    Value_Awaiter(Value<T> value, std::shared_ptr<Coroutine_Worker> worker):
+        m_value(std::move(value)), m_worker(std::move(worker))
+    {}
+
+    bool await_ready() const { return m_value->ready; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        // Once suspended, the coroutine may be resumed on another thread,
+        // or destroyed, so this awaiter must not be used after that.
+        auto value = m_value;
+        auto worker = m_worker;
+
+        auto suspended = worker->suspend(handle);
+        if (!suspended)
+            return false;
+
+        value->subscribe([worker, suspended]()
+        {
+            worker->schedule(suspended);
+        });
+
+        return true;
+    }
+
+    T await_resume()
+    {
+        m_worker->resumed();
+        m_worker->status.check();
+        return m_value->value;
+    }
+
+private:
+    Value<T> m_value;
+    std::shared_ptr<Coroutine_Worker> m_worker;
+};
+
+class Executor_Awaiter
+{
+public:
+    // Unless check is false, throws Cancelled when resumed if cancelled.
+    Executor_Awaiter(Executor * executor, std::shared_ptr<Coroutine_Worker> worker,
+                     bool check = true):
+        m_executor(executor), m_worker(std::move(worker)), m_check(check)
+    {}
+
+    bool await_ready() const { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        // See Value_Awaiter::await_suspend()
+        auto executor = m_executor;
+        auto worker = m_worker;
+
+        worker->executor = executor;
+
+        auto suspended = worker->suspend(handle);
+        if (!suspended)
+            return false;
+
+        worker->schedule(suspended);
+        return true;
+    }
+
+    void await_resume()
+    {
+        m_worker->resumed();
+        if (m_check)
+            m_worker->status.check();
+    }
+
+private:
+    Executor * m_executor;
+    std::shared_ptr<Coroutine_Worker> m_worker;
+    bool m_check;
+};
+
+template <typename T>
+class Value_Promise
+{
+    static_assert(!std::is_void<T>::value, "Coroutines must have a result.");
+
+public:
+    template <typename ... Args>
+    Value_Promise(Executor & executor, Args && ...)
+    {
+        init(executor);
+    }
+
+    // For member functions
+    template <typename Object, typename ... Args,
+              typename = std::enable_if_t<!std::is_base_of<Executor, std::decay_t<Object>>::value>>
+    Value_Promise(Object &, Executor & executor, Args && ...)
+    {
+        init(executor);
+    }
+
+    Value<T> get_return_object()
+    {
+        auto result = std::make_shared<Value_Data<T>>();
+        result->worker = m_worker;
+        m_result = result;
+        connect_status(m_worker->status, m_result);
+        return result;
+    }
+
+    // Starts on the executor.
+    // Does not throw when cancelled, since the body has not started yet
+    // to handle it. If cancelled while waiting to start, the coroutine
+    // is destroyed instead, or stops at its first co_await.
+    Executor_Awaiter initial_suspend()
+    {
+        return Executor_Awaiter(m_worker->executor, m_worker, false);
+    }
+
+    std::suspend_never final_suspend() noexcept { return {}; }
+
+    void return_value(T value)
+    {
+        auto result = m_result.lock();
+        if (result)
+            result->set(std::move(value));
+    }
+
+    void unhandled_exception()
+    {
+        try
+        {
+            throw;
+        }
+        catch (Cancelled &)
+        {}
+        catch (std::exception & e)
+        {
+            std::cerr << "Reactive: Coroutine failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Reactive: Coroutine failed." << std::endl;
+        }
+    }
+
+    template <typename U>
+    Value_Awaiter<U> await_transform(Value<U> value)
+    {
+        return Value_Awaiter<U>(std::move(value), m_worker);
+    }
+
+    Executor_Awaiter await_transform(Resume_On target)
+    {
+        return Executor_Awaiter(&target.executor, m_worker);
+    }
+
+    auto await_transform(Current_Status)
+    {
+        struct Awaiter
+        {
+            Status & status;
+            bool await_ready() const { return true; }
+            void await_suspend(std::coroutine_handle<>) {}
+            Status & await_resume() { return status; }
+        };
+
+        return Awaiter { m_worker->status };
+    }
+
+private:
+    void init(Executor & executor)
+    {
+        m_worker = std::make_shared<Coroutine_Worker>();
+        m_worker->executor = &executor;
+        m_worker->priority = Priority_Scope::current();
+    }
+
+    std::shared_ptr<Coroutine_Worker> m_worker;
+    std::weak_ptr<Value_Data<T>> m_result;
+};
+
+}
+
+template <typename T, typename ... Args>
+struct std::coroutine_traits<Reactive::Value<T>, Args...>
+{
+    using promise_type = Reactive::Value_Promise<T>;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "executor.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+namespace Reactive {
+
+// Runs tasks on the thread that calls process() or run_until(),
+// for example to receive results on the main thread of a program
+// without a Qt event loop.
+//
+// Any thread can submit tasks. Submission is lock-free: tasks are
+// pushed onto an intrusive multiple-producer single-consumer queue.
+// Only one thread at a time may process tasks.
+
+class Event_Loop : public Executor
+{
+public:
+    Event_Loop()
+    {
+        m_head = &m_stub;
+        m_tail = &m_stub;
+    }
+
+    ~Event_Loop()
+    {
+        // Discard pending tasks.
+        while(Node * node = pop())
+            delete node;
+    }
+
+    Event_Loop(const Event_Loop &) = delete;
+    Event_Loop & operator=(const Event_Loop &) = delete;
+
+    void execute(Task task) override
+    {
+        // Counted before it is pushed, so that the count is never
+        // less than the number of tasks in the queue.
+        m_pending.fetch_add(1);
+
+        push(new Node(std::move(task)));
+
+        if (m_sleeping.load())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wakeup.notify_one();
+        }
+    }
+
+    // Runs pending tasks, including tasks they submit.
+    // Returns the number of tasks run.
+    int process()
+    {
+        int count = 0;
+        while(m_pending.load() > 0)
+        {
+            Node * node = pop();
+            if (!node)
+            {
+                // A task is being submitted.
+                std::this_thread::yield();
+                continue;
+            }
+
+            m_pending.fetch_sub(1);
+
+            node->task();
+            delete node;
+            ++count;
+        }
+        return count;
+    }
+
+    // Runs tasks as they are submitted, until condition() is true
+    // or the timeout expires. Returns the final value of condition().
+    template <typename F>
+    bool run_until(F condition,
+                   std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while(true)
+        {
+            process();
+
+            if (condition())
+                return true;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_sleeping = true;
+            if (m_pending.load() == 0)
+                m_wakeup.wait_until(lock, deadline);
+            m_sleeping = false;
+
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                lock.unlock();
+                process();
+                return condition();
+            }
+        }
+    }
+
+private:
+    struct Node
+    {
+        Node() {}
+        Node(Task task): task(std::move(task)) {}
+        std::atomic<Node*> next { nullptr };
+        Task task;
+    };
+
+    void push(Node * node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node * prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Returns null if the queue is empty,
+    // or a producer has not finished linking its node yet.
+    Node * pop()
+    {
+        Node * tail = m_tail;
+        Node * next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &m_stub)
+        {
+            if (!next)
+                return nullptr;
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next)
+        {
+            m_tail = next;
+            return tail;
+        }
+
+        if (tail != m_head.load(std::memory_order_acquire))
+            return nullptr;
+
+        // Tail is the last node. Put the stub behind it,
+        // so that tail can be unlinked.
+        push(&m_stub);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next)
+        {
+            m_tail = next;
+            return tail;
+        }
+
+        return nullptr;
+    }
+
+    // Producers push at the head, the consumer pops at the tail.
+    std::atomic<Node*> m_head;
+    Node * m_tail;
+    Node m_stub;
+
+    std::atomic<int> m_pending { 0 };
+
+    // Used only to sleep while there are no tasks.
+    std::atomic<bool> m_sleeping { false };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+};
+
+}
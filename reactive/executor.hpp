@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+
+namespace Reactive {
+
+// Runs tasks, possibly on other threads.
+
+class Executor
+{
+public:
+    using Task = std::function<void()>;
+
+    virtual ~Executor() {}
+
+    // Schedules the task to run once.
+    // The task must not throw.
+    virtual void execute(Task task) = 0;
+
+    // Runs one pending task on the calling thread, if supported.
+    // Returns whether a task was run.
+    // Lets threads waiting for tasks help instead of blocking.
+    virtual bool run_one() { return false; }
+};
+
+// Runs tasks immediately on the calling thread.
+
+class Inline_Executor : public Executor
+{
+public:
+    void execute(Task task) override { task(); }
+};
+
+}
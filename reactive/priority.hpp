@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace Reactive {
+
+// How urgently work is needed, from most to least urgent.
+
+enum class Priority
+{
+    // Needed to respond to the user, for example by the focused plot.
+    interactive,
+    // Needed to show something on screen.
+    visible,
+    // Likely to be needed soon, for example the next data tile.
+    prefetch,
+    // Not needed for anything visible.
+    idle
+};
+
+constexpr int priority_count = 4;
+
+inline int level(Priority p) { return int(p); }
+
+// A priority shared by all work for one purpose, for example a plot.
+// Changing it also changes the priority of work that is already queued.
+
+class Priority_Token
+{
+public:
+    Priority_Token(Priority p = Priority::visible): m_level(level(p)) {}
+
+    Priority get() const { return Priority(m_level.load(std::memory_order_relaxed)); }
+
+    void set(Priority p)
+    {
+        if (m_level.exchange(level(p), std::memory_order_relaxed) != level(p))
+            s_epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    // Changes whenever the priority of any token changes,
+    // so that queues know when to reorder.
+    static std::uint64_t epoch() { return s_epoch.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<int> m_level;
+    static inline std::atomic<std::uint64_t> s_epoch { 0 };
+};
+
+using Priority_Pointer = std::shared_ptr<Priority_Token>;
+
+inline Priority_Pointer make_priority(Priority p)
+{
+    return std::make_shared<Priority_Token>(p);
+}
+
+// The priority of work on this thread.
+// Work submitted while a scope is active inherits its priority.
+// Executors set it while running a task, so that tasks
+// submitted by other tasks inherit their priority.
+
+class Priority_Scope
+{
+public:
+    Priority_Scope(Priority_Pointer priority):
+        m_previous(std::move(t_current))
+    {
+        t_current = std::move(priority);
+    }
+
+    ~Priority_Scope()
+    {
+        t_current = std::move(m_previous);
+    }
+
+    Priority_Scope(const Priority_Scope &) = delete;
+    Priority_Scope & operator=(const Priority_Scope &) = delete;
+
+    // Null if no scope is active.
+    static const Priority_Pointer & current() { return t_current; }
+
+    // Priority::visible if no scope is active.
+    static Priority current_priority()
+    {
+        return t_current ? t_current->get() : Priority::visible;
+    }
+
+private:
+    Priority_Pointer m_previous;
+    static inline thread_local Priority_Pointer t_current;
+};
+
+// Lets long-running work give way to more urgent work
+// at block boundaries, see Status::yield().
+// Executors that support it install one on their threads.
+
+class Preemptor
+{
+public:
+    virtual ~Preemptor() {}
+
+    // Runs pending work more urgent than the current priority
+    // on the calling thread. Returns whether any was run.
+    virtual bool preempt() = 0;
+
+    static Preemptor * current() { return t_current; }
+
+protected:
+    static inline thread_local Preemptor * t_current = nullptr;
+};
+
+}
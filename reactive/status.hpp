@@ -0,0 +1,144 @@
+#pragma once
+
+#include "priority.hpp"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <string>
+#include <any>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace Reactive {
+
+// Thrown by Status::check() to abandon cancelled work.
+
+struct Cancelled : public std::exception
+{
+    const char * what() const noexcept override { return "Cancelled."; }
+};
+
+// Progress of a function towards its result.
+
+struct Progress
+{
+    // In [0, 1], or negative if unknown.
+    double fraction = -1;
+    // Number of bytes processed, or 0 if unknown.
+    std::int64_t bytes = 0;
+    // What is being done, for example "Reading".
+    std::string phase;
+    // Whether the work failed or was abandoned,
+    // so its value never becomes ready.
+    bool failed = false;
+};
+
+// Limits the rate of updates.
+
+class Throttle
+{
+public:
+    Throttle(std::chrono::milliseconds interval): m_interval(interval.count()) {}
+
+    // Whether the interval has passed since the last update.
+    bool due() const
+    {
+        return now() - m_last.load(std::memory_order_relaxed) >= m_interval;
+    }
+
+    // Returns whether an update is due, and if so, records it.
+    bool take()
+    {
+        auto last = m_last.load(std::memory_order_relaxed);
+        auto t = now();
+        if (t - last < m_interval)
+            return false;
+        return m_last.compare_exchange_strong(last, t);
+    }
+
+private:
+    static std::int64_t now()
+    {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::int64_t m_interval;
+    std::atomic<std::int64_t> m_last { std::numeric_limits<std::int64_t>::min() / 2 };
+};
+
+// State of a running function, shared with the owner of its result.
+// The function is cancelled when its result is no longer referenced.
+// Long-running functions should check the status between blocks of work,
+// and return early or throw Cancelled when cancelled.
+// Where they hold no locks, they should yield instead, which also lets
+// more urgent work run first.
+//
+// Functions can also report progress and publish partial results.
+// Both are throttled, so they can be reported as often as convenient.
+
+struct Status
+{
+    using Progress_Handler = std::function<void(const Progress &)>;
+    using Partial_Handler = std::function<void(std::any)>;
+
+    std::atomic<bool> cancelled { false };
+
+    bool is_cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+    // Throws Cancelled if cancelled.
+    void check() const
+    {
+        if (is_cancelled())
+            throw Cancelled();
+    }
+
+    // Like check(), but first runs pending work of higher priority
+    // on this thread, if the executor supports it.
+    // Must not be called while holding locks that such work may need.
+    void yield() const
+    {
+        check();
+        if (auto preemptor = Preemptor::current())
+        {
+            if (preemptor->preempt())
+                check();
+        }
+    }
+
+    void report_progress(const Progress & progress)
+    {
+        if (progress_handler && progress_throttle.take())
+            progress_handler(progress);
+    }
+
+    void report_progress(double fraction, std::int64_t bytes, const std::string & phase)
+    {
+        if (progress_handler && progress_throttle.due())
+            report_progress(Progress { fraction, bytes, phase });
+    }
+
+    // Whether a partial result would be published now.
+    // Use to avoid preparing partial results in vain.
+    bool partial_due() const { return partial_handler && partial_throttle.due(); }
+
+    // Publishes a snapshot of the result, which must be of the
+    // result type of the function.
+    template <typename T>
+    void publish_partial(T value)
+    {
+        if (partial_handler && partial_throttle.take())
+            partial_handler(std::any(std::move(value)));
+    }
+
+    // Set by the owner of the result before the function runs.
+    Progress_Handler progress_handler;
+    Partial_Handler partial_handler;
+
+    Throttle progress_throttle { std::chrono::milliseconds(50) };
+    Throttle partial_throttle { std::chrono::milliseconds(250) };
+};
+
+}
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "executor.hpp"
+#include "status.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Reactive {
+
+// A graph of small tasks with dependencies, for fine-grained parallelism,
+// such as a task per tile.
+//
+// Tasks are added first, then the whole graph is run. Compared to
+// Reactive::apply, tasks are cheap:
+// - Nodes and dependency edges are allocated from blocks owned by the graph,
+//   which are reused after clear().
+// - Each task is called directly, not through a std::function.
+// - A task's result is stored in its node. Dependent tasks read it
+//   with get(), or move it out with take().
+// - When a task finishes, the thread runs one ready successor right away
+//   and submits only the others to the executor.
+// - The thread running the graph only helps with tasks of the graph,
+//   never with other work of the executor, so it may hold locks meanwhile.
+//
+// A graph is not thread-safe while it is being built.
+
+class Task_Graph
+{
+    struct Node;
+
+public:
+    // An untyped reference to a task, for use as a dependency.
+    class Task_Ref
+    {
+    public:
+        Task_Ref() {}
+        bool is_valid() const { return m_node != nullptr; }
+
+    protected:
+        friend class Task_Graph;
+        Task_Ref(Node * node): m_node(node) {}
+        Node * m_node = nullptr;
+    };
+
+    // A task with a result of type R.
+    // The result is valid once the task has run,
+    // that is in dependent tasks and after run().
+    template <typename R>
+    class Task : public Task_Ref
+    {
+    public:
+        Task() {}
+
+        // Deduced, so that they are only instantiated when used,
+        // which is never for void results.
+        decltype(auto) get() const { return *result_node()->result; }
+        auto take() const { return std::move(*result_node()->result); }
+
+    private:
+        friend class Task_Graph;
+        Task(Node * node): Task_Ref(node) {}
+
+        auto result_node() const { return static_cast<Result_Node<R>*>(m_node); }
+    };
+
+    Task_Graph() {}
+
+    ~Task_Graph()
+    {
+        clear();
+    }
+
+    Task_Graph(const Task_Graph &) = delete;
+    Task_Graph & operator=(const Task_Graph &) = delete;
+
+    int task_count() const { return m_task_count; }
+
+    // Adds a task that calls fn() after all dependencies have run.
+    template <typename F>
+    auto add(F fn, std::initializer_list<Task_Ref> dependencies = {})
+    {
+        return add_task(std::move(fn), dependencies);
+    }
+
+    // Adds a task that depends on each task in a container.
+    template <typename F, typename Dependencies>
+    auto add(F fn, const Dependencies & dependencies)
+    {
+        return add_task(std::move(fn), dependencies);
+    }
+
+    // Runs all tasks using the executor and waits until they are done.
+    // The calling thread helps run tasks of the graph.
+    // When a task throws, or the status is cancelled, remaining tasks
+    // are skipped, and the exception or Cancelled is thrown.
+    void run(Executor & executor, const Status * status = nullptr)
+    {
+        if (!m_task_count)
+            return;
+
+        m_executor = &executor;
+        m_status = status;
+        m_error = nullptr;
+        m_failed = false;
+        m_done = false;
+        m_remaining = m_task_count;
+
+        for (Node * node = m_nodes; node; node = node->next_node)
+            node->pending.store(node->dependency_count, std::memory_order_relaxed);
+
+        for (Node * node = m_nodes; node; node = node->next_node)
+        {
+            if (node->dependency_count == 0)
+                submit(node);
+        }
+
+        while(m_remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (Node * node = take_ready(*m_ready))
+            {
+                execute(node);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished.wait_for(lock, std::chrono::milliseconds(1),
+                                [&]{ return m_done; });
+        }
+
+        // Wait until the last task is completely done with the graph.
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished.wait(lock, [&]{ return m_done; });
+        }
+
+        m_executor = nullptr;
+        m_status = nullptr;
+
+        if (m_error)
+            std::rethrow_exception(m_error);
+
+        if (status)
+            status->check();
+    }
+
+    // Destroys all tasks and their results, keeping allocated memory.
+    void clear()
+    {
+        Node * node = m_nodes;
+        while(node)
+        {
+            Node * next = node->next_node;
+            node->~Node();
+            node = next;
+        }
+
+        m_nodes = nullptr;
+        m_last_node = nullptr;
+        m_task_count = 0;
+
+        // Keep the first block for reuse.
+        if (m_blocks.size() > 1)
+            m_blocks.resize(1);
+        m_block_used = 0;
+    }
+
+private:
+    struct Edge
+    {
+        Node * to;
+        Edge * next;
+    };
+
+    struct Node
+    {
+        virtual ~Node() {}
+        virtual void invoke() = 0;
+
+        Node * next_node = nullptr;
+        Edge * successors = nullptr;
+        int dependency_count = 0;
+        std::atomic<int> pending { 0 };
+    };
+
+    template <typename R>
+    struct Result_Node : Node
+    {
+        // Void results are never stored.
+        std::optional<std::conditional_t<std::is_void<R>::value, char, R>> result;
+    };
+
+    template <typename R, typename F>
+    struct Function_Node : Result_Node<R>
+    {
+        Function_Node(F && fn): fn(std::move(fn)) {}
+        void invoke() override { this->result.emplace(fn()); }
+        F fn;
+    };
+
+    template <typename F>
+    struct Function_Node<void, F> : Result_Node<void>
+    {
+        Function_Node(F && fn): fn(std::move(fn)) {}
+        void invoke() override { fn(); }
+        F fn;
+    };
+
+    template <typename F, typename Dependencies>
+    auto add_task(F && fn, const Dependencies & dependencies)
+    {
+        using R = typename std::result_of<F()>::type;
+        using Node_Type = Function_Node<R, F>;
+
+        auto node = new (allocate(sizeof(Node_Type), alignof(Node_Type))) Node_Type(std::move(fn));
+
+        if (m_last_node)
+            m_last_node->next_node = node;
+        else
+            m_nodes = node;
+        m_last_node = node;
+        ++m_task_count;
+
+        for (const Task_Ref & dependency : dependencies)
+        {
+            if (!dependency.m_node)
+                continue;
+
+            auto edge = new (allocate(sizeof(Edge), alignof(Edge))) Edge;
+            edge->to = node;
+            edge->next = dependency.m_node->successors;
+            dependency.m_node->successors = edge;
+
+            ++node->dependency_count;
+        }
+
+        return Task<R>(node);
+    }
+
+    // Nodes ready to run, shared with their tasks in the executor,
+    // which may only run once the graph is done, and then find none.
+    struct Ready_Nodes
+    {
+        std::mutex mutex;
+        std::vector<Node*> nodes;
+    };
+
+    static Node * take_ready(Ready_Nodes & ready)
+    {
+        std::lock_guard<std::mutex> lock(ready.mutex);
+        if (ready.nodes.empty())
+            return nullptr;
+        Node * node = ready.nodes.back();
+        ready.nodes.pop_back();
+        return node;
+    }
+
+    void submit(Node * node)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_ready->mutex);
+            m_ready->nodes.push_back(node);
+        }
+
+        // The graph is alive while it has a node to run.
+        m_executor->execute([this, ready = m_ready]()
+        {
+            if (Node * node = take_ready(*ready))
+                execute(node);
+        });
+    }
+
+    void execute(Node * node)
+    {
+        while(node)
+        {
+            bool skip = m_failed.load(std::memory_order_relaxed) ||
+                    (m_status && m_status->is_cancelled());
+
+            if (!skip)
+            {
+                try
+                {
+                    node->invoke();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_error)
+                        m_error = std::current_exception();
+                    m_failed = true;
+                }
+            }
+
+            // Continue with one ready successor on this thread.
+
+            Node * next = nullptr;
+
+            for (Edge * edge = node->successors; edge; edge = edge->next)
+            {
+                if (edge->to->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (!next)
+                        next = edge->to;
+                    else
+                        submit(edge->to);
+                }
+            }
+
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done = true;
+                m_finished.notify_all();
+            }
+
+            node = next;
+        }
+    }
+
+    void * allocate(size_t size, size_t alignment)
+    {
+        if (size > block_size)
+            throw std::bad_alloc();
+
+        if (m_blocks.empty())
+            m_blocks.emplace_back(new Block);
+
+        size_t offset = (m_block_used + alignment - 1) & ~(alignment - 1);
+
+        if (offset + size > block_size)
+        {
+            m_blocks.emplace_back(new Block);
+            offset = 0;
+        }
+
+        m_block_used = offset + size;
+
+        return m_blocks.back()->data + offset;
+    }
+
+    static constexpr size_t block_size = 64 * 1024;
+
+    struct Block
+    {
+        alignas(std::max_align_t) char data[block_size];
+    };
+
+    std::vector<std::unique_ptr<Block>> m_blocks;
+    size_t m_block_used = 0;
+
+    Node * m_nodes = nullptr;
+    Node * m_last_node = nullptr;
+    int m_task_count = 0;
+
+    Executor * m_executor = nullptr;
+    const Status * m_status = nullptr;
+    std::shared_ptr<Ready_Nodes> m_ready = std::make_shared<Ready_Nodes>();
+    std::atomic<int> m_remaining { 0 };
+    std::atomic<bool> m_failed { false };
+    std::exception_ptr m_error;
+    bool m_done = false;
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+};
+
+}
@@ -1,4 +1,9 @@
 #include "reactive.hpp"
+#include "thread_pool.hpp"
+#include "event_loop.hpp"
+#include "task_graph.hpp"
+#include "coroutine.hpp"
+#include "trace.hpp"
 #include "../testing/testing.h"
 
 #include <QCoreApplication>
@@ -6,6 +11,9 @@
 
 #include <thread>
 #include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
 
 using namespace Testing;
 using namespace Reactive;
@@ -131,6 +139,1007 @@ bool test_cancel_thread()
     return test.success();
 }
 
+// Waits until the value is ready or the timeout expires.
+template <typename T>
+static bool wait_for(const Value<T> & v, int timeout_ms = 5000)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    while(!v->ready)
+    {
+        if (chrono::steady_clock::now() > deadline)
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool test_executor()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+
+    auto v1 = Reactive::apply(pool, [](Status&){ return 10; });
+    auto v2 = Reactive::apply(pool, [](Status&){ return 15; });
+    auto v3 = Reactive::apply(pool, [](Status&, int a, int b){ return a + b; }, v1, v2);
+
+    test.assert("Result is ready.", wait_for(v3));
+    test.assert(v3->value == 25) << "Result: " << v3->value;
+
+    return test.success();
+}
+
+// Independent functions run in parallel.
+bool test_executor_parallel()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+
+    atomic<int> running { 0 };
+    atomic<int> max_running { 0 };
+
+    auto f = [&](Status&)
+    {
+        int r = ++running;
+        int m = max_running;
+        while(r > m && !max_running.compare_exchange_weak(m, r)) {}
+        this_thread::sleep_for(chrono::milliseconds(100));
+        --running;
+        return 0;
+    };
+
+    auto v1 = Reactive::apply(pool, f);
+    auto v2 = Reactive::apply(pool, f);
+
+    test.assert("Results are ready.", wait_for(v1) && wait_for(v2));
+    test.assert(max_running == 2) << "Max running: " << max_running;
+
+    return test.success();
+}
+
+// A function with multiple args runs once, even when args become
+// ready concurrently.
+bool test_executor_runs_once()
+{
+    Test test;
+
+    Thread_Pool pool(4);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        atomic<int> count { 0 };
+
+        auto a = Reactive::apply(pool, [](Status&){ return 1; });
+        auto b = Reactive::apply(pool, [](Status&){ return 2; });
+        auto c = Reactive::apply(pool, [&](Status&, int x, int y){ ++count; return x + y; }, a, b);
+
+        if (!wait_for(c))
+        {
+            test.assert(false) << "Result not ready.";
+            break;
+        }
+
+        // Give a potential second run a chance.
+        this_thread::sleep_for(chrono::microseconds(100));
+
+        if (count != 1)
+        {
+            test.assert(false) << "Function ran " << count << " times.";
+            break;
+        }
+    }
+
+    return test.success();
+}
+
+// Dropping the last reference to a result cancels the functions
+// it depends on.
+bool test_cancel_chain()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+
+    atomic<bool> started { false };
+    atomic<bool> stopped { false };
+    atomic<bool> consumer_ran { false };
+
+    auto producer = [&](Status & status)
+    {
+        started = true;
+        try
+        {
+            while(true)
+            {
+                status.check();
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+        }
+        catch (Cancelled &)
+        {
+            stopped = true;
+            throw;
+        }
+        return 0;
+    };
+
+    auto consumer = [&](Status&, int x)
+    {
+        consumer_ran = true;
+        return x;
+    };
+
+    {
+        auto result = Reactive::apply(pool, consumer, Reactive::apply(pool, producer));
+
+        while(!started)
+            this_thread::yield();
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while(!stopped && chrono::steady_clock::now() < deadline)
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    test.assert("Producer was cancelled.", stopped.load());
+    test.assert("Consumer did not run.", !consumer_ran);
+
+    return test.success();
+}
+
+// A function whose result is dropped before it starts never runs.
+bool test_cancel_before_start()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+    atomic<bool> ran { false };
+
+    auto blocker = Reactive::apply(pool, [&](Status&)
+    {
+        while(!release)
+            this_thread::yield();
+        return 0;
+    });
+
+    {
+        auto result = Reactive::apply(pool, [&](Status&){ ran = true; return 0; });
+    }
+
+    release = true;
+
+    test.assert("Blocker is done.", wait_for(blocker));
+
+    // Give the pool a chance to dequeue the dropped task.
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    test.assert("Function did not run.", !ran);
+
+    return test.success();
+}
+
+// Waits until the condition is true or the timeout expires.
+template <typename F>
+static bool wait_until(F condition, int timeout_ms = 5000)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    while(!condition())
+    {
+        if (chrono::steady_clock::now() > deadline)
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool test_progress()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+    atomic<int> notifications { 0 };
+
+    auto result = Reactive::apply(pool, [&](Status & status)
+    {
+        status.report_progress(0.5, 100, "Working");
+        while(!release)
+            this_thread::yield();
+        return 0;
+    });
+
+    result->subscribe_progress([&](){ ++notifications; });
+
+    test.assert("Progress was reported.",
+                wait_until([&](){ return result->get_progress().fraction == 0.5; }));
+
+    auto progress = result->get_progress();
+    test.assert(progress.bytes == 100) << "Bytes: " << progress.bytes;
+    test.assert(progress.phase == "Working") << "Phase: " << progress.phase;
+
+    release = true;
+
+    test.assert("Result is ready.", wait_for(result));
+    test.assert("Progress is complete.", result->get_progress().fraction == 1);
+    test.assert("Subscriber was notified of completion.",
+                wait_until([&](){ return notifications >= 1; }));
+
+    return test.success();
+}
+
+// Progress subscribers learn when a value never becomes ready.
+bool test_progress_failed()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<int> notifications { 0 };
+    atomic<bool> subscribed { false };
+
+    auto failing = Reactive::apply(pool, [&](Status &) -> int
+    {
+        while(!subscribed)
+            this_thread::yield();
+        throw std::runtime_error("Failed.");
+    });
+
+    failing->subscribe_progress([&](){ ++notifications; });
+    subscribed = true;
+
+    test.assert("Progress failed.", wait_until([&](){ return failing->get_progress().failed; }));
+    test.assert("Subscriber was notified of failure.", notifications >= 1);
+    test.assert("Value is not ready.", !failing->ready);
+
+    atomic<bool> release { false };
+    atomic<int> destroyed_notifications { 0 };
+
+    auto abandoned = Reactive::apply(pool, [&](Status &)
+    {
+        while(!release)
+            this_thread::yield();
+        return 0;
+    });
+
+    abandoned->subscribe_progress([&](){ ++destroyed_notifications; });
+    abandoned = nullptr;
+    release = true;
+
+    test.assert(destroyed_notifications == 1)
+            << "Notifications of destroyed value: " << destroyed_notifications;
+
+    return test.success();
+}
+
+bool test_partial()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+
+    auto result = Reactive::apply(pool, [&](Status & status)
+    {
+        status.publish_partial(5);
+        while(!release)
+            this_thread::yield();
+        return 10;
+    });
+
+    test.assert("Partial value was published.",
+                wait_until([&](){ return bool(result->get_partial()); }));
+
+    auto partial = result->get_partial();
+    test.assert(partial && *partial == 5) << "Partial: " << (partial ? *partial : -1);
+
+    release = true;
+
+    test.assert("Result is ready.", wait_for(result));
+    test.assert(result->value == 10) << "Value: " << result->value;
+    test.assert("Partial value is cleared.", !result->get_partial());
+
+    return test.success();
+}
+
+bool test_progress_throttle()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<int> notifications { 0 };
+    atomic<bool> subscribed { false };
+
+    auto result = Reactive::apply(pool, [&](Status & status)
+    {
+        while(!subscribed)
+            this_thread::yield();
+
+        for (int i = 0; i < 100000; ++i)
+            status.report_progress(i / 100000.0, 0, "");
+        return 0;
+    });
+
+    result->subscribe_progress([&](){ ++notifications; });
+    subscribed = true;
+
+    test.assert("Result is ready.", wait_for(result));
+
+    // One notification every 50 ms at most, plus one for completion.
+    // The loop takes far less than 50 ms per 1000 iterations.
+    test.assert(notifications < 100) << "Notifications: " << notifications;
+
+    Throttle throttle(chrono::hours(1));
+    test.assert("First update is due.", throttle.take());
+    test.assert("Second update is not due.", !throttle.due() && !throttle.take());
+
+    return test.success();
+}
+
+bool test_forward_progress()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+
+    auto source = Reactive::apply(pool, [&](Status & status)
+    {
+        status.report_progress(0.25, 0, "Reading");
+        status.publish_partial(5);
+        while(!release)
+            this_thread::yield();
+        return 10;
+    });
+
+    auto target = Reactive::apply(pool, [](Status&, int x) { return x * 2; }, source);
+
+    forward_progress(source, target, [](int x) { return x * 2; });
+
+    test.assert("Partial value was forwarded.",
+                wait_until([&](){ return bool(target->get_partial()); }));
+
+    auto partial = target->get_partial();
+    test.assert(partial && *partial == 10) << "Partial: " << (partial ? *partial : -1);
+    test.assert("Progress was forwarded.", target->get_progress().fraction == 0.25);
+
+    release = true;
+
+    test.assert("Result is ready.", wait_for(target));
+    test.assert(target->value == 20) << "Value: " << target->value;
+
+    return test.success();
+}
+
+// Results computed in a pool are received on the thread running the loop.
+bool test_event_loop()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+    Event_Loop loop;
+
+    auto loop_thread = this_thread::get_id();
+    thread::id pool_thread;
+    thread::id receiver_thread;
+
+    auto computed = Reactive::apply(pool, [&](Status&)
+    {
+        pool_thread = this_thread::get_id();
+        return 21;
+    });
+
+    auto received = Reactive::apply(loop, [&](Status&, int x)
+    {
+        receiver_thread = this_thread::get_id();
+        return x * 2;
+    },
+    computed);
+
+    test.assert("Result is ready.", loop.run_until([&](){ return bool(received->ready); }));
+    test.assert(received->value == 42) << "Value: " << received->value;
+    test.assert("Computed in the pool.", pool_thread != loop_thread);
+    test.assert("Received in the loop.", receiver_thread == loop_thread);
+
+    return test.success();
+}
+
+// Many threads submitting to a loop at once.
+bool test_event_loop_producers()
+{
+    Test test;
+
+    Event_Loop loop;
+
+    const int producer_count = 4;
+    const int task_count = 10000;
+
+    int run_count = 0;
+
+    vector<thread> producers;
+    for (int p = 0; p < producer_count; ++p)
+    {
+        producers.emplace_back([&]()
+        {
+            for (int i = 0; i < task_count; ++i)
+                loop.execute([&](){ ++run_count; });
+        });
+    }
+
+    bool done = loop.run_until([&](){ return run_count == producer_count * task_count; });
+
+    for (auto & producer : producers)
+        producer.join();
+
+    loop.process();
+
+    test.assert("All tasks ran.", done);
+    test.assert(run_count == producer_count * task_count) << "Run count: " << run_count;
+
+    return test.success();
+}
+
+// Results are passed to dependent tasks, and moved rather than copied.
+bool test_task_graph()
+{
+    Test test;
+
+    Thread_Pool pool(4);
+    Task_Graph graph;
+
+    auto a = graph.add([]{ return make_unique<int>(3); });
+    auto b = graph.add([]{ return make_unique<int>(4); });
+
+    // Diamond: c and d both depend on a and b, e depends on c and d.
+    auto c = graph.add([=]{ return *a.get() + *b.get(); }, { a, b });
+    auto d = graph.add([=]{ return *a.get() * *b.get(); }, { a, b });
+    auto e = graph.add([=]{ return make_unique<int>(c.get() * 100 + d.get()); }, { c, d });
+
+    graph.run(pool);
+
+    unique_ptr<int> result = e.take();
+    test.assert(result && *result == 712) << "Result: " << (result ? *result : -1);
+
+    return test.success();
+}
+
+// Many small tasks with a dependency on a dynamic number of tasks.
+bool test_task_graph_many()
+{
+    Test test;
+
+    Thread_Pool pool(4);
+    Task_Graph graph;
+
+    const int count = 10000;
+
+    for (int round = 0; round < 3; ++round)
+    {
+        graph.clear();
+
+        vector<Task_Graph::Task<int64_t>> parts;
+        for (int i = 0; i < count; ++i)
+            parts.push_back(graph.add([i]{ return int64_t(i); }));
+
+        auto sum = graph.add([&]
+        {
+            int64_t s = 0;
+            for (auto & part : parts)
+                s += part.get();
+            return s;
+        },
+        parts);
+
+        graph.run(pool);
+
+        int64_t expected = int64_t(count) * (count - 1) / 2;
+        test.assert(sum.get() == expected) << "Round " << round << ": " << sum.get();
+        test.assert(graph.task_count() == count + 1) << "Task count: " << graph.task_count();
+    }
+
+    return test.success();
+}
+
+// An exception skips remaining tasks and is rethrown.
+bool test_task_graph_exception()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+    Task_Graph graph;
+
+    atomic<bool> dependent_ran { false };
+
+    auto a = graph.add([]() -> int { throw std::runtime_error("Failed."); });
+    graph.add([&]{ dependent_ran = true; }, { a });
+
+    bool thrown = false;
+    try { graph.run(pool); }
+    catch (std::runtime_error &) { thrown = true; }
+
+    test.assert("Exception was rethrown.", thrown);
+    test.assert("Dependent task did not run.", !dependent_ran);
+
+    // Runs in a pool thread, waiting for tasks in the same pool.
+    Thread_Pool single(1);
+    Task_Graph inner;
+    int64_t inner_result = 0;
+
+    auto outer = Reactive::apply(single, [&](Status & status)
+    {
+        auto x = inner.add([]{ return int64_t(2); });
+        auto y = inner.add([=]{ return x.get() * 21; }, { x });
+        inner.run(single, &status);
+        inner_result = y.get();
+        return 0;
+    });
+
+    test.assert("Nested graph finished.", wait_for(outer));
+    test.assert(inner_result == 42) << "Nested result: " << inner_result;
+
+    return test.success();
+}
+
+// The thread running a graph only helps with tasks of the graph,
+// so other queued tasks cannot run while it holds a lock.
+bool test_task_graph_own_tasks()
+{
+    Test test;
+
+    Thread_Pool single(1);
+
+    std::mutex lock;
+    atomic<bool> graph_running { false };
+    atomic<bool> other_ran_inside { false };
+    atomic<bool> other_done { false };
+
+    auto outer = Reactive::apply(single, [&](Status & status)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Queued on the same thread, and more urgent than the tasks of the graph.
+        {
+            Priority_Scope urgent(make_priority(Priority::interactive));
+            single.submit([&]
+            {
+                // Would lock the mutex again on the same thread.
+                if (graph_running)
+                {
+                    other_ran_inside = true;
+                    other_done = true;
+                    return;
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                other_done = true;
+            });
+        }
+
+        Task_Graph graph;
+        auto x = graph.add([]{ return 1; });
+        graph.add([=]{ return x.get() + 1; }, { x });
+
+        graph_running = true;
+        graph.run(single, &status);
+        graph_running = false;
+        return 0;
+    });
+
+    test.assert("Graph finished.", wait_for(outer));
+    test.assert("Other task done.", wait_until([&]{ return other_done.load(); }));
+    test.assert("Other task not run inside the graph.", !other_ran_inside);
+
+    return test.success();
+}
+
+// Queued tasks are taken in order of priority,
+// including priorities changed while queued.
+bool test_priority_order()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    // Keep the only thread busy while queueing.
+    atomic<bool> release { false };
+    pool.submit([&]{ while(!release) std::this_thread::yield(); });
+
+    mutex order_mutex;
+    vector<string> order;
+    atomic<int> done_count { 0 };
+
+    auto submit = [&](const Priority_Pointer & priority, string name)
+    {
+        Priority_Scope scope(priority);
+        pool.submit([&, name]
+        {
+            {
+                lock_guard<mutex> lock(order_mutex);
+                order.push_back(name);
+            }
+            ++done_count;
+        });
+    };
+
+    auto raised = make_priority(Priority::idle);
+
+    submit(make_priority(Priority::idle), "idle");
+    submit(make_priority(Priority::prefetch), "prefetch");
+    submit(raised, "raised");
+    submit(make_priority(Priority::visible), "visible");
+    submit(nullptr, "default");
+    submit(make_priority(Priority::interactive), "interactive");
+
+    raised->set(Priority::interactive);
+
+    release = true;
+
+    test.assert("All tasks ran.", wait_until([&]{ return done_count == 6; }));
+
+    // The order of tasks with the same priority is not specified.
+    map<string, int> levels = {
+        { "interactive", 0 }, { "raised", 0 }, { "default", 1 },
+        { "visible", 1 }, { "prefetch", 2 }, { "idle", 3 }
+    };
+
+    test.assert(order.size() == 6) << "Task count: " << order.size();
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        test.assert(levels[order[i-1]] <= levels[order[i]])
+                << order[i-1] << " ran before " << order[i];
+    }
+
+    return test.success();
+}
+
+// A task that yields lets more urgent tasks run first.
+bool test_priority_preemption()
+{
+    Test test;
+
+    Thread_Pool pool(1);
+
+    atomic<bool> started { false };
+    atomic<bool> urgent_done { false };
+    atomic<bool> urgent_during_long { false };
+    atomic<bool> long_done { false };
+
+    {
+        Priority_Scope scope(make_priority(Priority::idle));
+        auto long_task = Reactive::apply(pool, [&](Status & status)
+        {
+            started = true;
+            for (int i = 0; i < 10000 && !urgent_done; ++i)
+            {
+                status.yield();
+                std::this_thread::sleep_for(chrono::microseconds(100));
+            }
+            urgent_during_long = urgent_done.load();
+            long_done = true;
+            return 0;
+        });
+
+        test.assert("Long task started.", wait_until([&]{ return started.load(); }));
+
+        {
+            Priority_Scope scope(make_priority(Priority::interactive));
+            pool.submit([&]{ urgent_done = true; });
+        }
+
+        test.assert("Long task finished.", wait_for(long_task));
+    }
+
+    test.assert("Urgent task ran while long task was running.", urgent_during_long.load());
+
+    // Tasks of the same or lower priority are not run by yield().
+
+    atomic<bool> other_done { false };
+    atomic<bool> other_during_long { false };
+    started = false;
+
+    auto long_task = Reactive::apply(pool, [&](Status & status)
+    {
+        started = true;
+        for (int i = 0; i < 50; ++i)
+        {
+            status.yield();
+            std::this_thread::sleep_for(chrono::microseconds(100));
+        }
+        other_during_long = other_done.load();
+        return 0;
+    });
+
+    test.assert("Second long task started.", wait_until([&]{ return started.load(); }));
+
+    {
+        Priority_Scope scope(make_priority(Priority::idle));
+        pool.submit([&]{ other_done = true; });
+    }
+
+    test.assert("Second long task finished.", wait_for(long_task));
+    test.assert("Less urgent task did not preempt.", !other_during_long);
+    test.assert("Less urgent task ran later.", wait_until([&]{ return other_done.load(); }));
+
+    return test.success();
+}
+
+// A pipeline of stages on different executors, as straight-line code.
+static Value<int> coroutine_pipeline(Executor & pool, Event_Loop & loop, Value<int> input,
+                                     vector<thread::id> & threads)
+{
+    Status & status = co_await current_status;
+
+    int x = co_await input;
+    threads.push_back(this_thread::get_id());
+    status.report_progress(0.5, 0, "Half");
+
+    // Already ready, so continues without suspending.
+    int y = co_await Reactive::value(2);
+
+    int z = co_await Reactive::apply(pool, [](Status&, int v) { return v + 1; },
+                                     Reactive::value(x * y));
+    threads.push_back(this_thread::get_id());
+
+    co_await resume_on(loop);
+    threads.push_back(this_thread::get_id());
+
+    co_return z * 2;
+}
+
+bool test_coroutine()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+    Event_Loop loop;
+
+    auto loop_thread = this_thread::get_id();
+
+    auto input = Reactive::apply(pool, [](Status&) { return 10; });
+
+    vector<thread::id> threads;
+    auto result = coroutine_pipeline(pool, loop, input, threads);
+
+    test.assert("Result is ready.", loop.run_until([&](){ return bool(result->ready); }));
+    test.assert(result->value == 42) << "Value: " << result->value;
+    test.assert(threads.size() == 3) << "Stages: " << threads.size();
+    if (threads.size() == 3)
+    {
+        test.assert("First stages ran in the pool.",
+                    threads[0] != loop_thread && threads[1] != loop_thread);
+        test.assert("Last stage ran in the loop.", threads[2] == loop_thread);
+    }
+    test.assert("Progress is complete.", result->get_progress().fraction == 1);
+
+    return test.success();
+}
+
+struct Destruction_Flag
+{
+    atomic<bool> & flag;
+    ~Destruction_Flag() { flag = true; }
+};
+
+static Value<int> coroutine_waiting(Executor & pool, Value<int> input,
+                                    atomic<bool> & started, atomic<bool> & destroyed)
+{
+    Destruction_Flag flag { destroyed };
+    started = true;
+    int x = co_await input;
+    co_return x;
+}
+
+// Dropping the result destroys a suspended coroutine,
+// which cancels what it awaits.
+bool test_coroutine_cancel()
+{
+    Test test;
+
+    Thread_Pool pool(2);
+
+    atomic<bool> input_cancelled { false };
+    atomic<bool> release { false };
+    atomic<bool> started { false };
+    atomic<bool> destroyed { false };
+
+    {
+        auto input = Reactive::apply(pool, [&](Status & status)
+        {
+            while(!status.is_cancelled() && !release)
+                this_thread::yield();
+            input_cancelled = status.is_cancelled();
+            return 1;
+        });
+
+        auto result = coroutine_waiting(pool, input, started, destroyed);
+        input = nullptr;
+
+        test.assert("Coroutine started.", wait_until([&]{ return started.load(); }));
+
+        // Give the coroutine time to suspend.
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    test.assert("Coroutine destroyed.", wait_until([&]{ return destroyed.load(); }));
+    test.assert("Awaited value cancelled.", wait_until([&]{ return input_cancelled.load(); }));
+
+    release = true;
+
+    return test.success();
+}
+
+static int count_occurrences(const string & text, const string & pattern)
+{
+    int count = 0;
+    for (auto pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1))
+        ++count;
+    return count;
+}
+
+static bool test_trace()
+{
+    Test test;
+
+    Trace::clear();
+
+    {
+        Trace_Span span("trace-test-disabled");
+    }
+
+    Trace::set_enabled(true);
+
+    {
+        Trace_Span span("trace-test-span", "test");
+        span.set_bytes(1234);
+    }
+
+    {
+        Thread_Pool pool(1, "TracePool");
+
+        atomic<bool> done { false };
+        pool.submit([&]()
+        {
+            Trace_Span span("trace-test-task");
+            this_thread::sleep_for(chrono::milliseconds(5));
+            done = true;
+        });
+
+        test.assert("Task done.", wait_until([&]{ return done.load(); }));
+    }
+
+    Trace::set_enabled(false);
+
+    ostringstream out;
+    Trace::write_json(out);
+    string json = out.str();
+
+    test.assert("Disabled span not recorded.",
+                json.find("trace-test-disabled") == string::npos);
+    test.assert("Span recorded.", json.find("\"name\":\"trace-test-span\"") != string::npos);
+    test.assert("Span category.", json.find("\"cat\":\"test\"") != string::npos);
+    test.assert("Span bytes.", json.find("\"bytes\":1234") != string::npos);
+    test.assert("Span in task recorded.", json.find("trace-test-task") != string::npos);
+    test.assert("Task recorded.", json.find("\"name\":\"TracePool\"") != string::npos);
+    test.assert("Task wait recorded.", json.find("\"wait_us\":") != string::npos);
+    test.assert("Pool thread named.", json.find("\"TracePool 0\"") != string::npos);
+
+    Trace::clear();
+
+    ostringstream cleared;
+    Trace::write_json(cleared);
+    test.assert("Cleared.", cleared.str().find("trace-test-span") == string::npos);
+
+    return test.success();
+}
+
+// Threads only get a buffer once they record events.
+static bool test_trace_lazy_buffer()
+{
+    Test test;
+
+    Trace::set_enabled(false);
+
+    {
+        Thread_Pool pool(1, "UntracedPool");
+
+        atomic<bool> done { false };
+        pool.submit([&]()
+        {
+            Trace_Span span("trace-test-untraced");
+            done = true;
+        });
+
+        test.assert("Task done.", wait_until([&]{ return done.load(); }));
+    }
+
+    ostringstream out;
+    Trace::write_json(out);
+
+    test.assert("Untraced thread not exported.",
+                out.str().find("\"UntracedPool 0\"") == string::npos);
+
+    return test.success();
+}
+
+static bool test_trace_overflow()
+{
+    Test test;
+
+    Trace::clear();
+    Trace::set_enabled(true);
+
+    int extra = 10;
+
+    thread t([&]()
+    {
+        for (size_t i = 0; i < Trace::buffer_capacity + extra; ++i)
+        {
+            Trace_Span span("trace-test-overflow");
+        }
+    });
+    t.join();
+
+    Trace::set_enabled(false);
+
+    ostringstream out;
+    Trace::write_json(out);
+
+    int count = count_occurrences(out.str(), "trace-test-overflow");
+    test.assert(count == int(Trace::buffer_capacity))
+            << "Events: " << count;
+
+    Trace::clear();
+
+    return test.success();
+}
+
+// Exporting while a thread records events, which overwrite the ones
+// being exported. Run with a thread sanitizer to check for data races.
+static bool test_trace_concurrent_export()
+{
+    Test test;
+
+    Trace::clear();
+    Trace::set_enabled(true);
+
+    atomic<bool> done { false };
+
+    thread t([&]()
+    {
+        for (size_t i = 0; i < 4 * Trace::buffer_capacity; ++i)
+        {
+            Trace_Span span("trace-test-concurrent");
+        }
+        done = true;
+    });
+
+    int exports = 0;
+    while (!done || exports == 0)
+    {
+        ostringstream out;
+        Trace::write_json(out);
+        ++exports;
+
+        int count = count_occurrences(out.str(), "trace-test-concurrent");
+        if (count > int(Trace::buffer_capacity))
+        {
+            test.assert(false) << "Events: " << count;
+            break;
+        }
+    }
+
+    t.join();
+
+    Trace::set_enabled(false);
+    Trace::clear();
+
+    return test.success();
+}
+
 Test_Set reactive_tests()
 {
     return {
@@ -138,5 +1147,29 @@ Test_Set reactive_tests()
         { "immediate-value", &test_immediate_value },
         { "cancel", &test_cancel },
         { "cancel-thread", &test_cancel_thread },
+        { "executor", &test_executor },
+        { "executor-parallel", &test_executor_parallel },
+        { "executor-runs-once", &test_executor_runs_once },
+        { "cancel-chain", &test_cancel_chain },
+        { "cancel-before-start", &test_cancel_before_start },
+        { "progress", &test_progress },
+        { "progress-failed", &test_progress_failed },
+        { "partial", &test_partial },
+        { "progress-throttle", &test_progress_throttle },
+        { "forward-progress", &test_forward_progress },
+        { "event-loop", &test_event_loop },
+        { "event-loop-producers", &test_event_loop_producers },
+        { "task-graph", &test_task_graph },
+        { "task-graph-many", &test_task_graph_many },
+        { "task-graph-exception", &test_task_graph_exception },
+        { "task-graph-own-tasks", &test_task_graph_own_tasks },
+        { "priority-order", &test_priority_order },
+        { "priority-preemption", &test_priority_preemption },
+        { "coroutine", &test_coroutine },
+        { "coroutine-cancel", &test_coroutine_cancel },
+        { "trace", &test_trace },
+        { "trace-lazy-buffer", &test_trace_lazy_buffer },
+        { "trace-overflow", &test_trace_overflow },
+        { "trace-concurrent-export", &test_trace_concurrent_export },
     };
 }
@@ -0,0 +1,356 @@
+#pragma once
+
+#include "executor.hpp"
+#include "priority.hpp"
+#include "trace.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+namespace Reactive {
+
+// A pool of threads with a task queue per thread.
+// Tasks submitted from a pool thread go to that thread's queue,
+// other tasks are distributed round-robin.
+// Idle threads steal tasks from the front of other threads' queues,
+// while the owner takes from the back.
+//
+// Tasks have the priority of the Priority_Scope they were submitted in,
+// and more urgent tasks are always taken first. When a priority token
+// changes, queued tasks are reordered. Tasks running on the pool
+// can let more urgent tasks run first by calling Status::yield().
+//
+// When tracing is enabled, each task is recorded with the pool's name
+// and the time it waited in the queue.
+
+class Thread_Pool : public Executor, public Preemptor
+{
+public:
+    // The name must outlive the pool, for example a string literal.
+    Thread_Pool(int thread_count = 0, const char * name = "Pool"):
+        m_name(name)
+    {
+        if (thread_count < 1)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        for (int i = 0; i < thread_count; ++i)
+            m_queues.emplace_back(new Queue);
+
+        for (int i = 0; i < thread_count; ++i)
+            m_threads.emplace_back([this, i](){ work(i); });
+    }
+
+    ~Thread_Pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+
+        for (auto & thread : m_threads)
+            thread.join();
+    }
+
+    Thread_Pool(const Thread_Pool &) = delete;
+    Thread_Pool & operator=(const Thread_Pool &) = delete;
+
+    int thread_count() const { return int(m_threads.size()); }
+
+    void execute(Task task) override
+    {
+        submit(std::move(task));
+    }
+
+    void submit(Task task)
+    {
+        int index = current_index();
+        if (index < 0)
+            index = m_next_queue++ % m_queues.size();
+
+        auto priority = Priority_Scope::current();
+        int l = priority ? level(priority->get()) : level(Priority::visible);
+
+        {
+            auto & queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks[l].push_back({ std::move(task), std::move(priority),
+                                       Trace::enabled() ? Trace::now() : -1 });
+            ++m_level_pending[l];
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_pending;
+        }
+        m_wakeup.notify_one();
+    }
+
+    // Runs one pending task on the calling thread, if any.
+    // Returns whether a task was run.
+    bool run_one() override
+    {
+        Entry entry;
+        if (!take(current_index(), priority_count - 1, entry))
+            return false;
+        run(entry);
+        return true;
+    }
+
+    // Runs pending tasks more urgent than the current one
+    // on the calling thread, which must be a pool thread.
+    bool preempt() override
+    {
+        if (current_index() < 0)
+            return false;
+
+        bool any = false;
+
+        while(true)
+        {
+            int current = level(Priority_Scope::current_priority());
+            if (current == 0)
+                break;
+
+            Entry entry;
+            if (!take(current_index(), current - 1, entry))
+                break;
+
+            run(entry);
+            any = true;
+        }
+
+        return any;
+    }
+
+    // Calls fn(i) for each i in [0, count), distributing the calls
+    // among the pool threads and the calling thread.
+    // Returns when all calls are done.
+    // Rethrows the first exception thrown by fn.
+    template <typename F>
+    void for_each_index(int count, F fn)
+    {
+        if (count <= 0)
+            return;
+
+        struct State
+        {
+            std::atomic<int> next { 0 };
+            int count = 0;
+            int done = 0;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        auto state = std::make_shared<State>();
+        state->count = count;
+
+        // The function lives on the caller's stack, but helpers only
+        // call it after claiming an index, and the caller does not return
+        // before all claimed indices are done.
+        auto run = [state, &fn]()
+        {
+            int i;
+            while((i = state->next++) < state->count)
+            {
+                std::exception_ptr error;
+                try { fn(i); }
+                catch (...) { error = std::current_exception(); }
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (error && !state->error)
+                    state->error = error;
+                if (++state->done == state->count)
+                    state->finished.notify_all();
+            }
+        };
+
+        int helper_count = std::min(count - 1, thread_count());
+        for (int h = 0; h < helper_count; ++h)
+            submit(run);
+
+        run();
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->finished.wait(lock, [&]{ return state->done == state->count; });
+        }
+
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+private:
+    struct Entry
+    {
+        Task task;
+        Priority_Pointer priority;
+        // Time of submission, if traced
+        std::int64_t submitted = -1;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        // A deque per priority level
+        std::deque<Entry> tasks[priority_count];
+    };
+
+    int current_index() const
+    {
+        return t_pool == this ? t_index : -1;
+    }
+
+    // Takes the most urgent task with priority level at most max_level.
+    bool take(int own_index, int max_level, Entry & entry)
+    {
+        if (m_epoch.load(std::memory_order_relaxed) != Priority_Token::epoch())
+            reorder();
+
+        int queue_count = m_queues.size();
+        int start = own_index >= 0 ? own_index + 1 : 0;
+
+        for (int l = 0; l <= max_level; ++l)
+        {
+            if (m_level_pending[l].load(std::memory_order_relaxed) == 0)
+                continue;
+
+            if (own_index >= 0)
+            {
+                auto & queue = *m_queues[own_index];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                auto & tasks = queue.tasks[l];
+                if (!tasks.empty())
+                {
+                    entry = std::move(tasks.back());
+                    tasks.pop_back();
+                    --m_level_pending[l];
+                    took();
+                    return true;
+                }
+            }
+
+            for (int k = 0; k < queue_count; ++k)
+            {
+                auto & queue = *m_queues[(start + k) % queue_count];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                auto & tasks = queue.tasks[l];
+                if (!tasks.empty())
+                {
+                    entry = std::move(tasks.front());
+                    tasks.pop_front();
+                    --m_level_pending[l];
+                    took();
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Moves queued tasks whose priority changed to the right level.
+    void reorder()
+    {
+        m_epoch = Priority_Token::epoch();
+
+        for (auto & queue : m_queues)
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+
+            std::deque<Entry> moved[priority_count];
+
+            for (int l = 0; l < priority_count; ++l)
+            {
+                auto & tasks = queue->tasks[l];
+                auto kept = tasks.begin();
+                for (auto it = tasks.begin(); it != tasks.end(); ++it)
+                {
+                    int new_level = it->priority ? level(it->priority->get()) : l;
+                    if (new_level == l)
+                    {
+                        if (kept != it)
+                            *kept = std::move(*it);
+                        ++kept;
+                    }
+                    else
+                    {
+                        moved[new_level].push_back(std::move(*it));
+                        --m_level_pending[l];
+                        ++m_level_pending[new_level];
+                    }
+                }
+                tasks.erase(kept, tasks.end());
+            }
+
+            for (int l = 0; l < priority_count; ++l)
+            {
+                for (auto & entry : moved[l])
+                    queue->tasks[l].push_back(std::move(entry));
+            }
+        }
+    }
+
+    void run(Entry & entry)
+    {
+        Priority_Scope scope(std::move(entry.priority));
+        Trace_Span span(m_name, "task");
+        if (entry.submitted >= 0)
+            span.set_wait(Trace::now() - entry.submitted);
+        entry.task();
+    }
+
+    void took()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_pending;
+    }
+
+    void work(int index)
+    {
+        t_pool = this;
+        t_index = index;
+        Preemptor::t_current = this;
+        Trace::set_thread_name(std::string(m_name) + " " + std::to_string(index));
+
+        while(true)
+        {
+            Entry entry;
+            if (take(index, priority_count - 1, entry))
+            {
+                run(entry);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait(lock, [&]{ return m_stopping || m_pending > 0; });
+            if (m_stopping && m_pending == 0)
+                break;
+        }
+    }
+
+    static inline thread_local Thread_Pool * t_pool = nullptr;
+    static inline thread_local int t_index = -1;
+
+    const char * m_name;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<unsigned> m_next_queue { 0 };
+    std::atomic<int> m_level_pending[priority_count] {};
+    std::atomic<std::uint64_t> m_epoch { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    int m_pending = 0;
+    bool m_stopping = false;
+};
+
+}
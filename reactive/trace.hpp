@@ -0,0 +1,328 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <algorithm>
+
+namespace Reactive {
+
+// Low-overhead tracing of tasks and named spans of work,
+// exported in the Chrome trace format, which can be viewed
+// in chrome://tracing or ui.perfetto.dev.
+//
+// Each thread records events into its own ring buffer, which only
+// that thread writes, so recording takes no locks. A thread's buffer
+// is allocated when it records its first event. When a buffer is full,
+// its oldest events are overwritten. Buffers are read while exporting:
+// each slot has a sequence number, checked before and after reading it,
+// and events overwritten meanwhile are skipped.
+//
+// Tracing is disabled by default, and then a span costs
+// one relaxed atomic load.
+
+class Trace
+{
+public:
+    struct Event
+    {
+        // Must outlive the trace, for example a string literal.
+        const char * name = nullptr;
+        const char * category = nullptr;
+        // Nanoseconds since the trace clock started
+        std::int64_t begin = 0;
+        std::int64_t end = 0;
+        // Nanoseconds a task waited in a queue, or negative if unknown
+        std::int64_t wait = -1;
+        // Bytes processed, or negative if unknown
+        std::int64_t bytes = -1;
+    };
+
+    // Number of events kept per thread.
+    static constexpr std::size_t buffer_capacity = 1 << 16;
+
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void set_enabled(bool enabled) { s_enabled = enabled; }
+
+    static std::int64_t now()
+    {
+        using namespace std::chrono;
+        static const auto start = steady_clock::now();
+        return duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    }
+
+    static void record(const Event & event)
+    {
+        auto & b = buffer();
+        auto index = b.count.load(std::memory_order_relaxed);
+        b.events[index % buffer_capacity].store(index, event);
+        b.count.store(index + 1, std::memory_order_release);
+    }
+
+    // Name of the calling thread in exported traces.
+    static void set_thread_name(const std::string & name)
+    {
+        thread_name() = name;
+
+        auto & b = thread_buffer();
+        if (!b)
+            return;
+
+        std::lock_guard<std::mutex> lock(b->name_mutex);
+        b->name = name;
+    }
+
+    // Drops recorded events.
+    static void clear()
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        for (auto & b : registry().buffers)
+            b->start = b->count.load(std::memory_order_acquire);
+    }
+
+    // Writes recorded events of all threads as Chrome trace JSON.
+    static void write_json(std::ostream & out)
+    {
+        out << "{\"traceEvents\":[\n";
+
+        bool first = true;
+        auto separate = [&]()
+        {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+
+        std::lock_guard<std::mutex> lock(registry().mutex);
+
+        for (auto & b : registry().buffers)
+        {
+            {
+                std::lock_guard<std::mutex> name_lock(b->name_mutex);
+                separate();
+                out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->id
+                    << ",\"args\":{\"name\":\"" << escaped(b->name) << "\"}}";
+            }
+
+            auto count = b->count.load(std::memory_order_acquire);
+            auto begin = std::max(b->start, count > buffer_capacity ? count - buffer_capacity : 0);
+
+            // Skips events the thread overwrote meanwhile.
+            std::vector<Event> events;
+            events.reserve(count - begin);
+            for (auto i = begin; i < count; ++i)
+            {
+                Event event;
+                if (b->events[i % buffer_capacity].load(i, event))
+                    events.push_back(event);
+            }
+
+            for (std::size_t i = 0; i < events.size(); ++i)
+            {
+                auto & e = events[i];
+                separate();
+                out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->id
+                    << ",\"name\":\"" << escaped(e.name) << "\""
+                    << ",\"cat\":\"" << escaped(e.category) << "\""
+                    << ",\"ts\":" << e.begin / 1000.0
+                    << ",\"dur\":" << (e.end - e.begin) / 1000.0
+                    << ",\"args\":{";
+                bool first_arg = true;
+                if (e.wait >= 0)
+                {
+                    out << "\"wait_us\":" << e.wait / 1000.0;
+                    first_arg = false;
+                }
+                if (e.bytes >= 0)
+                {
+                    if (!first_arg)
+                        out << ",";
+                    out << "\"bytes\":" << e.bytes;
+                }
+                out << "}}";
+            }
+        }
+
+        out << "\n]}\n";
+    }
+
+    // Returns whether the file was written.
+    static bool save(const std::string & path)
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        write_json(file);
+        return bool(file);
+    }
+
+private:
+    // An event of a ring buffer, which may be read while it is overwritten.
+    // The sequence number is 2 * index + 1 while the event of that index
+    // is being written, and 2 * index + 2 once it is written.
+    // Fields are atomic, so reading them meanwhile is not a data race,
+    // and relaxed, so they cost about as much as plain fields.
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence { 0 };
+        std::atomic<const char *> name { nullptr };
+        std::atomic<const char *> category { nullptr };
+        std::atomic<std::int64_t> begin { 0 };
+        std::atomic<std::int64_t> end { 0 };
+        std::atomic<std::int64_t> wait { -1 };
+        std::atomic<std::int64_t> bytes { -1 };
+
+        // Only called by the thread owning the buffer.
+        void store(std::uint64_t index, const Event & e)
+        {
+            sequence.store(2 * index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            name.store(e.name, std::memory_order_relaxed);
+            category.store(e.category, std::memory_order_relaxed);
+            begin.store(e.begin, std::memory_order_relaxed);
+            end.store(e.end, std::memory_order_relaxed);
+            wait.store(e.wait, std::memory_order_relaxed);
+            bytes.store(e.bytes, std::memory_order_relaxed);
+
+            sequence.store(2 * index + 2, std::memory_order_release);
+        }
+
+        // Whether the slot holds the complete event of the index.
+        bool load(std::uint64_t index, Event & e) const
+        {
+            if (sequence.load(std::memory_order_acquire) != 2 * index + 2)
+                return false;
+
+            e.name = name.load(std::memory_order_relaxed);
+            e.category = category.load(std::memory_order_relaxed);
+            e.begin = begin.load(std::memory_order_relaxed);
+            e.end = end.load(std::memory_order_relaxed);
+            e.wait = wait.load(std::memory_order_relaxed);
+            e.bytes = bytes.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return sequence.load(std::memory_order_relaxed) == 2 * index + 2;
+        }
+    };
+
+    struct Thread_Buffer
+    {
+        int id = 0;
+        std::vector<Slot> events = std::vector<Slot>(buffer_capacity);
+        std::atomic<std::uint64_t> count { 0 };
+        // First event not cleared, guarded by the registry mutex.
+        std::uint64_t start = 0;
+        std::mutex name_mutex;
+        std::string name;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        // Kept after threads end, to export their events.
+        std::vector<std::shared_ptr<Thread_Buffer>> buffers;
+    };
+
+    static Registry & registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    static std::shared_ptr<Thread_Buffer> & thread_buffer()
+    {
+        static thread_local std::shared_ptr<Thread_Buffer> b;
+        return b;
+    }
+
+    static std::string & thread_name()
+    {
+        static thread_local std::string name;
+        return name;
+    }
+
+    // The calling thread's buffer, allocated on first use.
+    static Thread_Buffer & buffer()
+    {
+        auto & b = thread_buffer();
+        if (b)
+            return *b;
+
+        b = std::make_shared<Thread_Buffer>();
+
+        auto & r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        b->id = int(r.buffers.size()) + 1;
+        b->name = thread_name().empty() ? "Thread " + std::to_string(b->id) : thread_name();
+        r.buffers.push_back(b);
+
+        return *b;
+    }
+
+    static std::string escaped(const std::string & text)
+    {
+        std::string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (c >= 0 && c < 0x20)
+                continue;
+            result += c;
+        }
+        return result;
+    }
+
+    static std::string escaped(const char * text) { return escaped(std::string(text ? text : "")); }
+
+    static inline std::atomic<bool> s_enabled { false };
+};
+
+// Records the time from construction to destruction,
+// if tracing is enabled on construction.
+
+class Trace_Span
+{
+public:
+    // The name and category must outlive the trace,
+    // for example string literals.
+    Trace_Span(const char * name, const char * category = "span")
+    {
+        if (!Trace::enabled())
+            return;
+
+        m_active = true;
+        m_event.name = name;
+        m_event.category = category;
+        m_event.begin = Trace::now();
+    }
+
+    ~Trace_Span()
+    {
+        if (!m_active)
+            return;
+
+        m_event.end = Trace::now();
+        Trace::record(m_event);
+    }
+
+    Trace_Span(const Trace_Span &) = delete;
+    Trace_Span & operator=(const Trace_Span &) = delete;
+
+    void set_bytes(std::int64_t bytes) { m_event.bytes = bytes; }
+    void set_wait(std::int64_t nanoseconds) { m_event.wait = nanoseconds; }
+
+private:
+    Trace::Event m_event;
+    bool m_active = false;
+};
+
+}
@@ -0,0 +1,470 @@
+#pragma once
+
+#include "executor.hpp"
+#include "status.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <iostream>
+
+// Values computed asynchronously by functions of other values.
+// This part does not depend on Qt, so it can be used in command line
+// tools, tests and benchmarks. Functions run on executors, for example
+// a Thread_Pool, or an Event_Loop that runs them on a particular thread.
+// See reactive.hpp for running functions in the Qt event loop.
+
+namespace Reactive {
+
+template <typename F>
+inline
+auto for_each(F)
+{}
+
+template <typename F, typename A>
+inline
+auto for_each(F fn, A arg)
+{
+    fn(arg);
+}
+
+template <typename F, typename A, typename ...As>
+inline
+auto for_each(F fn, A arg, As ... args)
+{
+    fn(arg);
+    for_each(fn, args...);
+}
+
+struct Worker
+{
+    virtual ~Worker() {}
+    virtual void cancel() = 0;
+};
+
+using Worker_Pointer = std::shared_ptr<Worker>;
+
+template <typename T>
+struct Value_Data
+{
+    using Subscriber = std::function<void()>;
+
+    ~Value_Data()
+    {
+        if (worker)
+            worker->cancel();
+
+        // The value never becomes ready.
+        if (!ready)
+        {
+            for (auto & subscriber : progress_subscribers)
+                subscriber();
+        }
+    }
+
+    // Stores the value and notifies subscribers,
+    // on the calling thread.
+    void set(T v)
+    {
+        std::vector<Subscriber> notified;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            value = std::move(v);
+            ready = true;
+            progress.fraction = 1;
+            partial = nullptr;
+            notified.swap(subscribers);
+            notified.insert(notified.end(), progress_subscribers.begin(), progress_subscribers.end());
+            progress_subscribers.clear();
+        }
+
+        for (auto & subscriber : notified)
+            subscriber();
+    }
+
+    // Stores progress and notifies progress subscribers,
+    // on the calling thread.
+    void set_progress(const Progress & p)
+    {
+        std::vector<Subscriber> notified;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready)
+                return;
+            progress = p;
+            notified = progress_subscribers;
+        }
+
+        for (auto & subscriber : notified)
+            subscriber();
+    }
+
+    // Stores a partial value and notifies progress subscribers,
+    // on the calling thread.
+    void set_partial(T v)
+    {
+        std::vector<Subscriber> notified;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready)
+                return;
+            partial = std::make_shared<const T>(std::move(v));
+            notified = progress_subscribers;
+        }
+
+        for (auto & subscriber : notified)
+            subscriber();
+    }
+
+    // Marks the progress as failed and notifies progress subscribers,
+    // on the calling thread, when the value will never become ready.
+    void set_failed()
+    {
+        std::vector<Subscriber> notified;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready)
+                return;
+            progress.failed = true;
+            notified = progress_subscribers;
+        }
+
+        for (auto & subscriber : notified)
+            subscriber();
+    }
+
+    Progress get_progress()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return progress;
+    }
+
+    // The latest partial value, or null if none.
+    std::shared_ptr<const T> get_partial()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return partial;
+    }
+
+    // Calls subscriber once the value is ready.
+    // If it is already ready, calls it immediately.
+    void subscribe(Subscriber subscriber)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready)
+            {
+                subscribers.push_back(std::move(subscriber));
+                return;
+            }
+        }
+
+        subscriber();
+    }
+
+    // Calls subscriber whenever progress or a partial value is updated,
+    // and once more when the value is ready, or when it is destroyed
+    // before being ready. Does nothing if the value is already ready.
+    void subscribe_progress(Subscriber subscriber)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready)
+            progress_subscribers.push_back(std::move(subscriber));
+    }
+
+    std::mutex mutex;
+    Worker_Pointer worker;
+    std::vector<Subscriber> subscribers;
+    std::atomic<bool> ready { false };
+    T value;
+
+    std::vector<Subscriber> progress_subscribers;
+    Progress progress;
+    std::shared_ptr<const T> partial;
+};
+
+template <>
+struct Value_Data<void>
+{
+    ~Value_Data()
+    {
+        if (worker)
+            worker->cancel();
+    }
+
+    Worker_Pointer worker;
+    std::atomic<bool> done { false };
+};
+
+template <typename T>
+using Value = std::shared_ptr<Value_Data<T>>;
+
+// Calls a function with the values of its arguments, once they are all ready,
+// and stores the result.
+// When cancelled, the worker releases its arguments, so that functions
+// producing them are cancelled too, unless their results are used elsewhere.
+
+template <typename R, typename ...A>
+struct Function_Worker : public Worker
+{
+    bool allArgsReady()
+    {
+        std::lock_guard<std::mutex> lock(args_mutex);
+
+        // Args are released when cancelled or started.
+        if (status.is_cancelled() || started)
+            return false;
+
+        bool ready = true;
+
+        std::apply([&](const Value<A> & ... arg)
+        {
+            std::vector<bool> states = { arg->ready.load() ... };
+            for (bool v : states)
+                ready &= v;
+        },
+        args);
+
+        return ready;
+    }
+
+    // Whether all arguments are ready and the function has not been
+    // started yet. Returns true only once.
+    bool claim()
+    {
+        return allArgsReady() && !started.exchange(true);
+    }
+
+    void run()
+    {
+        // Also for executors that do not track priority,
+        // so that work started by the function inherits it.
+        Priority_Scope scope(priority);
+
+        // Only this function needs the args now.
+        std::tuple<Value<A>...> args;
+        {
+            std::lock_guard<std::mutex> lock(args_mutex);
+            if (status.is_cancelled())
+                return;
+            args.swap(this->args);
+        }
+
+        try
+        {
+            if constexpr (std::is_void<R>::value)
+            {
+                std::apply([this](const Value<A> & ... arg)
+                {
+                    fn(status, arg->value...);
+                },
+                args);
+
+                auto real_result = result.lock();
+                if (real_result)
+                    real_result->done = true;
+            }
+            else
+            {
+                auto r = std::apply([this](const Value<A> & ... arg)
+                {
+                    return fn(status, arg->value...);
+                },
+                args);
+
+                auto real_result = result.lock();
+                if (real_result)
+                    real_result->set(std::move(r));
+            }
+        }
+        catch (Cancelled &)
+        {}
+        catch (std::exception & e)
+        {
+            std::cerr << "Reactive: Function failed: " << e.what() << std::endl;
+            failed();
+        }
+        catch (...)
+        {
+            std::cerr << "Reactive: Function failed." << std::endl;
+            failed();
+        }
+    }
+
+    void failed()
+    {
+        // Values of functions without a result have no progress.
+        if constexpr (!std::is_void<R>::value)
+        {
+            auto real_result = result.lock();
+            if (real_result)
+                real_result->set_failed();
+        }
+    }
+
+    void cancel() override
+    {
+        std::tuple<Value<A>...> released;
+        {
+            std::lock_guard<std::mutex> lock(args_mutex);
+            status.cancelled = true;
+            released.swap(args);
+        }
+        // Released args may cancel their own workers here.
+    }
+
+    std::function<R(Status&, A...)> fn;
+    std::tuple<Value<A>...> args;
+    std::mutex args_mutex;
+    std::weak_ptr<Value_Data<R>> result;
+    Status status;
+    std::atomic<bool> started { false };
+    // Of the scope in which the function was applied.
+    Priority_Pointer priority;
+};
+
+// Lets a function report progress and partial results to its result.
+
+template <typename R>
+void connect_status(Status & status, const std::weak_ptr<Value_Data<R>> & weak_result)
+{
+    // Functions without a result do not report progress.
+    if constexpr (!std::is_void<R>::value)
+    {
+        status.progress_handler = [weak_result](const Progress & progress)
+        {
+            auto result = weak_result.lock();
+            if (result)
+                result->set_progress(progress);
+        };
+
+        status.partial_handler = [weak_result](std::any partial)
+        {
+            auto result = weak_result.lock();
+            auto * value = std::any_cast<R>(&partial);
+            if (result && value)
+                result->set_partial(std::move(*value));
+        };
+    }
+}
+
+template <typename R, typename ... A>
+void connect_status(Function_Worker<R, A...> & worker)
+{
+    connect_status(worker.status, worker.result);
+}
+
+// Runs the function using the executor, once all args are ready.
+// The function is submitted with the priority of the current
+// Priority_Scope, even if args become ready on another thread.
+// The executor must outlive the result.
+template <typename F, typename ... A> inline
+auto apply(Executor & executor, F fn, Value<A> ...arg)
+-> Value<typename std::result_of<F(Status&,A...)>::type>
+{
+    using R = typename std::result_of<F(Status&,A...)>::type;
+
+    auto result = std::make_shared<Value_Data<R>>();
+
+    using Worker = Function_Worker<R,A...>;
+
+    auto worker = std::make_shared<Worker>();
+    worker->fn = fn;
+    worker->result = result;
+    worker->args = std::make_tuple(arg...);
+    worker->priority = Priority_Scope::current();
+    connect_status(*worker);
+
+    // This makes worker's lifetime depend on
+    // the lifetime of it's result.
+    result->worker = worker;
+
+    std::weak_ptr<Worker> weak_worker = worker;
+    Executor * executor_ptr = &executor;
+
+    auto notify = [weak_worker, executor_ptr]()
+    {
+        auto worker = weak_worker.lock();
+        if (worker && worker->claim())
+        {
+            Priority_Scope scope(worker->priority);
+            executor_ptr->execute([worker](){ worker->run(); });
+        }
+    };
+
+    if (sizeof...(arg))
+        for_each([&](auto arg){ arg->subscribe(notify); }, arg...);
+    else
+        notify();
+
+    return result;
+}
+
+template <typename T> inline
+Value<T> value(T v)
+{
+    auto result = std::make_shared<Value_Data<T>>();
+    result->ready = true;
+    result->progress.fraction = 1;
+    result->value = v;
+    return result;
+}
+
+// Reports progress of one value as progress of another,
+// for example of a loading step as progress of the final result.
+// Partial values are converted using convert.
+template <typename T, typename U, typename F> inline
+void forward_progress(const Value<T> & from, const Value<U> & to, F convert)
+{
+    std::weak_ptr<Value_Data<T>> weak_from = from;
+    std::weak_ptr<Value_Data<U>> weak_to = to;
+
+    // Last forwarded partial value, to convert each one only once.
+    struct Forwarded
+    {
+        std::mutex mutex;
+        std::shared_ptr<const T> partial;
+    };
+    auto forwarded = std::make_shared<Forwarded>();
+
+    auto forward = [weak_from, weak_to, convert, forwarded]()
+    {
+        auto source = weak_from.lock();
+        auto target = weak_to.lock();
+        if (!source || !target || source->ready)
+            return;
+
+        target->set_progress(source->get_progress());
+
+        auto partial = source->get_partial();
+        if (!partial)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(forwarded->mutex);
+            if (partial == forwarded->partial)
+                return;
+            forwarded->partial = partial;
+        }
+
+        target->set_partial(convert(*partial));
+    };
+
+    from->subscribe_progress(forward);
+
+    // Forward what was reported before subscribing.
+    forward();
+}
+
+template <typename T, typename U> inline
+void forward_progress(const Value<T> & from, const Value<U> & to)
+{
+    forward_progress(from, to, [](const T & v) -> U { return v; });
+}
+
+}
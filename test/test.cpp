@@ -5,13 +5,37 @@ using Testing::Test_Set;
 extern Test_Set text_source_tests();
 extern Test_Set async_tests();
 extern Test_Set reactive_tests();
+extern Test_Set array_region_tests();
+extern Test_Set array_storage_tests();
+extern Test_Set tiled_array_tests();
+extern Test_Set reduction_tests();
+extern Test_Set parallel_tests();
+extern Test_Set data_set_tests();
+extern Test_Set expression_tests();
+extern Test_Set memo_cache_tests();
+extern Test_Set dataset_cache_tests();
+extern Test_Set minmax_pyramid_tests();
+extern Test_Set m4_tests();
+extern Test_Set line_raster_tests();
 
 int main(int argc, char *argv[])
 {
     Test_Set tests =
     {
         { "text-source", text_source_tests() },
-        { "reactive", reactive_tests() }
+        { "reactive", reactive_tests() },
+        { "array-region", array_region_tests() },
+        { "array-storage", array_storage_tests() },
+        { "tiled-array", tiled_array_tests() },
+        { "reduction", reduction_tests() },
+        { "parallel", parallel_tests() },
+        { "data-set", data_set_tests() },
+        { "expression", expression_tests() },
+        { "memo-cache", memo_cache_tests() },
+        { "dataset-cache", dataset_cache_tests() },
+        { "minmax-pyramid", minmax_pyramid_tests() },
+        { "m4", m4_tests() },
+        { "line-raster", line_raster_tests() }
     };
 
     return Testing::run(tests, argc, argv);
@@ -0,0 +1,276 @@
+#include "../testing/testing.h"
+#include "../data/array.hpp"
+#include "../data/parallel.hpp"
+#include "../data/reduction.hpp"
+
+#include <vector>
+#include <iostream>
+#include <sys/mman.h>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static datavis::array<double> make_array(const vector<int64_t> & size)
+{
+    datavis::array<double> a(size);
+    int64_t count = flat_size(size);
+    for (int64_t i = 0; i < count; ++i)
+        a.data()[i] = i;
+    return a;
+}
+
+// Values visited by spans must match values visited by the element iterator.
+static bool spans_match_iterator(array_region<double> region)
+{
+    vector<double> expected;
+    for (auto & element : region)
+        expected.push_back(element.value());
+
+    vector<double> actual;
+    for_each_span(region, [&](const array_span<double> & span)
+    {
+        const double * p = span.data;
+        for (int i = 0; i < span.size; ++i, p += span.stride)
+            actual.push_back(*p);
+    });
+
+    return actual == expected;
+}
+
+static bool test_spans_all()
+{
+    Test test;
+
+    auto a = make_array({ 4, 5, 6 });
+    auto spans = get_all(a).spans();
+
+    test.assert(spans.size() == 1) << "Span count: " << spans.size();
+    if (spans.size() == 1)
+    {
+        test.assert(spans[0].size == 4 * 5 * 6) << "Span size: " << spans[0].size;
+        test.assert(spans[0].stride == 1) << "Span stride: " << spans[0].stride;
+        test.assert(spans[0].index == 0) << "Span index: " << spans[0].index;
+    }
+
+    test.assert("Spans match iterator.", spans_match_iterator(get_all(a)));
+
+    return test.success();
+}
+
+static bool test_spans_sub_region()
+{
+    Test test;
+
+    auto a = make_array({ 4, 5, 6 });
+    auto region = get_region(a, { 1, 2, 3 }, { 2, 3, 2 });
+    auto spans = region.spans();
+
+    test.assert(spans.size() == 6) << "Span count: " << spans.size();
+    if (spans.size() == 6)
+    {
+        test.assert(spans[0].size == 2) << "Span size: " << spans[0].size;
+        test.assert(spans[0].stride == 1) << "Span stride: " << spans[0].stride;
+        test.assert(spans[0].index == flat_index({1,2,3}, a.size()))
+                << "First span index: " << spans[0].index;
+        test.assert(spans[5].location == vector<int64_t>({2,4,3}))
+                << "Last span has expected location.";
+    }
+
+    test.assert("Spans match iterator.", spans_match_iterator(region));
+
+    return test.success();
+}
+
+static bool test_spans_strided()
+{
+    Test test;
+
+    // A line along the first dimension of a 3D array,
+    // like the region of a line plot.
+
+    auto a = make_array({ 7, 5, 6 });
+    auto region = get_region(a, { 0, 2, 4 }, { 7, 1, 1 });
+    auto spans = region.spans();
+
+    test.assert(spans.size() == 1) << "Span count: " << spans.size();
+    if (spans.size() == 1)
+    {
+        test.assert(spans[0].size == 7) << "Span size: " << spans[0].size;
+        test.assert(spans[0].stride == 30) << "Span stride: " << spans[0].stride;
+    }
+
+    test.assert("Spans match iterator.", spans_match_iterator(region));
+
+    return test.success();
+}
+
+static bool test_spans_merged_rows()
+{
+    Test test;
+
+    // Full rows of a 2D slice of a 3D array are merged into one run.
+
+    auto a = make_array({ 4, 5, 6 });
+    auto region = get_region(a, { 2, 0, 0 }, { 1, 5, 6 });
+    auto spans = region.spans();
+
+    test.assert(spans.size() == 1) << "Span count: " << spans.size();
+    if (spans.size() == 1)
+    {
+        test.assert(spans[0].size == 30) << "Span size: " << spans[0].size;
+        test.assert(spans[0].index == 60) << "Span index: " << spans[0].index;
+    }
+
+    test.assert("Spans match iterator.", spans_match_iterator(region));
+
+    return test.success();
+}
+
+static bool test_spans_empty()
+{
+    Test test;
+
+    auto a = make_array({ 4, 5 });
+    auto region = get_region(a, { 0, 0 }, { 0, 5 });
+
+    test.assert("Empty region has no spans.", region.spans().empty());
+    test.assert("Invalid region has no spans.", array_region<double>().spans().empty());
+
+    return test.success();
+}
+
+static bool test_spans_transposed()
+{
+    Test test;
+
+    // A 4x3 array viewed as 3x4 by swapping strides.
+
+    auto a = make_array({ 4, 3 });
+    array_region<double> region(a.data(), { 3, 4 }, { 1, 3 }, { 0, 0 }, { 3, 4 });
+
+    vector<double> expected;
+    for (int64_t i = 0; i < 3; ++i)
+        for (int64_t j = 0; j < 4; ++j)
+            expected.push_back(a.data()[j * 3 + i]);
+
+    vector<double> actual;
+    for (auto & element : region)
+        actual.push_back(element.value());
+
+    test.assert("Iterator visits transposed elements.", actual == expected);
+    test.assert("Spans match iterator.", spans_match_iterator(region));
+
+    auto spans = region.spans();
+    test.assert(spans.size() == 3) << "Span count: " << spans.size();
+    if (spans.size() == 3)
+        test.assert(spans[0].stride == 3) << "Span stride: " << spans[0].stride;
+
+    return test.success();
+}
+
+static bool test_spans_subsampled()
+{
+    Test test;
+
+    // Every second column of a 5x6 array, in reverse order.
+
+    auto a = make_array({ 5, 6 });
+    double * last_column = a.data() + 5;
+    array_region<double> region(last_column, { 5, 3 }, { 6, -2 }, { 1, 0 }, { 3, 3 });
+
+    vector<double> expected;
+    for (int64_t i = 1; i < 4; ++i)
+        for (int64_t j = 5; j >= 0; j -= 2)
+            expected.push_back(a.data()[i * 6 + j]);
+
+    vector<double> actual;
+    for (auto & element : region)
+        actual.push_back(element.value());
+
+    test.assert("Iterator visits subsampled elements.", actual == expected);
+    test.assert("Spans match iterator.", spans_match_iterator(region));
+
+    auto extent = min_max(region);
+    test.assert(extent.min == 7 && extent.max == 23)
+            << "Min/max: " << extent.min << ", " << extent.max;
+
+    return test.success();
+}
+
+// A region of more than 2^31 elements, backed by a sparse anonymous mapping.
+// Only the pages that are written are actually allocated.
+static bool test_large_sparse()
+{
+    Test test;
+
+    vector<int64_t> size { 3, int64_t(1) << 30 };
+    int64_t count = flat_size(size);
+    size_t byte_count = count * sizeof(double);
+
+    void * memory = mmap(nullptr, byte_count, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        cerr << "Skipping: Could not map " << byte_count << " bytes." << endl;
+        return true;
+    }
+
+    double * data = (double*) memory;
+
+    test.assert("Flat size exceeds 32 bits.", count > (int64_t(1) << 31));
+
+    int64_t last_index = flat_index({ 2, size[1] - 1 }, size);
+    test.assert("Index of last element.", last_index == count - 1);
+
+    // Write a few values at the far end.
+    int64_t tail = 1000;
+    for (int64_t i = count - tail; i < count; ++i)
+        data[i] = double(i - (count - tail));
+
+    auto region = array_region<double>(data, size, { 2, size[1] - tail }, { 1, tail });
+
+    auto spans = region.spans();
+    test.assert(spans.size() == 1) << "Span count: " << spans.size();
+    if (spans.size() == 1)
+    {
+        test.assert(spans[0].index == count - tail) << "Span index: " << spans[0].index;
+        test.assert(spans[0].data == data + count - tail) << "Span data pointer.";
+    }
+
+    int64_t last_iterated = -1;
+    for (auto & element : region)
+        last_iterated = element.index();
+    test.assert(last_iterated == count - 1) << "Last iterated index: " << last_iterated;
+
+    auto extent = min_max(region);
+    test.assert(extent.min == 0 && extent.max == tail - 1)
+            << "Min/max: " << extent.min << ", " << extent.max;
+
+    auto blocks = split_region(array_region<double>(data, size, { 0, 0 }, size),
+                               int64_t(1) << 28);
+    test.assert(blocks.size() == 12) << "Block count: " << blocks.size();
+    if (blocks.size() == 12)
+    {
+        test.assert(blocks.back().offset()[0] == 2) << "Last block offset 0.";
+        test.assert(blocks.back().offset()[1] == 3 * (int64_t(1) << 28)) << "Last block offset 1.";
+    }
+
+    munmap(memory, byte_count);
+
+    return test.success();
+}
+
+Test_Set array_region_tests()
+{
+    return {
+        { "spans-all", &test_spans_all },
+        { "spans-sub-region", &test_spans_sub_region },
+        { "spans-strided", &test_spans_strided },
+        { "spans-merged-rows", &test_spans_merged_rows },
+        { "spans-empty", &test_spans_empty },
+        { "spans-transposed", &test_spans_transposed },
+        { "spans-subsampled", &test_spans_subsampled },
+        { "large-sparse", &test_large_sparse },
+    };
+}
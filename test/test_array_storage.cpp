@@ -0,0 +1,152 @@
+#include "../testing/testing.h"
+#include "../data/array.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static bool test_heap()
+{
+    Test test;
+
+    datavis::array<double> a({ 3, 4 });
+    test.assert("Heap array has data.", a.data() != nullptr);
+    test.assert("Heap array has storage.", a.storage() != nullptr);
+
+    a({ 2, 3 }) = 5;
+    test.assert("Element is stored.", a.data()[11] == 5);
+
+    return test.success();
+}
+
+static bool test_move()
+{
+    Test test;
+
+    datavis::array<double> a({ 10 });
+    double * data = a.data();
+
+    datavis::array<double> b(std::move(a));
+    test.assert("Moved array uses same data.", b.data() == data);
+    test.assert("Moved-from array has no data.", a.data() == nullptr);
+
+    datavis::array<double> c;
+    c = std::move(b);
+    test.assert("Move-assigned array uses same data.", c.data() == data);
+
+    return test.success();
+}
+
+static bool test_external()
+{
+    Test test;
+
+    int delete_count = 0;
+
+    {
+        double * buffer = new double[6];
+        for (int i = 0; i < 6; ++i)
+            buffer[i] = i;
+
+        auto a = adopt_array<double>({ 2, 3 }, buffer, [&](double * p)
+        {
+            ++delete_count;
+            delete[] p;
+        });
+
+        test.assert("Adopted array uses buffer.", a.data() == buffer);
+        test.assert("Element is read from buffer.", a({ 1, 2 }) == 5);
+
+        auto b = std::move(a);
+        test.assert("Deleter is not called on move.", delete_count == 0);
+    }
+
+    test.assert(delete_count == 1) << "Deleter call count: " << delete_count;
+
+    return test.success();
+}
+
+static bool test_too_small()
+{
+    Test test;
+
+    double buffer[4];
+
+    bool thrown = false;
+    try
+    {
+        std::unique_ptr<array_storage> storage(new external_storage(buffer, sizeof(buffer)));
+        datavis::array<double> a({ 5 }, std::move(storage));
+    }
+    catch (std::invalid_argument &)
+    {
+        thrown = true;
+    }
+
+    test.assert("Storage too small for size is rejected.", thrown);
+
+    return test.success();
+}
+
+static bool test_mapped_file()
+{
+    Test test;
+
+    char path[] = "/tmp/datavis-test-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        test.assert("Create temporary file.", false);
+        return test.success();
+    }
+
+    // Some bytes before the data, so the data is not page-aligned.
+    int64_t offset = 3 * 8;
+    vector<double> values(offset / 8 + 5000);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = i;
+
+    bool written = write(fd, values.data(), values.size() * sizeof(double))
+            == ssize_t(values.size() * sizeof(double));
+    close(fd);
+
+    test.assert("Write temporary file.", written);
+
+    if (written)
+    {
+        auto a = map_array<double>(path, offset, { 50, 100 });
+
+        test.assert("First element.", a({ 0, 0 }) == 3);
+        test.assert("Last element.", a({ 49, 99 }) == 5002);
+
+        test.assert("Mapped array is read-only.", a.is_read_only());
+
+        datavis::array<double> heap({ 10 });
+        test.assert("Heap array is not read-only.", !heap.is_read_only());
+
+        bool thrown = false;
+        try { map_array<double>(path, offset, { 6000 }); }
+        catch (std::exception &) { thrown = true; }
+        test.assert("Mapping beyond end of file is rejected.", thrown);
+    }
+
+    std::remove(path);
+
+    return test.success();
+}
+
+Test_Set array_storage_tests()
+{
+    return {
+        { "heap", &test_heap },
+        { "move", &test_move },
+        { "external", &test_external },
+        { "too-small", &test_too_small },
+        { "mapped-file", &test_mapped_file },
+    };
+}
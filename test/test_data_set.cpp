@@ -0,0 +1,299 @@
+#include "../testing/testing.h"
+#include "../data/data_set.hpp"
+#include "../utility/error.hpp"
+#include "../utility/threads.hpp"
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+// A 2-attribute data set of size 4x6, with value a * 100 + i * 6 + j.
+static DataSetPtr make_data_set()
+{
+    auto data_set = make_shared<DataSet>("data", vector<int64_t>{ 4, 6 }, 2);
+    for (int a = 0; a < 2; ++a)
+    {
+        auto & data = data_set->data(a);
+        for (int64_t i = 0; i < 24; ++i)
+            data.data()[i] = a * 100 + i;
+    }
+
+    data_set->setDimension(0, { "y", 4, { 2, 10 } });
+    data_set->setDimension(1, { "x", 6, { 1, 0 } });
+    data_set->attribute(1).name = "b";
+
+    return data_set;
+}
+
+static bool test_view_transposed()
+{
+    Test test;
+
+    auto data_set = make_data_set();
+
+    auto view = data_set->view("view", { { 1, 0, 1, 6 }, { 0, 0, 1, 4 } });
+
+    test.assert("View size.", view->size() == vector<int64_t>({ 6, 4 }));
+    test.assert("View dimension name.", view->dimension(0).name == "x");
+    test.assert("View attribute name.", view->attribute(1).name == "b");
+
+    for (int64_t i = 0; i < 6; ++i)
+    {
+        for (int64_t j = 0; j < 4; ++j)
+        {
+            double expected = 100 + j * 6 + i;
+            double actual = view->value(1, { i, j });
+            if (actual != expected)
+            {
+                test.assert(false) << "Value at " << i << "," << j << ": " << actual;
+                return test.success();
+            }
+        }
+    }
+
+    auto stats = view->statistics(0);
+    test.assert(stats.extent.min == 0 && stats.extent.max == 23)
+            << "Min/max: " << stats.extent.min << ", " << stats.extent.max;
+
+    return test.success();
+}
+
+static bool test_view_shares_data()
+{
+    Test test;
+
+    auto data_set = make_data_set();
+
+    // Every second column in reverse, of rows 1 to 2.
+    auto view = data_set->view("view", { { 0, 1, 1, 2 }, { 1, 5, -2, 3 } });
+
+    test.assert("View size.", view->size() == vector<int64_t>({ 2, 3 }));
+    test.assert(view->value(0, { 0, 0 }) == 11) << "First value: " << view->value(0, { 0, 0 });
+    test.assert(view->value(0, { 1, 2 }) == 13) << "Last value: " << view->value(0, { 1, 2 });
+
+    auto map = view->dimension(1).map;
+    test.assert(map.scale == -2 && map.offset == 5)
+            << "Dimension map: " << map.scale << ", " << map.offset;
+
+    data_set->data(0).data()[11] = -1;
+    test.assert("View sees changes to parent.", view->value(0, { 0, 0 }) == -1);
+
+    // A view of a view
+    auto sub_view = view->view("sub-view", { { 1, 1, 1, 2 }, { 0, 1, 1, 1 } });
+    test.assert(sub_view->value(0, { 1, 0 }) == 13) << "Sub-view value: " << sub_view->value(0, { 1, 0 });
+
+    // Views keep the parent data alive.
+    data_set.reset();
+    view.reset();
+    test.assert(sub_view->value(0, { 0, 0 }) == 15) << "Value after releasing parent: " << sub_view->value(0, { 0, 0 });
+
+    return test.success();
+}
+
+static bool test_view_invalid()
+{
+    Test test;
+
+    auto data_set = make_data_set();
+
+    auto throws = [&](const vector<DataSet::ViewDimension> & dims)
+    {
+        try { data_set->view("view", dims); }
+        catch (std::invalid_argument &) { return true; }
+        return false;
+    };
+
+    test.assert("Missing dimension.", throws({ { 0, 0, 1, 4 } }));
+    test.assert("Repeated dimension.", throws({ { 0, 0, 1, 4 }, { 0, 0, 1, 4 } }));
+    test.assert("Exceeds data.", throws({ { 0, 0, 2, 3 }, { 1, 0, 1, 6 } }));
+    test.assert("Empty.", throws({ { 0, 0, 1, 0 }, { 1, 0, 1, 6 } }));
+
+    return test.success();
+}
+
+static bool test_computed()
+{
+    Test test;
+
+    auto data_set = make_data_set();
+
+    // Attribute 1 is named "b", dimension 1 is named "x".
+    auto computed = data_set->computed("computed", "b - a0 + 1000 * x + d0");
+
+    test.assert("Computed data is tiled.", computed->isTiled());
+    test.assert("Computed size.", computed->size() == data_set->size());
+    test.assert("Computed attribute name.", computed->attribute(0).name == "b - a0 + 1000 * x + d0");
+
+    auto data = computed->readRegion(0, { 1, 2 }, { 3, 4 });
+
+    for (int64_t i = 0; i < 3; ++i)
+    {
+        for (int64_t j = 0; j < 4; ++j)
+        {
+            double y = 2 * (i + 1) + 10;
+            double x = j + 2;
+            double expected = 100 + 1000 * x + y;
+            double actual = data.data()[i * 4 + j];
+            if (actual != expected)
+            {
+                test.assert(false) << "Value at " << i << "," << j << ": " << actual;
+                return test.success();
+            }
+        }
+    }
+
+    auto stats = computed->statistics(0);
+    test.assert(stats.extent.min == 100 + 10 && stats.extent.max == 100 + 5000 + 16)
+            << "Min/max: " << stats.extent.min << ", " << stats.extent.max;
+
+    try
+    {
+        data_set->computed("invalid", "a0 + c");
+        test.assert(false) << "Invalid expression accepted.";
+    }
+    catch (Error &) {}
+
+    return test.success();
+}
+
+// Statistics of data larger than a block are computed per block.
+static bool test_statistics_blocks()
+{
+    Test test;
+
+    int64_t count = 3 * (1 << 20) + 5;
+
+    auto data_set = make_shared<DataSet>("data", vector<int64_t>{ count }, 1);
+    auto data = data_set->data(0).data();
+    for (int64_t i = 0; i < count; ++i)
+        data[i] = i % 4;
+
+    auto stats = data_set->statistics(0, {}, {}, 4);
+
+    test.assert(stats.extent.min == 0 && stats.extent.max == 3)
+            << "Min/max: " << stats.extent.min << ", " << stats.extent.max;
+    test.assert(stats.count() == count) << "Count: " << stats.count();
+    test.assert(stats.histogram.size() == 4) << "Histogram bins: " << stats.histogram.size();
+
+    int64_t histogram_total = 0;
+    for (auto bin : stats.histogram)
+        histogram_total += bin;
+    test.assert(histogram_total == count) << "Histogram total: " << histogram_total;
+
+    if (stats.histogram.size() == 4)
+    {
+        test.assert(stats.histogram[0] == count / 4 + 1 && stats.histogram[3] == count / 4)
+                << "Histogram: " << stats.histogram[0] << " ... " << stats.histogram[3];
+    }
+
+    return test.success();
+}
+
+// Concurrent requests for the same statistics from pool tasks,
+// while the first one computes them using the same pool.
+static bool test_statistics_concurrent()
+{
+    Test test;
+
+    int64_t count = 3 * (1 << 20) + 5;
+
+    auto data_set = make_shared<DataSet>("data", vector<int64_t>{ count }, 1);
+    auto data = data_set->data(0).data();
+    for (int64_t i = 0; i < count; ++i)
+        data[i] = i % 7;
+
+    int request_count = 2 * compute_pool().thread_count() + 2;
+    atomic<int> done_count { 0 };
+    atomic<int> correct_count { 0 };
+
+    for (int r = 0; r < request_count; ++r)
+    {
+        compute_pool().submit([=, &done_count, &correct_count]
+        {
+            auto stats = data_set->statistics(0, {}, {}, 7);
+            if (stats.extent.min == 0 && stats.extent.max == 6 && stats.count() == count)
+                ++correct_count;
+            ++done_count;
+        });
+    }
+
+    for (int i = 0; i < 2000 && done_count < request_count; ++i)
+        this_thread::sleep_for(chrono::milliseconds(5));
+
+    test.assert(done_count == request_count) << "Done: " << done_count << " of " << request_count;
+    test.assert(correct_count == done_count) << "Correct: " << correct_count << " of " << done_count;
+
+    return test.success();
+}
+
+// Reads tiles of ones, failing the first time.
+class failing_tile_source : public tile_source<double>
+{
+public:
+    void read(const vector<int64_t> &, const vector<int64_t> & size, double * buffer) override
+    {
+        if (read_count++ == 0)
+            throw std::runtime_error("Read failed.");
+        std::fill(buffer, buffer + flat_size(size), 1.0);
+    }
+
+    atomic<int> read_count { 0 };
+};
+
+// Statistics computed in the background are computed again
+// when requested after a failure.
+static bool test_statistics_retry()
+{
+    Test test;
+
+    auto source = make_shared<failing_tile_source>();
+    vector<shared_ptr<tiled_array<double>>> data;
+    data.push_back(make_shared<tiled_array<double>>(vector<int64_t>{ 100 }, vector<int64_t>{ 100 }, source));
+    auto data_set = make_shared<DataSet>("data", std::move(data));
+
+    auto failed = data_set->statisticsValue(0);
+
+    auto retried = failed;
+    for (int i = 0; i < 1000 && retried == failed; ++i)
+    {
+        this_thread::sleep_for(chrono::milliseconds(5));
+        retried = data_set->statisticsValue(0);
+    }
+
+    test.assert("Failed statistics requested again.", retried != failed);
+
+    for (int i = 0; i < 1000 && !retried->ready; ++i)
+        this_thread::sleep_for(chrono::milliseconds(5));
+
+    test.assert("Statistics computed again.", retried->ready);
+    test.assert("Failed statistics not ready.", !failed->ready);
+
+    if (retried->ready)
+    {
+        auto & extent = retried->value.extent;
+        test.assert(extent.min == 1 && extent.max == 1)
+                << "Min/max: " << extent.min << ", " << extent.max;
+    }
+
+    return test.success();
+}
+
+Test_Set data_set_tests()
+{
+    return {
+        { "view-transposed", &test_view_transposed },
+        { "view-shares-data", &test_view_shares_data },
+        { "view-invalid", &test_view_invalid },
+        { "computed", &test_computed },
+        { "statistics-blocks", &test_statistics_blocks },
+        { "statistics-concurrent", &test_statistics_concurrent },
+        { "statistics-retry", &test_statistics_retry },
+    };
+}
@@ -0,0 +1,194 @@
+#include "../testing/testing.h"
+#include "../data/dataset_cache.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+namespace {
+
+// Only used to identify data sets in the cache.
+class Test_Source : public DataSource
+{
+public:
+    Test_Source(): DataSource(nullptr) {}
+    string path() const override { return "test"; }
+    string id() const override { return "test"; }
+    int count() const override { return 0; }
+    vector<string> dataset_ids() const override { return {}; }
+    DataSetInfo dataset_info(const string &) const override { return DataSetInfo(); }
+    FutureDataset dataset(const string &) override { return nullptr; }
+};
+
+}
+
+// A loaded data set with one attribute of count values.
+static FutureDataset loaded(int64_t count)
+{
+    return Reactive::value(make_shared<DataSet>("data", vector<int64_t>{ count }, 1));
+}
+
+// Size of a data set of 1000 values.
+static const size_t unit_size = 1000 * sizeof(double);
+
+static bool test_memory_size()
+{
+    Test test;
+
+    auto dataset = make_shared<DataSet>("data", vector<int64_t>{ 10, 20 }, 3);
+    test.assert(dataset->memorySize() == 10 * 20 * 3 * sizeof(double))
+            << "Size: " << dataset->memorySize();
+
+    auto view = dataset->view("view", { { 1, 0, 1, 20 }, { 0, 0, 1, 10 } });
+    test.assert("View owns no data.", view->memorySize() == 0);
+
+    return test.success();
+}
+
+static bool test_eviction()
+{
+    Test test;
+
+    Test_Source source;
+    dataset_cache cache(2 * unit_size + unit_size / 2);
+
+    cache.insert(&source, "a", loaded(1000));
+    cache.insert(&source, "b", loaded(1000));
+
+    test.assert(cache.used() == 2 * unit_size) << "Used: " << cache.used();
+
+    // Makes "a" more recently used than "b".
+    test.assert("Found a.", cache.find(&source, "a") != nullptr);
+
+    cache.insert(&source, "c", loaded(1000));
+
+    test.assert("Least recently used was dropped.", !cache.contains(&source, "b"));
+    test.assert("Recently used was kept.", cache.contains(&source, "a"));
+    test.assert("New was kept.", cache.contains(&source, "c"));
+    test.assert(cache.used() == 2 * unit_size) << "Used: " << cache.used();
+
+    cache.set_budget(0);
+    test.assert(cache.count() == 0) << "Count: " << cache.count();
+    test.assert(cache.used() == 0) << "Used: " << cache.used();
+
+    return test.success();
+}
+
+static bool test_in_use()
+{
+    Test test;
+
+    Test_Source source;
+    dataset_cache cache(unit_size);
+
+    // A plot may keep the future, or only the data set.
+
+    auto future = loaded(1000);
+    cache.insert(&source, "future", future);
+
+    DataSetPtr dataset;
+    {
+        auto f = loaded(1000);
+        dataset = f->value;
+        cache.insert(&source, "data", f);
+    }
+
+    DataSetPtr view_parent;
+    {
+        auto f = loaded(1000);
+        auto view = f->value->view("view", { { 0, 0, 1, 1000 } });
+        cache.insert(&source, "view", f);
+        view_parent = view;
+    }
+
+    cache.insert(&source, "unused", loaded(1000));
+    cache.trim();
+
+    test.assert("Unused was dropped.", !cache.contains(&source, "unused"));
+    test.assert("Kept while future is used.", cache.contains(&source, "future"));
+    test.assert("Kept while data set is used.", cache.contains(&source, "data"));
+    test.assert("Kept while view is used.", cache.contains(&source, "view"));
+    test.assert(cache.used() == 3 * unit_size) << "Used: " << cache.used();
+
+    // Released data sets are dropped on next use of the cache.
+
+    future = nullptr;
+    dataset = nullptr;
+    view_parent = nullptr;
+
+    cache.trim();
+
+    test.assert(cache.used() <= unit_size) << "Used: " << cache.used();
+    test.assert(cache.count() == 1) << "Count: " << cache.count();
+
+    return test.success();
+}
+
+static bool test_loading()
+{
+    Test test;
+
+    Test_Source source;
+    dataset_cache cache(0);
+
+    auto loading = make_shared<Reactive::Value_Data<DataSetPtr>>();
+    cache.insert(&source, "loading", loading);
+    loading = nullptr;
+
+    cache.trim();
+
+    test.assert("Loading data set is kept.", cache.contains(&source, "loading"));
+    test.assert(cache.used() == 0) << "Used: " << cache.used();
+
+    auto found = cache.find(&source, "loading");
+    test.assert("Found loading data set.", found != nullptr);
+    if (!found)
+        return test.success();
+
+    found->set(make_shared<DataSet>("data", vector<int64_t>{ 1000 }, 1));
+    found = nullptr;
+
+    cache.trim();
+
+    test.assert("Loaded data set is dropped when over budget.",
+                !cache.contains(&source, "loading"));
+
+    return test.success();
+}
+
+static bool test_remove_source()
+{
+    Test test;
+
+    Test_Source source1;
+    Test_Source source2;
+    dataset_cache cache(10 * unit_size);
+
+    cache.insert(&source1, "data", loaded(1000));
+    cache.insert(&source2, "data", loaded(1000));
+
+    test.assert(cache.find(&source1, "data") != cache.find(&source2, "data"))
+            << "Sources have separate data sets.";
+
+    cache.remove(&source1);
+
+    test.assert("Removed source's data set.", !cache.contains(&source1, "data"));
+    test.assert("Kept other source's data set.", cache.contains(&source2, "data"));
+    test.assert(cache.used() == unit_size) << "Used: " << cache.used();
+
+    return test.success();
+}
+
+Test_Set dataset_cache_tests()
+{
+    return {
+        { "memory-size", &test_memory_size },
+        { "eviction", &test_eviction },
+        { "in-use", &test_in_use },
+        { "loading", &test_loading },
+        { "remove-source", &test_remove_source },
+    };
+}
@@ -0,0 +1,137 @@
+#include "../testing/testing.h"
+#include "../data/expression.hpp"
+#include "../utility/error.hpp"
+
+#include <vector>
+#include <cmath>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static const expression::variable_map variables = { { "a", 0 }, { "b", 1 }, { "x", 2 } };
+
+static double eval(const string & text, double a = 0, double b = 0, double x = 0)
+{
+    expression e(text, variables);
+    return e.evaluate(vector<double>{ a, b, x });
+}
+
+static bool is_error(const string & text)
+{
+    try { expression(text, variables); }
+    catch (Error &) { return true; }
+    return false;
+}
+
+static bool test_precedence()
+{
+    Test test;
+
+    test.assert(eval("1 + 2 * 3") == 7) << eval("1 + 2 * 3");
+    test.assert(eval("(1 + 2) * 3") == 9) << eval("(1 + 2) * 3");
+    test.assert(eval("8 / 4 / 2") == 1) << eval("8 / 4 / 2");
+    test.assert(eval("10 - 4 - 3") == 3) << eval("10 - 4 - 3");
+    test.assert(eval("2 ^ 3 ^ 2") == 512) << eval("2 ^ 3 ^ 2");
+    test.assert(eval("-2 ^ 2") == -4) << eval("-2 ^ 2");
+    test.assert(eval("2 ^ -1") == 0.5) << eval("2 ^ -1");
+    test.assert(eval("1.5e2 + .5") == 150.5) << eval("1.5e2 + .5");
+
+    return test.success();
+}
+
+static bool test_variables_and_functions()
+{
+    Test test;
+
+    test.assert(eval("a * b + x", 2, 3, 4) == 10) << eval("a * b + x", 2, 3, 4);
+    test.assert(eval("20*log10(abs(a))", -100) == 40) << eval("20*log10(abs(a))", -100);
+    test.assert(eval("sqrt(a^2 + b^2)", 3, 4) == 5) << eval("sqrt(a^2 + b^2)", 3, 4);
+    test.assert(eval("max(a, b) - min(a, b)", 7, 2) == 5) << eval("max(a, b) - min(a, b)", 7, 2);
+    test.assert(eval("atan2(a, b)", 1, 1) == atan2(1.0, 1.0)) << eval("atan2(a, b)", 1, 1);
+    test.assert(eval("pow(a, 0.5)", 16) == 4) << eval("pow(a, 0.5)", 16);
+
+    expression e("a - x", variables);
+    test.assert("Uses a.", e.uses(0));
+    test.assert("Does not use b.", !e.uses(1));
+    test.assert("Uses x.", e.uses(2));
+
+    return test.success();
+}
+
+static bool test_constant_folding()
+{
+    Test test;
+
+    expression e("a * (2 + 3) - -sqrt(16)", variables);
+
+    int constant_count = 0;
+    for (auto & instr : e.code())
+        constant_count += instr.op == expression::op_constant;
+
+    test.assert(e.code().size() == 5) << "Instruction count: " << e.code().size();
+    test.assert(constant_count == 2) << "Constant count: " << constant_count;
+    test.assert(e.evaluate({ 3, 0, 0 }) == 19) << e.evaluate({ 3, 0, 0 });
+
+    return test.success();
+}
+
+static bool test_errors()
+{
+    Test test;
+
+    test.assert("Empty.", is_error(""));
+    test.assert("Unknown variable.", is_error("a + c"));
+    test.assert("Unknown function.", is_error("foo(a)"));
+    test.assert("Wrong argument count.", is_error("max(a)"));
+    test.assert("Missing parenthesis.", is_error("(a + b"));
+    test.assert("Trailing input.", is_error("a b"));
+    test.assert("Missing operand.", is_error("a *"));
+
+    return test.success();
+}
+
+static bool test_blocks()
+{
+    Test test;
+
+    // More elements than processed by an instruction at once,
+    // and a count that is not a multiple of it.
+
+    int64_t count = 1000;
+    vector<double> a(count), b(count);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        a[i] = i;
+        b[i] = count - i;
+    }
+
+    expression e("a * a - 2 * b + 1", variables);
+
+    vector<double> result(count);
+    e.evaluate({ a.data(), b.data(), nullptr }, count, result.data());
+
+    bool ok = true;
+    for (int64_t i = 0; i < count && ok; ++i)
+    {
+        double expected = a[i] * a[i] - 2 * b[i] + 1;
+        if (result[i] != expected)
+        {
+            test.assert(false) << "Element " << i << ": " << result[i] << " != " << expected;
+            ok = false;
+        }
+    }
+
+    return test.success();
+}
+
+Test_Set expression_tests()
+{
+    return {
+        { "precedence", &test_precedence },
+        { "variables-and-functions", &test_variables_and_functions },
+        { "constant-folding", &test_constant_folding },
+        { "errors", &test_errors },
+        { "blocks", &test_blocks },
+    };
+}
@@ -19,7 +19,7 @@ int main(int argc, char *argv[])
 
     int elem_count = 200;
 
-    auto a = make_shared<DataSet>(vector<int>({elem_count, elem_count}));
+    auto a = make_shared<DataSet>(vector<int64_t>({elem_count, elem_count}));
 
     {
         //cout << "Generating data:" << endl;
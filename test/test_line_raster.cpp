@@ -0,0 +1,384 @@
+#include "../testing/testing.h"
+#include "../plot/line_raster.hpp"
+#include "../data/m4.hpp"
+
+#include <QImage>
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static QImage blank_image(int width, int height)
+{
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+static uint32_t pixel_at(const QImage & image, int x, int y)
+{
+    return reinterpret_cast<const uint32_t*>(image.constScanLine(y))[x];
+}
+
+// Compares images pixel by pixel, reporting the first difference.
+static bool same_pixels(Test & test, const QImage & actual, const QImage & expected)
+{
+    for (int y = 0; y < expected.height(); ++y)
+    {
+        for (int x = 0; x < expected.width(); ++x)
+        {
+            if (pixel_at(actual, x, y) != pixel_at(expected, x, y))
+            {
+                test.assert(false) << "Pixel " << x << ", " << y << " differs.";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+struct Pixel
+{
+    int x, y;
+};
+
+// Checks that exactly the given pixels have the color,
+// and all others are transparent.
+static bool has_pixels(Test & test, const QImage & image, const QColor & color,
+                       const vector<Pixel> & pixels)
+{
+    QImage expected = blank_image(image.width(), image.height());
+    for (const auto & p : pixels)
+        reinterpret_cast<uint32_t*>(expected.scanLine(p.y))[p.x] = qPremultiply(color.rgba());
+
+    return same_pixels(test, image, expected);
+}
+
+// Segments of a line through random points, ordered by column
+// as required by drawLineLayers(), extending past the image.
+static vector<LineSegment> random_segments(int count, int width, int height, unsigned seed)
+{
+    mt19937 random(seed);
+    uniform_int_distribution<int> row(-5, height + 5);
+    uniform_int_distribution<int> advance(0, 99);
+
+    vector<LineSegment> segments;
+    int x = -10;
+    int y = row(random);
+    while (int(segments.size()) < count)
+    {
+        // Mostly vertical, sometimes sloped across several columns.
+        int a = advance(random);
+        int next_x = std::min(a < 96 ? x : x + a - 95, width + 10);
+        int next_y = row(random);
+        segments.push_back({ x, y, next_x, next_y });
+        x = next_x;
+        y = next_y;
+    }
+    return segments;
+}
+
+// A random walk of integer values, with flat stretches.
+static vector<double> stepped_walk(int64_t count, unsigned seed)
+{
+    mt19937 random(seed);
+    uniform_int_distribution<int> step(-3, 3);
+    uniform_int_distribution<int> flat_chance(0, 99);
+
+    vector<double> values(count);
+    double v = 30;
+    int flat = 0;
+    for (auto & value : values)
+    {
+        if (flat > 0)
+            --flat;
+        else if (flat_chance(random) == 0)
+            flat = 40;
+        else
+            v += step(random);
+        value = v;
+    }
+    return values;
+}
+
+static bool test_m4()
+{
+    Test test;
+
+    int width = 200;
+    int height = 60;
+
+    int64_t size = 5000;
+    auto values = stepped_walk(size, 3);
+
+    QColor color(10, 20, 30);
+
+    // Row of a value, limited like in SelectedLines::plot().
+    auto y_of = [&](double value)
+    {
+        double y = 2.5 * (value - 30) + 0.5 * height;
+        y = std::max(-1.0, std::min(double(height), y));
+        return int(std::lround(y));
+    };
+
+    auto value_at = [&](int64_t i) { return values[i]; };
+
+    auto extent = [&](int64_t start, int64_t end)
+    {
+        value_extent r;
+        for (int64_t i = start; i < end; ++i)
+        {
+            if (values[i] < r.min) r.min = values[i];
+            if (values[i] > r.max) r.max = values[i];
+        }
+        return r;
+    };
+
+    // From many values per column to many columns per value.
+    for (double scale : { 0.01, 0.1, 0.5, 1.0, 3.3 })
+    {
+        double offset = -0.2 * scale * size;
+
+        auto bounds = m4_column_bounds(offset, scale, 0, width, size);
+        auto columns = m4_aggregate(bounds, value_at, extent);
+
+        vector<LineLayer> layers(1);
+        layers[0].color = color;
+        appendM4Segments(layers[0].segments, columns, y_of);
+
+        QImage image = blank_image(width, height);
+        drawLineLayers(image, layers);
+
+        // Lines between all consecutive values within the columns.
+        QImage expected = blank_image(width, height);
+        LineRaster raster(expected, color);
+        for (int64_t i = 0; i + 1 < size; ++i)
+        {
+            int x0 = int(std::floor(offset + scale * i));
+            int x1 = int(std::floor(offset + scale * (i + 1)));
+            if (x0 < 0 || x1 >= width)
+                continue;
+            raster.drawLine(x0, y_of(values[i]), x1, y_of(values[i + 1]));
+        }
+
+        if (!same_pixels(test, image, expected))
+        {
+            test.assert(false) << "M4 lines differ at scale " << scale;
+            break;
+        }
+    }
+
+    return test.success();
+}
+
+static bool test_vertical()
+{
+    Test test;
+
+    QColor color(200, 100, 50);
+    QImage image = blank_image(8, 10);
+    LineRaster raster(image, color);
+
+    // Ends in any order, as vertical lines, and clipped at the top and bottom.
+    raster.drawVertical(2, 7, 3);
+    raster.drawLine(5, -4, 5, 20);
+    raster.drawLine(7, 9, 7, 9);
+
+    // Outside the image.
+    raster.drawVertical(-1, 0, 9);
+    raster.drawVertical(8, 0, 9);
+    raster.drawVertical(3, 10, 12);
+    raster.drawVertical(4, -3, -1);
+
+    vector<Pixel> pixels;
+    for (int y = 3; y <= 7; ++y)
+        pixels.push_back({ 2, y });
+    for (int y = 0; y < 10; ++y)
+        pixels.push_back({ 5, y });
+    pixels.push_back({ 7, 9 });
+
+    test.assert("Vertical lines.", has_pixels(test, image, color, pixels));
+
+    return test.success();
+}
+
+static bool test_sloped()
+{
+    Test test;
+
+    QColor color(0, 0, 255);
+
+    // One pixel per column.
+    {
+        QImage image = blank_image(5, 3);
+        LineRaster raster(image, color);
+        raster.drawLine(0, 0, 4, 2);
+
+        test.assert("Shallow line.", has_pixels(test, image, color,
+            { {0,0}, {1,1}, {2,1}, {3,2}, {4,2} }));
+    }
+
+    // Rows within half a pixel of each column center.
+    {
+        QImage image = blank_image(3, 7);
+        LineRaster raster(image, color);
+        raster.drawLine(0, 0, 2, 6);
+
+        test.assert("Steep line.", has_pixels(test, image, color,
+            { {0,0}, {0,1}, {0,2}, {1,2}, {1,3}, {1,4}, {1,5}, {2,5}, {2,6} }));
+    }
+
+    // The same pixels from right to left.
+    {
+        QImage image = blank_image(3, 7);
+        LineRaster raster(image, color);
+        raster.drawLine(2, 0, 0, 6);
+
+        test.assert("Steep line from the right.", has_pixels(test, image, color,
+            { {2,0}, {2,1}, {2,2}, {1,2}, {1,3}, {1,4}, {1,5}, {0,5}, {0,6} }));
+    }
+
+    return test.success();
+}
+
+static bool test_clipping()
+{
+    Test test;
+
+    QColor color(0, 128, 0);
+
+    // Lines through the image from outside it.
+    {
+        QImage image = blank_image(6, 5);
+        LineRaster raster(image, color);
+        raster.drawLine(-10, 2, 20, 2);
+        raster.drawLine(-2, -2, 8, 8);
+
+        test.assert("Lines across the image.", has_pixels(test, image, color,
+            { {0,2}, {1,2}, {2,2}, {3,2}, {4,2}, {5,2},
+              {0,0}, {1,1}, {3,3}, {4,4} }));
+    }
+
+    // A steep line leaving through the bottom.
+    {
+        QImage image = blank_image(6, 5);
+        LineRaster raster(image, color);
+        raster.drawLine(3, 3, 4, 13);
+
+        test.assert("Line leaving the bottom.", has_pixels(test, image, color,
+            { {3,3}, {3,4} }));
+    }
+
+    // Lines outside the image, and clip columns beyond its edges.
+    {
+        QImage image = blank_image(6, 5);
+        LineRaster raster(image, color);
+        raster.setClipColumns(-5, 100);
+        raster.drawLine(10, 0, 12, 4);
+        raster.drawLine(-8, 0, -1, 4);
+        raster.drawLine(0, -5, 5, -1);
+        raster.drawLine(0, 6, 5, 9);
+
+        test.assert("Lines outside the image.", has_pixels(test, image, color, {}));
+    }
+
+    // Clip columns within the image.
+    {
+        QImage image = blank_image(6, 5);
+        LineRaster raster(image, color);
+        raster.setClipColumns(2, 4);
+        raster.drawLine(0, 1, 5, 1);
+        raster.drawVertical(1, 0, 4);
+        raster.drawVertical(4, 0, 4);
+
+        test.assert("Clipped to columns.", has_pixels(test, image, color,
+            { {2,1}, {3,1} }));
+    }
+
+    return test.success();
+}
+
+static bool test_bands()
+{
+    Test test;
+
+    int width = 300;
+    int height = 40;
+
+    // Overlapping layers, with enough segments to be drawn in bands
+    // when there are several threads.
+    vector<LineLayer> layers(2);
+    layers[0].color = QColor(255, 0, 0);
+    layers[0].segments = random_segments(3000, width, height, 1);
+    layers[1].color = QColor(0, 0, 255);
+    layers[1].segments = random_segments(3000, width, height, 2);
+
+    // All segments drawn in order, without bands.
+    QImage expected = blank_image(width, height);
+    for (const auto & layer : layers)
+    {
+        LineRaster raster(expected, layer.color);
+        for (const auto & s : layer.segments)
+            raster.drawLine(s.x0, s.y0, s.x1, s.y1);
+    }
+
+    {
+        QImage image = blank_image(width, height);
+        drawLineLayers(image, layers);
+        test.assert("Many segments.", same_pixels(test, image, expected));
+    }
+
+    // Few segments are drawn in a single band.
+    {
+        vector<LineLayer> few = layers;
+        for (auto & layer : few)
+            layer.segments.resize(500);
+
+        QImage single = blank_image(width, height);
+        for (const auto & layer : few)
+        {
+            LineRaster raster(single, layer.color);
+            for (const auto & s : layer.segments)
+                raster.drawLine(s.x0, s.y0, s.x1, s.y1);
+        }
+
+        QImage image = blank_image(width, height);
+        drawLineLayers(image, few);
+        test.assert("Single band.", same_pixels(test, image, single));
+    }
+
+    // Bands of any width, regardless of the number of threads,
+    // with sloped segments crossing their boundaries.
+    for (int band_width : { 1, 7, 64, 299 })
+    {
+        QImage image = blank_image(width, height);
+        for (int begin = 0; begin < width; begin += band_width)
+            drawLineLayersBand(image, layers, begin, begin + band_width);
+
+        if (!same_pixels(test, image, expected))
+        {
+            test.assert(false) << "Bands of width " << band_width << " differ.";
+            break;
+        }
+    }
+
+    return test.success();
+}
+
+Test_Set line_raster_tests()
+{
+    return {
+        { "vertical", &test_vertical },
+        { "sloped", &test_sloped },
+        { "clipping", &test_clipping },
+        { "bands", &test_bands },
+        { "m4", &test_m4 },
+    };
+}
@@ -0,0 +1,358 @@
+#include "../testing/testing.h"
+#include "../data/m4.hpp"
+#include "../data/minmax_pyramid.hpp"
+
+#include <vector>
+#include <random>
+#include <cmath>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static vector<double> random_walk(int64_t count, unsigned seed)
+{
+    mt19937 random(seed);
+    normal_distribution<double> step(0, 1);
+    uniform_int_distribution<int> nan_chance(0, 999);
+
+    vector<double> values(count);
+    double v = 0;
+    for (auto & value : values)
+    {
+        v += step(random);
+        value = nan_chance(random) == 0 ? NAN : v;
+    }
+    return values;
+}
+
+// Aggregates columns by visiting every value.
+static vector<m4_column> brute_force(const vector<double> & values,
+                                     double offset, double scale, int x, int count)
+{
+    vector<m4_column> columns(count);
+
+    for (int64_t i = 0; i < int64_t(values.size()); ++i)
+    {
+        int c = int(std::floor(offset + scale * i)) - x;
+        if (c < 0 || c >= count)
+            continue;
+
+        auto & column = columns[c];
+        if (column.count == 0)
+            column.first = values[i];
+        column.last = values[i];
+        ++column.count;
+
+        if (values[i] < column.extent.min) column.extent.min = values[i];
+        if (values[i] > column.extent.max) column.extent.max = values[i];
+    }
+
+    return columns;
+}
+
+static bool same_value(double a, double b)
+{
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+static bool same(const m4_column & a, const m4_column & b)
+{
+    if (a.count != b.count)
+        return false;
+    if (a.count == 0)
+        return true;
+    if (a.extent.is_empty() != b.extent.is_empty())
+        return false;
+    if (!a.extent.is_empty() && (a.extent.min != b.extent.min || a.extent.max != b.extent.max))
+        return false;
+    return same_value(a.first, b.first) && same_value(a.last, b.last);
+}
+
+static bool test_column_bounds()
+{
+    Test test;
+
+    int64_t size = 1000;
+
+    struct Mapping { double offset; double scale; int x; int count; };
+
+    vector<Mapping> mappings = {
+        { 0, 1, 0, 1000 },
+        { 0.5, 0.1, 0, 100 },
+        { -20.3, 0.37, 10, 200 },
+        { 3.7, 7.25, 0, 2000 },
+        { 100, 1.0 / 3, 50, 300 },
+    };
+
+    for (auto & m : mappings)
+    {
+        auto bounds = m4_column_bounds(m.offset, m.scale, m.x, m.count, size);
+
+        test.assert(int(bounds.size()) == m.count + 1) << "Bounds: " << bounds.size();
+
+        for (int c = 0; c < m.count; ++c)
+        {
+            for (int64_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                int column = int(std::floor(m.offset + m.scale * i));
+                if (column != m.x + c)
+                {
+                    test.assert(false) << "Index " << i << " in column " << m.x + c
+                                       << " instead of " << column;
+                    return test.success();
+                }
+            }
+        }
+
+        // Values outside the columns are excluded.
+        if (bounds.front() > 0)
+        {
+            int column = int(std::floor(m.offset + m.scale * (bounds.front() - 1)));
+            test.assert(column < m.x) << "Value before columns in column " << column;
+        }
+        if (bounds.back() < size)
+        {
+            int column = int(std::floor(m.offset + m.scale * bounds.back()));
+            test.assert(column >= m.x + m.count) << "Value after columns in column " << column;
+        }
+    }
+
+    return test.success();
+}
+
+static bool test_aggregate()
+{
+    Test test;
+
+    int64_t size = 200000;
+    auto values = random_walk(size, 5);
+
+    minmax_pyramid pyramid(size, 16, 4);
+    array_span<double> span;
+    span.data = values.data();
+    span.size = size;
+    span.stride = 1;
+    pyramid.append(span);
+
+    // From many values per column to many columns per value.
+    for (double scale : { 1e-4, 3e-3, 0.0173, 0.5, 1.0, 2.5, 40.0 })
+    {
+        int count = 800;
+        double offset = -0.37 * scale * size / 3;
+        int x = 0;
+
+        int64_t value_reads = 0;
+        int64_t edge_values = 0;
+
+        auto value_at = [&](int64_t i)
+        {
+            ++value_reads;
+            return values[i];
+        };
+
+        auto edge_extent = [&](int64_t start, int64_t end)
+        {
+            edge_values += end - start;
+            value_extent r;
+            for (int64_t i = start; i < end; ++i)
+            {
+                if (values[i] < r.min) r.min = values[i];
+                if (values[i] > r.max) r.max = values[i];
+            }
+            return r;
+        };
+
+        auto extent = [&](int64_t start, int64_t end)
+        {
+            return pyramid.extent(start, end, edge_extent);
+        };
+
+        auto bounds = m4_column_bounds(offset, scale, x, count, size);
+        auto columns = m4_aggregate(bounds, value_at, extent);
+        auto expected = brute_force(values, offset, scale, x, count);
+
+        for (int c = 0; c < count; ++c)
+        {
+            if (!same(columns[c], expected[c]))
+            {
+                test.assert(false) << "Column " << c << " differs at scale " << scale;
+                break;
+            }
+        }
+
+        // Cost depends on the number of columns, not values.
+        test.assert(value_reads <= 2 * count) << "Value reads: " << value_reads;
+        test.assert(edge_values <= 2 * count * pyramid.block_size(0))
+                << "Edge values: " << edge_values << " at scale " << scale;
+    }
+
+    return test.success();
+}
+
+static bool test_aggregate_partial()
+{
+    Test test;
+
+    int64_t size = 200000;
+    auto values = random_walk(size, 7);
+
+    // The pyramid has reduced less than half of the line.
+    int64_t added = size / 2 - 123;
+    int64_t max_raw_size = 100;
+
+    minmax_pyramid pyramid(size, 16, 4);
+    array_span<double> span;
+    span.data = values.data();
+    span.size = added;
+    span.stride = 1;
+    pyramid.append(span);
+
+    auto value_at = [&](int64_t i)
+    {
+        return values[i];
+    };
+
+    auto raw_extent = [&](int64_t start, int64_t end)
+    {
+        value_extent r;
+        for (int64_t i = start; i < end; ++i)
+        {
+            if (values[i] < r.min) r.min = values[i];
+            if (values[i] > r.max) r.max = values[i];
+        }
+        return r;
+    };
+
+    // Columns of more and fewer values than max_raw_size.
+    for (double scale : { 1e-3, 0.0173, 0.5 })
+    {
+        int count = 800;
+        double offset = -0.3 * scale * size;
+
+        auto bounds = m4_column_bounds(offset, scale, 0, count, size);
+        auto columns = m4_aggregate(bounds, &pyramid, value_at, raw_extent, max_raw_size);
+        auto expected = brute_force(values, offset, scale, 0, count);
+
+        int unreduced = 0;
+
+        for (int c = 0; c < count; ++c)
+        {
+            bool reduced = bounds[c + 1] <= added;
+            bool small = bounds[c + 1] - bounds[c] <= max_raw_size;
+
+            if (reduced || small)
+            {
+                if (!same(columns[c], expected[c]))
+                {
+                    test.assert(false) << "Column " << c << " differs at scale " << scale;
+                    break;
+                }
+                continue;
+            }
+
+            // Left empty until reduced, with its first and last value.
+            ++unreduced;
+
+            if (columns[c].count != expected[c].count || !columns[c].extent.is_empty() ||
+                    !same_value(columns[c].first, expected[c].first) ||
+                    !same_value(columns[c].last, expected[c].last))
+            {
+                test.assert(false) << "Unreduced column " << c << " at scale " << scale;
+                break;
+            }
+        }
+
+        if (scale < 0.01)
+            test.assert(unreduced > 0) << "No unreduced columns at scale " << scale;
+    }
+
+    // Without a pyramid, only small columns are reduced.
+    {
+        auto bounds = m4_column_bounds(0, 1e-3, 0, 10, size);
+        auto columns = m4_aggregate(bounds, (const minmax_pyramid *) nullptr,
+                                    value_at, raw_extent, max_raw_size);
+        bool all_empty = true;
+        for (auto & column : columns)
+            all_empty &= column.extent.is_empty();
+        test.assert("Large columns empty without pyramid.", all_empty);
+    }
+
+    return test.success();
+}
+
+static bool test_aggregate_blocks()
+{
+    Test test;
+
+    int64_t size = 200000;
+    int64_t block_size = 16;
+    auto values = random_walk(size, 6);
+
+    // Half of the line is reduced.
+    int64_t added = size / 2;
+
+    minmax_pyramid pyramid(size, block_size, 4);
+    array_span<double> span;
+    span.data = values.data();
+    span.size = added;
+    span.stride = 1;
+    pyramid.append(span);
+
+    // Columns of many blocks, from the start of the line to past its end.
+    for (double scale : { 1e-4, 3e-3, 1.0 / 17 })
+    {
+        int count = 800;
+        double offset = 0.25 - 0.1 * scale * size;
+
+        auto bounds = m4_column_bounds(offset, scale, 0, count, size);
+        auto columns = m4_aggregate_blocks(bounds, pyramid);
+
+        // Bounds rounded to the nearest block boundary.
+        auto snapped = [&](int64_t index)
+        {
+            if (index >= size)
+                return size;
+            return std::min(size, (index + block_size / 2) / block_size * block_size);
+        };
+
+        for (int c = 0; c < count; ++c)
+        {
+            int64_t start = snapped(bounds[c]);
+            int64_t end = snapped(bounds[c + 1]);
+
+            m4_column expected;
+            if (end > start)
+                expected.count = bounds[c + 1] - bounds[c];
+
+            if (end > start && end <= added)
+            {
+                expected.first = values[start];
+                expected.last = values[end - 1];
+                for (int64_t i = start; i < end; ++i)
+                {
+                    if (values[i] < expected.extent.min) expected.extent.min = values[i];
+                    if (values[i] > expected.extent.max) expected.extent.max = values[i];
+                }
+            }
+
+            if (!same(columns[c], expected))
+            {
+                test.assert(false) << "Column " << c << " differs at scale " << scale;
+                break;
+            }
+        }
+    }
+
+    return test.success();
+}
+
+Test_Set m4_tests()
+{
+    return {
+        { "column-bounds", &test_column_bounds },
+        { "aggregate", &test_aggregate },
+        { "aggregate-partial", &test_aggregate_partial },
+        { "aggregate-blocks", &test_aggregate_blocks },
+    };
+}
@@ -0,0 +1,210 @@
+#include "../testing/testing.h"
+#include "../data/memo_cache.hpp"
+#include "../reactive/thread_pool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static memo_key make_key(uint64_t source, const string & operation, double parameter = 0)
+{
+    memo_key key;
+    key.source = source;
+    key.offset = { 0, 0 };
+    key.size = { 10, 10 };
+    key.operation = operation;
+    key.parameters = { parameter };
+    return key;
+}
+
+static size_t unit_cost(const int &) { return 1; }
+
+template <typename T>
+static bool wait_for(const Reactive::Value<T> & v)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while(!v->ready)
+    {
+        if (chrono::steady_clock::now() > deadline)
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static bool test_in_flight()
+{
+    Test test;
+
+    memo_cache cache(100);
+    Reactive::Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+    int start_count = 0;
+
+    auto start = [&]()
+    {
+        ++start_count;
+        return Reactive::apply(pool, [&](Reactive::Status&)
+        {
+            while(!release)
+                this_thread::yield();
+            return 7;
+        });
+    };
+
+    auto key = make_key(1, "op");
+
+    auto a = cache.get<int>(key, start, unit_cost);
+    auto b = cache.get<int>(key, start, unit_cost);
+
+    test.assert("Joined the computation in flight.", a == b);
+    test.assert(start_count == 1) << "Started: " << start_count;
+
+    release = true;
+
+    test.assert("Result is ready.", wait_for(a));
+
+    auto c = cache.get<int>(key, start, unit_cost);
+
+    test.assert("Result was memoized.", c == a && c->value == 7);
+    test.assert(start_count == 1) << "Started: " << start_count;
+    test.assert(cache.used() == 1) << "Used: " << cache.used();
+
+    return test.success();
+}
+
+static bool test_cancelled()
+{
+    Test test;
+
+    memo_cache cache(100);
+    Reactive::Thread_Pool pool(1);
+
+    atomic<bool> release { false };
+    int start_count = 0;
+
+    auto start = [&]()
+    {
+        ++start_count;
+        return Reactive::apply(pool, [&](Reactive::Status &)
+        {
+            while(!release)
+                this_thread::yield();
+            return 1;
+        });
+    };
+
+    auto key = make_key(1, "op");
+
+    {
+        auto a = cache.get<int>(key, start, unit_cost);
+    }
+
+    // Dropped before done, so the cache does not keep it.
+    test.assert("Cancelled computation is not cached.", !cache.contains(key));
+
+    release = true;
+
+    auto b = cache.get<int>(key, start, unit_cost);
+    test.assert(start_count == 2) << "Started: " << start_count;
+    test.assert("Result is ready.", wait_for(b));
+
+    return test.success();
+}
+
+static bool test_eviction()
+{
+    Test test;
+
+    memo_cache cache(10);
+
+    auto get = [&](const memo_key & key, int value, size_t cost)
+    {
+        return cache.get<int>(key, [=](){ return Reactive::value(value); },
+                              [=](const int &){ return cost; });
+    };
+
+    auto a = make_key(1, "op", 1);
+    auto b = make_key(1, "op", 2);
+    auto c = make_key(2, "op", 1);
+
+    get(a, 1, 4);
+    get(b, 2, 4);
+
+    // Use a, so b is least recently used.
+    get(a, 1, 4);
+
+    get(c, 3, 4);
+
+    test.assert("Kept a.", cache.contains(a));
+    test.assert("Evicted b.", !cache.contains(b));
+    test.assert("Kept c.", cache.contains(c));
+    test.assert(cache.used() == 8) << "Used: " << cache.used();
+
+    cache.remove(1);
+
+    test.assert("Removed source 1.", !cache.contains(a));
+    test.assert("Kept source 2.", cache.contains(c));
+    test.assert(cache.used() == 4) << "Used: " << cache.used();
+
+    cache.set_budget(0);
+
+    test.assert(cache.count() == 0) << "Count: " << cache.count();
+
+    return test.success();
+}
+
+static bool test_keys()
+{
+    Test test;
+
+    memo_cache cache(100);
+
+    int start_count = 0;
+    auto get = [&](const memo_key & key)
+    {
+        return cache.get<int>(key, [&](){ ++start_count; return Reactive::value(0); }, unit_cost);
+    };
+
+    auto key = make_key(1, "op");
+
+    get(key);
+
+    auto other_source = key;
+    other_source.source = 2;
+    get(other_source);
+
+    auto other_region = key;
+    other_region.offset = { 0, 1 };
+    get(other_region);
+
+    auto other_operation = key;
+    other_operation.operation = "other";
+    get(other_operation);
+
+    auto other_parameters = key;
+    other_parameters.parameters = { 1 };
+    get(other_parameters);
+
+    get(key);
+
+    test.assert(start_count == 5) << "Started: " << start_count;
+
+    return test.success();
+}
+
+Test_Set memo_cache_tests()
+{
+    return {
+        { "in-flight", &test_in_flight },
+        { "cancelled", &test_cancelled },
+        { "eviction", &test_eviction },
+        { "keys", &test_keys },
+    };
+}
@@ -0,0 +1,504 @@
+#include "../testing/testing.h"
+#include "../data/minmax_pyramid.hpp"
+#include "../data/tiled_array.hpp"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <thread>
+#include <atomic>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static vector<double> random_values(int64_t count, unsigned seed = 1)
+{
+    mt19937 random(seed);
+    uniform_real_distribution<double> dist(-100, 100);
+    vector<double> values(count);
+    for (auto & v : values)
+        v = dist(random);
+    return values;
+}
+
+static array_span<double> make_span(const double * data, int64_t size, int64_t stride = 1)
+{
+    array_span<double> span;
+    span.data = const_cast<double*>(data);
+    span.size = size;
+    span.stride = stride;
+    return span;
+}
+
+static value_extent brute_force(const vector<double> & values, int64_t start, int64_t end)
+{
+    value_extent r;
+    for (int64_t i = start; i < end; ++i)
+    {
+        if (values[i] < r.min) r.min = values[i];
+        if (values[i] > r.max) r.max = values[i];
+    }
+    return r;
+}
+
+static bool same(const value_extent & a, const value_extent & b)
+{
+    if (a.is_empty() || b.is_empty())
+        return a.is_empty() == b.is_empty();
+    return a.min == b.min && a.max == b.max;
+}
+
+// Reads tiles from an array in memory.
+class array_tile_source : public tile_source<double>
+{
+public:
+    array_tile_source(datavis::array<double> & data): data(data) {}
+
+    void read(const vector<int64_t> & offset, const vector<int64_t> & size, double * buffer) override
+    {
+        for (auto & element : get_region(data, offset, size))
+            *buffer++ = element.value();
+    }
+
+    datavis::array<double> & data;
+};
+
+// Compares the first and last value of final blocks of level 0 against the values.
+static bool check_block_ends(Test & test, const minmax_pyramid & pyramid, const vector<double> & values)
+{
+    int64_t block_size = pyramid.block_size(0);
+    for (int64_t b = 0; b < pyramid.filled(0); ++b)
+    {
+        int64_t start = b * block_size;
+        int64_t end = std::min(start + block_size, int64_t(values.size()));
+        if (pyramid.block_first(b) != values[start] || pyramid.block_last(b) != values[end - 1])
+        {
+            test.assert(false) << "Wrong first or last value of block " << b;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Compares all final blocks against the values.
+static bool check_blocks(Test & test, const minmax_pyramid & pyramid, const vector<double> & values)
+{
+    bool ok = true;
+
+    for (int l = 0; l < pyramid.level_count(); ++l)
+    {
+        int64_t block_size = pyramid.block_size(l);
+        for (int64_t b = 0; b < pyramid.filled(l); ++b)
+        {
+            int64_t start = b * block_size;
+            int64_t end = std::min(start + block_size, int64_t(values.size()));
+            if (!same(pyramid.block(l, b), brute_force(values, start, end)))
+            {
+                test.assert(false) << "Wrong block " << b << " at level " << l;
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+static bool test_levels()
+{
+    Test test;
+
+    {
+        minmax_pyramid pyramid(1000, 10, 4);
+
+        test.assert(pyramid.level_count() == 5) << "Levels: " << pyramid.level_count();
+        test.assert(pyramid.block_size(0) == 10) << "Block size: " << pyramid.block_size(0);
+        test.assert(pyramid.block_size(2) == 160) << "Block size: " << pyramid.block_size(2);
+        test.assert(pyramid.block_count(0) == 100) << "Blocks: " << pyramid.block_count(0);
+        test.assert(pyramid.block_count(1) == 25) << "Blocks: " << pyramid.block_count(1);
+        test.assert(pyramid.block_count(4) == 1) << "Blocks: " << pyramid.block_count(4);
+
+        test.assert(pyramid.level_for(5) == -1) << "Level: " << pyramid.level_for(5);
+        test.assert(pyramid.level_for(10) == 0) << "Level: " << pyramid.level_for(10);
+        test.assert(pyramid.level_for(200) == 2) << "Level: " << pyramid.level_for(200);
+        test.assert(pyramid.level_for(1e9) == 4) << "Level: " << pyramid.level_for(1e9);
+    }
+
+    {
+        minmax_pyramid pyramid(5, 10, 4);
+        test.assert(pyramid.level_count() == 1) << "Levels: " << pyramid.level_count();
+    }
+
+    {
+        minmax_pyramid pyramid(0);
+        test.assert(pyramid.level_count() == 0) << "Levels: " << pyramid.level_count();
+        test.assert("Empty pyramid is complete.", pyramid.is_complete());
+    }
+
+    return test.success();
+}
+
+static bool test_blocks()
+{
+    Test test;
+
+    // Sizes not multiple of block sizes give partial last blocks.
+    for (int64_t size : { 1, 7, 64, 1000, 12345 })
+    {
+        auto values = random_values(size, size);
+
+        minmax_pyramid pyramid(size, 8, 3);
+        pyramid.append(make_span(values.data(), size));
+
+        test.assert(pyramid.is_complete()) << "Complete for size " << size;
+
+        for (int l = 0; l < pyramid.level_count(); ++l)
+        {
+            test.assert(pyramid.filled(l) == pyramid.block_count(l))
+                    << "Level " << l << " filled for size " << size;
+        }
+
+        check_blocks(test, pyramid, values);
+    }
+
+    return test.success();
+}
+
+static bool test_incremental()
+{
+    Test test;
+
+    int64_t size = 10000;
+    auto values = random_values(size);
+
+    minmax_pyramid pyramid(size, 16, 4);
+
+    mt19937 random(7);
+    uniform_int_distribution<int64_t> part_size(1, 500);
+
+    int64_t added = 0;
+    while (added < size)
+    {
+        int64_t count = std::min(part_size(random), size - added);
+        pyramid.append(make_span(values.data() + added, count));
+        added += count;
+
+        test.assert(pyramid.added() == added) << "Added: " << pyramid.added();
+
+        test.assert(pyramid.filled(0) == added / 16 || added == size)
+                << "Level 0 filled: " << pyramid.filled(0);
+
+        if (!check_blocks(test, pyramid, values))
+            break;
+    }
+
+    test.assert("Complete.", pyramid.is_complete());
+
+    return test.success();
+}
+
+static bool test_strided_and_nan()
+{
+    Test test;
+
+    int64_t size = 100;
+    int64_t stride = 3;
+
+    vector<double> data(size * stride, 1000);
+    vector<double> values(size);
+    for (int64_t i = 0; i < size; ++i)
+    {
+        values[i] = (i >= 20 && i < 40) ? NAN : double(i % 17);
+        data[i * stride] = values[i];
+    }
+
+    minmax_pyramid pyramid(size, 10, 2);
+    pyramid.append(make_span(data.data(), size, stride));
+
+    check_blocks(test, pyramid, values);
+
+    test.assert("Block of NaN values is empty.", pyramid.block(0, 2).is_empty());
+    test.assert("Top block ignores NaN values.",
+                pyramid.block(pyramid.level_count() - 1, 0).max == 16);
+
+    return test.success();
+}
+
+static bool test_build_region()
+{
+    Test test;
+
+    // A line along the second dimension of a 2D array.
+    int64_t rows = 3;
+    int64_t columns = 5000;
+    datavis::array<double> data({ rows, columns });
+    auto values = random_values(rows * columns);
+    std::copy(values.begin(), values.end(), data.data());
+
+    vector<double> line(values.begin() + columns, values.begin() + 2 * columns);
+
+    auto region = get_region(data, { 1, 0 }, { 1, columns });
+
+    minmax_pyramid pyramid(columns, 32, 8);
+
+    Reactive::Status status;
+    pyramid.build(region, &status);
+
+    test.assert("Complete.", pyramid.is_complete());
+    check_blocks(test, pyramid, line);
+    check_block_ends(test, pyramid, line);
+
+    return test.success();
+}
+
+static bool test_build_tiled()
+{
+    Test test;
+
+    // A line along the second dimension of a 2D array,
+    // crossing tiles of both dimensions.
+    int64_t rows = 3;
+    int64_t columns = 5000;
+    datavis::array<double> data({ rows, columns });
+    auto values = random_values(rows * columns);
+    std::copy(values.begin(), values.end(), data.data());
+
+    vector<double> line(values.begin() + columns, values.begin() + 2 * columns);
+
+    tile_cache cache(1 << 20);
+    auto source = make_shared<array_tile_source>(data);
+    tiled_array<double> tiled({ rows, columns }, { 2, 700 }, source, cache);
+
+    minmax_pyramid pyramid(columns, 32, 8);
+
+    Reactive::Status status;
+    pyramid.build(tiled, { 1, 0 }, { 1, columns }, &status);
+
+    test.assert("Complete.", pyramid.is_complete());
+    check_blocks(test, pyramid, line);
+    check_block_ends(test, pyramid, line);
+
+    return test.success();
+}
+
+static bool test_build_multiple()
+{
+    Test test;
+
+    // Lines of different arrays, one along the second dimension of a 2D array.
+    int64_t size = 300000;
+
+    datavis::array<double> a({ size });
+    datavis::array<double> b({ 2, size });
+
+    auto a_values = random_values(size, 2);
+    auto b_values = random_values(2 * size, 3);
+    std::copy(a_values.begin(), a_values.end(), a.data());
+    std::copy(b_values.begin(), b_values.end(), b.data());
+
+    vector<double> b_line(b_values.begin() + size, b_values.end());
+
+    minmax_pyramid a_pyramid(size, 32, 8);
+    minmax_pyramid b_pyramid(size, 64, 4);
+
+    Reactive::Status status;
+    build_pyramids({ &a_pyramid, &b_pyramid },
+                   { get_all(a), get_region(b, { 1, 0 }, { 1, size }) },
+                   &status);
+
+    test.assert("First complete.", a_pyramid.is_complete());
+    test.assert("Second complete.", b_pyramid.is_complete());
+    check_blocks(test, a_pyramid, a_values);
+    check_blocks(test, b_pyramid, b_line);
+
+    return test.success();
+}
+
+static bool test_build_multiple_tiled()
+{
+    Test test;
+
+    // Lines along the first dimension of two attributes.
+    int64_t size = 100000;
+    int64_t columns = 4;
+
+    datavis::array<double> a({ size, columns });
+    datavis::array<double> b({ size, columns });
+
+    auto a_values = random_values(size * columns, 2);
+    auto b_values = random_values(size * columns, 3);
+    std::copy(a_values.begin(), a_values.end(), a.data());
+    std::copy(b_values.begin(), b_values.end(), b.data());
+
+    vector<double> a_line(size);
+    vector<double> b_line(size);
+    for (int64_t i = 0; i < size; ++i)
+    {
+        a_line[i] = a_values[i * columns + 2];
+        b_line[i] = b_values[i * columns + 2];
+    }
+
+    tile_cache cache(1 << 20);
+    tiled_array<double> a_tiled({ size, columns }, { 3000, 4 }, make_shared<array_tile_source>(a), cache);
+    tiled_array<double> b_tiled({ size, columns }, { 3000, 4 }, make_shared<array_tile_source>(b), cache);
+
+    minmax_pyramid a_pyramid(size, 32, 8);
+    minmax_pyramid b_pyramid(size, 64, 4);
+
+    Reactive::Status status;
+    build_pyramids({ &a_pyramid, &b_pyramid }, { &a_tiled, &b_tiled },
+                   { 0, 2 }, { size, 1 }, &status);
+
+    test.assert("First complete.", a_pyramid.is_complete());
+    test.assert("Second complete.", b_pyramid.is_complete());
+    check_blocks(test, a_pyramid, a_line);
+    check_blocks(test, b_pyramid, b_line);
+    check_block_ends(test, b_pyramid, b_line);
+
+    return test.success();
+}
+
+static bool test_concurrent_read()
+{
+    Test test;
+
+    int64_t size = 1 << 20;
+    auto values = random_values(size);
+
+    minmax_pyramid pyramid(size, 64, 8);
+
+    thread writer([&]()
+    {
+        for (int64_t i = 0; i < size; i += 4096)
+            pyramid.append(make_span(values.data() + i, std::min(int64_t(4096), size - i)));
+    });
+
+    // Final blocks can be read while the pyramid is being built.
+    int level = 1;
+    int64_t checked = 0;
+    while (checked < pyramid.block_count(level))
+    {
+        int64_t filled = pyramid.filled(level);
+        for (; checked < filled; ++checked)
+        {
+            int64_t start = checked * pyramid.block_size(level);
+            int64_t end = std::min(start + pyramid.block_size(level), size);
+            if (!same(pyramid.block(level, checked), brute_force(values, start, end)))
+            {
+                test.assert(false) << "Wrong block " << checked;
+                checked = pyramid.block_count(level);
+                break;
+            }
+        }
+    }
+
+    writer.join();
+
+    return test.success();
+}
+
+static bool test_extent()
+{
+    Test test;
+
+    int64_t size = 5000;
+    auto values = random_values(size, 3);
+    values[1234] = NAN;
+
+    int edge_values = 0;
+
+    auto edge_extent = [&](int64_t start, int64_t end)
+    {
+        edge_values += end - start;
+        return brute_force(values, start, end);
+    };
+
+    minmax_pyramid pyramid(size, 8, 3);
+
+    mt19937 random(11);
+
+    // While partially built, and once complete.
+    for (int64_t added : { int64_t(1000), int64_t(2501), size })
+    {
+        pyramid.append(make_span(values.data() + pyramid.added(), added - pyramid.added()));
+
+        uniform_int_distribution<int64_t> index(0, added);
+
+        vector<pair<int64_t,int64_t>> ranges = { { 0, added }, { 0, 1 }, { added - 1, added },
+                                                 { 8, 16 }, { 7, 17 } };
+        for (int i = 0; i < 500; ++i)
+        {
+            int64_t a = index(random);
+            int64_t b = index(random);
+            ranges.emplace_back(std::min(a, b), std::max(a, b));
+        }
+
+        for (auto & range : ranges)
+        {
+            edge_values = 0;
+
+            auto result = pyramid.extent(range.first, range.second, edge_extent);
+            auto expected = brute_force(values, range.first, range.second);
+
+            if (!same(result, expected))
+            {
+                test.assert(false) << "Wrong extent of " << range.first << " - " << range.second
+                                   << " of " << added;
+                break;
+            }
+
+            if (edge_values > 2 * pyramid.block_size(0))
+            {
+                test.assert(false) << "Reduced " << edge_values << " edge values of "
+                                   << range.first << " - " << range.second;
+                break;
+            }
+        }
+    }
+
+    return test.success();
+}
+
+static bool test_blocks_extent()
+{
+    Test test;
+
+    int64_t size = 1 << 20;
+    vector<double> values(size);
+    for (int64_t i = 0; i < size; ++i)
+        values[i] = double(i);
+
+    minmax_pyramid pyramid(size, 4, 4);
+    pyramid.append(make_span(values.data(), size));
+
+    // Blocks of every level are final, so the whole range
+    // takes a single block of the top level.
+    auto whole = pyramid.blocks_extent(0, 0, pyramid.block_count(0));
+    test.assert(whole.min == 0 && whole.max == size - 1)
+            << "Extent: " << whole.min << " - " << whole.max;
+
+    auto part = pyramid.blocks_extent(0, 3, pyramid.block_count(0) - 5);
+    test.assert(part.min == 12 && part.max == size - 21)
+            << "Extent: " << part.min << " - " << part.max;
+
+    return test.success();
+}
+
+Test_Set minmax_pyramid_tests()
+{
+    return {
+        { "levels", &test_levels },
+        { "blocks", &test_blocks },
+        { "incremental", &test_incremental },
+        { "strided-and-nan", &test_strided_and_nan },
+        { "build-region", &test_build_region },
+        { "build-tiled", &test_build_tiled },
+        { "build-multiple", &test_build_multiple },
+        { "build-multiple-tiled", &test_build_multiple_tiled },
+        { "concurrent-read", &test_concurrent_read },
+        { "extent", &test_extent },
+        { "blocks-extent", &test_blocks_extent },
+    };
+}
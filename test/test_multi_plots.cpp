@@ -25,7 +25,7 @@ int main(int argc, char *argv[])
 
     double base_freq = 1.0/200.0;
 
-    auto source1 = make_shared<DataSet>(vector<int>({data_size}));
+    auto source1 = make_shared<DataSet>(vector<int64_t>({data_size}));
 
     {
         //cout << "Generating data:" << endl;
@@ -38,7 +38,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    auto source2 = make_shared<DataSet>(vector<int>({data_size}));
+    auto source2 = make_shared<DataSet>(vector<int64_t>({data_size}));
 
     DataSet::Dimension dim;
     dim.map.offset = 100;
@@ -0,0 +1,145 @@
+#include "../testing/testing.h"
+#include "../data/parallel.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static datavis::array<double> make_array(const vector<int64_t> & size)
+{
+    datavis::array<double> a(size);
+    int64_t count = flat_size(size);
+    for (int64_t i = 0; i < count; ++i)
+        a.data()[i] = i;
+    return a;
+}
+
+static bool test_split_line()
+{
+    Test test;
+
+    auto a = make_array({ 3, 1000 });
+    auto region = get_region(a, { 1, 0 }, { 1, 1000 });
+    auto blocks = split_region(region, 300);
+
+    test.assert(blocks.size() == 4) << "Block count: " << blocks.size();
+    if (blocks.size() == 4)
+    {
+        test.assert(blocks[1].offset()[1] == 300) << "Block 1 offset: " << blocks[1].offset()[1];
+        test.assert(blocks[3].size()[1] == 100) << "Last block size: " << blocks[3].size()[1];
+    }
+
+    return test.success();
+}
+
+static bool test_parallel_for_covers_region()
+{
+    Test test;
+
+    auto a = make_array({ 17, 23, 29 });
+    auto region = get_region(a, { 1, 2, 3 }, { 15, 20, 25 });
+
+    vector<atomic<int>> visits(flat_size(a.size()));
+    for (auto & v : visits)
+        v = 0;
+
+    parallel_for(region, [&](const array_region<double> & block)
+    {
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            for (int i = 0; i < span.size; ++i)
+                ++visits[span.index + i * span.stride];
+        });
+    },
+    100);
+
+    vector<int> expected(visits.size(), 0);
+    for (auto & element : region)
+        expected[element.index()] = 1;
+
+    bool ok = true;
+    for (size_t i = 0; i < visits.size(); ++i)
+        ok &= visits[i] == expected[i];
+
+    test.assert("Each element of region is visited exactly once.", ok);
+
+    return test.success();
+}
+
+static bool test_parallel_reduce_deterministic()
+{
+    Test test;
+
+    datavis::array<double> a({ 100000 });
+    for (int i = 0; i < 100000; ++i)
+        a.data()[i] = 1.0 / (i + 1);
+
+    auto map = [](const array_region<double> & block)
+    {
+        double s = 0;
+        for_each_span(block, [&](const array_span<double> & span)
+        {
+            for (int i = 0; i < span.size; ++i)
+                s += span.data[i * span.stride];
+        });
+        return s;
+    };
+
+    auto merge = [](double a, double b) { return a + b; };
+
+    // Sequential sum in the same block order
+    double expected = 0;
+    for (auto & block : split_region(get_all(a), 1000))
+        expected = merge(expected, map(block));
+
+    bool same = true;
+    for (int run = 0; run < 20; ++run)
+    {
+        double result = parallel_reduce(get_all(a), 0.0, map, merge, 1000);
+        same &= result == expected;
+    }
+
+    test.assert("Results are identical in every run.", same);
+
+    return test.success();
+}
+
+static bool test_parallel_exception()
+{
+    Test test;
+
+    auto a = make_array({ 10000 });
+
+    bool thrown = false;
+
+    try
+    {
+        parallel_for(get_all(a), [](const array_region<double> & block)
+        {
+            if (block.offset()[0] == 5000)
+                throw std::runtime_error("Failure");
+        },
+        1000);
+    }
+    catch (std::runtime_error &)
+    {
+        thrown = true;
+    }
+
+    test.assert("Exception is propagated to caller.", thrown);
+
+    return test.success();
+}
+
+Test_Set parallel_tests()
+{
+    return {
+        { "split-line", &test_split_line },
+        { "parallel-for-covers-region", &test_parallel_for_covers_region },
+        { "parallel-reduce-deterministic", &test_parallel_reduce_deterministic },
+        { "parallel-exception", &test_parallel_exception },
+    };
+}
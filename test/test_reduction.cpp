@@ -0,0 +1,192 @@
+#include "../testing/testing.h"
+#include "../data/reduction.hpp"
+
+#include <random>
+#include <cmath>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+static datavis::array<double> make_random_array(const vector<int64_t> & size)
+{
+    datavis::array<double> a(size);
+
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> distribution(-100, 100);
+
+    int64_t count = flat_size(size);
+    for (int64_t i = 0; i < count; ++i)
+        a.data()[i] = distribution(generator);
+
+    return a;
+}
+
+static bool close(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+static void check_region(Test & test, array_region<double> region)
+{
+    vector<double> values;
+    for (auto & element : region)
+        values.push_back(element.value());
+
+    double ref_min = *std::min_element(values.begin(), values.end());
+    double ref_max = *std::max_element(values.begin(), values.end());
+
+    double ref_sum = 0;
+    for (double v : values)
+        ref_sum += v;
+
+    double ref_mean = ref_sum / values.size();
+
+    double ref_variance = 0;
+    for (double v : values)
+        ref_variance += (v - ref_mean) * (v - ref_mean);
+    ref_variance /= values.size();
+
+    auto extent = min_max(region);
+
+    test.assert(extent.min == ref_min) << "Min: " << extent.min << " != " << ref_min;
+    test.assert(extent.max == ref_max) << "Max: " << extent.max << " != " << ref_max;
+    test.assert(minimum(region) == ref_min) << "Minimum: " << minimum(region);
+    test.assert(maximum(region) == ref_max) << "Maximum: " << maximum(region);
+    test.assert(close(sum(region), ref_sum)) << "Sum: " << sum(region) << " != " << ref_sum;
+    test.assert(close(mean(region), ref_mean)) << "Mean: " << mean(region) << " != " << ref_mean;
+    test.assert(close(variance(region), ref_variance))
+            << "Variance: " << variance(region) << " != " << ref_variance;
+}
+
+static bool test_contiguous()
+{
+    Test test;
+
+    // Odd size exercises the scalar tail of SIMD kernels.
+    auto a = make_random_array({ 10007 });
+    check_region(test, get_all(a));
+
+    return test.success();
+}
+
+static bool test_sub_regions()
+{
+    Test test;
+
+    auto a = make_random_array({ 13, 17, 19 });
+    check_region(test, get_all(a));
+    check_region(test, get_region(a, { 2, 3, 4 }, { 5, 7, 11 }));
+    check_region(test, get_region(a, { 0, 5, 6 }, { 13, 1, 1 }));
+    check_region(test, get_region(a, { 3, 0, 0 }, { 1, 17, 19 }));
+
+    return test.success();
+}
+
+static bool test_nan_ignored_by_min_max()
+{
+    Test test;
+
+    datavis::array<double> a({ 11 });
+    for (int i = 0; i < 11; ++i)
+        a.data()[i] = i;
+    a.data()[0] = NAN;
+    a.data()[7] = NAN;
+
+    auto extent = min_max(get_all(a));
+    test.assert(extent.min == 1) << "Min: " << extent.min;
+    test.assert(extent.max == 10) << "Max: " << extent.max;
+
+    return test.success();
+}
+
+static bool test_empty()
+{
+    Test test;
+
+    auto a = make_random_array({ 4, 5 });
+    auto region = get_region(a, { 0, 0 }, { 0, 5 });
+
+    test.assert("Extent is empty.", min_max(region).is_empty());
+    test.assert("Minimum is 0.", minimum(region) == 0);
+    test.assert("Maximum is 0.", maximum(region) == 0);
+    test.assert("Count is 0.", moments(region).count == 0);
+
+    return test.success();
+}
+
+static bool test_statistics()
+{
+    Test test;
+
+    auto a = make_random_array({ 101, 103 });
+    a.data()[5] = NAN;
+    a.data()[500] = INFINITY;
+    a.data()[7000] = -INFINITY;
+
+    auto region = get_region(a, { 1, 2 }, { 99, 100 });
+
+    vector<double> values;
+    int64_t ref_non_finite = 0;
+    for (auto & element : region)
+    {
+        if (std::isfinite(element.value()))
+            values.push_back(element.value());
+        else
+            ++ref_non_finite;
+    }
+
+    double ref_min = *std::min_element(values.begin(), values.end());
+    double ref_max = *std::max_element(values.begin(), values.end());
+    double ref_mean = 0;
+    for (double v : values)
+        ref_mean += v;
+    ref_mean /= values.size();
+
+    auto stats = statistics(region);
+
+    test.assert(stats.non_finite_count == ref_non_finite)
+            << "Non-finite count: " << stats.non_finite_count << " != " << ref_non_finite;
+    test.assert(stats.moments.count == int64_t(values.size()))
+            << "Count: " << stats.moments.count << " != " << values.size();
+    test.assert(stats.extent.min == ref_min) << "Min: " << stats.extent.min << " != " << ref_min;
+    test.assert(stats.extent.max == ref_max) << "Max: " << stats.extent.max << " != " << ref_max;
+    test.assert(close(stats.moments.mean, ref_mean)) << "Mean: " << stats.moments.mean << " != " << ref_mean;
+
+    return test.success();
+}
+
+static bool test_histogram()
+{
+    Test test;
+
+    datavis::array<double> a({ 1000 });
+    for (int i = 0; i < 1000; ++i)
+        a.data()[i] = i % 10;
+    a.data()[3] = NAN;
+
+    auto bins = histogram(get_all(a), 0, 9, 3);
+
+    test.assert(bins.size() == 3) << "Bin count: " << bins.size();
+    if (bins.size() == 3)
+    {
+        // Bins: [0,3), [3,6), [6,9]
+        test.assert(bins[0] == 300) << "Bin 0: " << bins[0];
+        test.assert(bins[1] == 299) << "Bin 1: " << bins[1];
+        test.assert(bins[2] == 400) << "Bin 2: " << bins[2];
+    }
+
+    return test.success();
+}
+
+Test_Set reduction_tests()
+{
+    return {
+        { "contiguous", &test_contiguous },
+        { "sub-regions", &test_sub_regions },
+        { "nan-ignored-by-min-max", &test_nan_ignored_by_min_max },
+        { "empty", &test_empty },
+        { "statistics", &test_statistics },
+        { "histogram", &test_histogram },
+    };
+}
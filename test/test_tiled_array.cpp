@@ -0,0 +1,389 @@
+#include "../testing/testing.h"
+#include "../data/tiled_array.hpp"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace Testing;
+using namespace datavis;
+using namespace std;
+
+// Reads tiles from an array in memory, counting reads.
+class memory_tile_source : public tile_source<double>
+{
+public:
+    memory_tile_source(const vector<int64_t> & size): data(size)
+    {
+        int64_t count = flat_size(size);
+        for (int64_t i = 0; i < count; ++i)
+            data.data()[i] = i;
+    }
+
+    void read(const vector<int64_t> & offset, const vector<int64_t> & size, double * buffer) override
+    {
+        ++read_count;
+        for (auto & element : get_region(data, offset, size))
+            *buffer++ = element.value();
+    }
+
+    datavis::array<double> data;
+    atomic<int> read_count { 0 };
+};
+
+static bool check_read(Test & test, tiled_array<double> & tiled, const datavis::array<double> & data,
+                       const vector<int64_t> & offset, const vector<int64_t> & size)
+{
+    auto result = tiled.read(offset, size);
+
+    int64_t count = flat_size(size);
+    vector<int64_t> location(size.size(), 0);
+
+    for (int64_t i = 0; i < count; ++i)
+    {
+        vector<int64_t> source_location(size.size());
+        for (int d = 0; d < (int) size.size(); ++d)
+            source_location[d] = offset[d] + location[d];
+
+        double expected = data(source_location);
+        double actual = result.data()[i];
+        if (actual != expected)
+        {
+            test.assert(false) << "Element " << i << ": expected " << expected << " but got " << actual;
+            return false;
+        }
+
+        for (int d = size.size() - 1; d >= 0; --d)
+        {
+            if (++location[d] < size[d])
+                break;
+            location[d] = 0;
+        }
+    }
+
+    return true;
+}
+
+static bool test_read_region()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    vector<int64_t> size { 13, 17, 19 };
+    auto source = make_shared<memory_tile_source>(size);
+    tiled_array<double> tiled(size, { 4, 5, 6 }, source, cache);
+
+    test.assert(tiled.tile_count() == vector<int64_t>({ 4, 4, 4 })) << "Tile count.";
+
+    check_read(test, tiled, source->data, { 0, 0, 0 }, size);
+    check_read(test, tiled, source->data, { 3, 4, 5 }, { 7, 9, 11 });
+    check_read(test, tiled, source->data, { 12, 0, 7 }, { 1, 17, 1 });
+    check_read(test, tiled, source->data, { 5, 5, 6 }, { 1, 1, 1 });
+
+    return test.success();
+}
+
+static bool test_blocks_cover_region()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    vector<int64_t> size { 20, 30 };
+    auto source = make_shared<memory_tile_source>(size);
+    tiled_array<double> tiled(size, { 8, 7 }, source, cache);
+
+    vector<int64_t> offset { 3, 5 };
+    vector<int64_t> region_size { 15, 22 };
+
+    vector<int> visits(flat_size(size), 0);
+
+    tiled.for_each_block(offset, region_size,
+                         [&](const array_region<double> & block, const vector<int64_t> & block_offset)
+    {
+        auto region = block;
+        for (auto & element : region)
+        {
+            auto location = element.location();
+            for (int d = 0; d < 2; ++d)
+                location[d] += block_offset[d] - block.offset()[d];
+            ++visits[flat_index(location, size)];
+
+            if (element.value() != flat_index(location, size))
+                test.assert(false) << "Wrong value at " << location[0] << ", " << location[1];
+        }
+    });
+
+    bool ok = true;
+    for (int64_t i = 0; i < size[0]; ++i)
+    {
+        for (int64_t j = 0; j < size[1]; ++j)
+        {
+            bool inside = i >= offset[0] && i < offset[0] + region_size[0] &&
+                    j >= offset[1] && j < offset[1] + region_size[1];
+            ok &= visits[flat_index({ i, j }, size)] == (inside ? 1 : 0);
+        }
+    }
+
+    test.assert("Each element of region is visited exactly once.", ok);
+
+    return test.success();
+}
+
+static bool test_cache_reuse()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    vector<int64_t> size { 100 };
+    auto source = make_shared<memory_tile_source>(size);
+    tiled_array<double> tiled(size, { 10 }, source, cache);
+    tiled.set_prefetch_count(0);
+
+    tiled.read({ 0 }, size);
+    test.assert(source->read_count == 10) << "Read count: " << source->read_count;
+
+    tiled.read({ 15 }, { 20 });
+    test.assert(source->read_count == 10) << "Read count after reuse: " << source->read_count;
+
+    return test.success();
+}
+
+static bool test_cache_budget()
+{
+    Test test;
+
+    // Room for 3 tiles of 10 doubles
+    tile_cache cache(3 * 10 * sizeof(double));
+
+    vector<int64_t> size { 100 };
+    auto source = make_shared<memory_tile_source>(size);
+    tiled_array<double> tiled(size, { 10 }, source, cache);
+    tiled.set_prefetch_count(0);
+
+    tiled.read({ 0 }, size);
+
+    test.assert(cache.used() <= cache.budget()) << "Used: " << cache.used();
+    test.assert(cache.count() == 3) << "Cached tile count: " << cache.count();
+
+    // Most recent tiles are still cached
+    tiled.read({ 70 }, { 30 });
+    test.assert(source->read_count == 10) << "Read count: " << source->read_count;
+
+    // Least recent tile was evicted
+    tiled.read({ 0 }, { 1 });
+    test.assert(source->read_count == 11) << "Read count: " << source->read_count;
+
+    return test.success();
+}
+
+static bool test_prefetch()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    vector<int64_t> size { 100 };
+    auto source = make_shared<memory_tile_source>(size);
+    tiled_array<double> tiled(size, { 10 }, source, cache);
+    tiled.set_prefetch_count(2);
+
+    tiled.for_each_block({ 0 }, size, [&](const array_region<double> &, const vector<int64_t> & offset)
+    {
+        if (offset[0] > 0)
+            return;
+
+        // While processing the first tile, the next ones are loaded.
+        bool loaded = false;
+        for (int i = 0; i < 100 && !loaded; ++i)
+        {
+            loaded = source->read_count >= 3;
+            if (!loaded)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        test.assert("Following tiles are prefetched.", loaded);
+    });
+
+    return test.success();
+}
+
+static bool test_concurrent_load()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    atomic<int> load_count { 0 };
+
+    auto load = [&]() -> tile_cache::tile_ptr
+    {
+        ++load_count;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return make_shared<int>(7);
+    };
+
+    vector<thread> threads;
+    vector<int> values(8, 0);
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            auto tile = cache.get(1, 0, sizeof(int), load);
+            values[i] = *static_pointer_cast<int>(tile);
+        });
+    }
+    for (auto & t : threads)
+        t.join();
+
+    test.assert(load_count == 1) << "Load count: " << load_count;
+
+    bool ok = true;
+    for (auto v : values)
+        ok &= v == 7;
+    test.assert("All threads get the tile.", ok);
+
+    return test.success();
+}
+
+static bool test_evict_while_loading()
+{
+    Test test;
+
+    tile_cache cache(2 * sizeof(int));
+
+    atomic<bool> loading { false };
+    atomic<bool> release { false };
+    atomic<int> load_count { 0 };
+
+    auto slow_load = [&]() -> tile_cache::tile_ptr
+    {
+        ++load_count;
+        loading = true;
+        while (!release)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return make_shared<int>(1);
+    };
+
+    thread loader([&]() { cache.get(1, 0, sizeof(int), slow_load); });
+
+    while (!loading)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Exceed the budget while the first tile is loading.
+    for (int i = 1; i < 4; ++i)
+        cache.get(1, i, sizeof(int), []() -> tile_cache::tile_ptr { return make_shared<int>(0); });
+
+    test.assert("Loading tile is kept.", cache.contains(1, 0));
+
+    release = true;
+    loader.join();
+
+    cache.get(1, 0, sizeof(int), slow_load);
+    test.assert(load_count == 1) << "Load count: " << load_count;
+
+    test.assert(cache.used() <= cache.budget()) << "Used: " << cache.used();
+
+    return test.success();
+}
+
+static bool test_failed_load_keeps_replacement()
+{
+    Test test;
+
+    tile_cache cache(1 << 20);
+
+    atomic<bool> loading { false };
+    atomic<bool> release { false };
+
+    auto failing_load = [&]() -> tile_cache::tile_ptr
+    {
+        loading = true;
+        while (!release)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        throw std::runtime_error("Failed.");
+    };
+
+    thread loader([&]()
+    {
+        try { cache.get(1, 0, sizeof(int), failing_load); }
+        catch (std::exception &) {}
+    });
+
+    while (!loading)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Replace the entry while the first load is in progress.
+    cache.remove(1);
+    cache.get(1, 0, sizeof(int), []() -> tile_cache::tile_ptr { return make_shared<int>(2); });
+
+    release = true;
+    loader.join();
+
+    test.assert("Replacement is kept.", cache.contains(1, 0));
+    test.assert(cache.used() == sizeof(int)) << "Used: " << cache.used();
+
+    return test.success();
+}
+
+static bool test_file_source()
+{
+    Test test;
+
+    char path[] = "/tmp/datavis-test-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        test.assert("Create temporary file.", false);
+        return test.success();
+    }
+
+    vector<int64_t> size { 30, 40 };
+    datavis::array<double> data(size);
+    for (int64_t i = 0; i < flat_size(size); ++i)
+        data.data()[i] = i * 0.5;
+
+    // Some bytes before the data
+    int64_t offset = 16;
+    vector<char> header(offset, 0);
+
+    bool written = write(fd, header.data(), offset) == offset;
+    written &= write(fd, data.data(), flat_size(size) * sizeof(double)) == ssize_t(flat_size(size) * sizeof(double));
+    close(fd);
+
+    test.assert("Write temporary file.", written);
+
+    if (written)
+    {
+        tile_cache cache(1 << 20);
+        auto source = make_shared<file_tile_source<double>>(path, offset, size);
+        tiled_array<double> tiled(size, { 8, 8 }, source, cache);
+
+        check_read(test, tiled, data, { 0, 0 }, size);
+        check_read(test, tiled, data, { 7, 9 }, { 13, 21 });
+    }
+
+    std::remove(path);
+
+    return test.success();
+}
+
+Test_Set tiled_array_tests()
+{
+    return {
+        { "read-region", &test_read_region },
+        { "blocks-cover-region", &test_blocks_cover_region },
+        { "cache-reuse", &test_cache_reuse },
+        { "cache-budget", &test_cache_budget },
+        { "prefetch", &test_prefetch },
+        { "concurrent-load", &test_concurrent_load },
+        { "evict-while-loading", &test_evict_while_loading },
+        { "failed-load-keeps-replacement", &test_failed_load_keeps_replacement },
+        { "file-source", &test_file_source },
+    };
+}
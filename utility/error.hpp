@@ -1,3 +1,5 @@
+#pragma once
+
 #include <stdexcept>
 #include <string>
 #include <sstream>
@@ -12,7 +14,7 @@ class Error : public std::exception
 public:
     Error(const string & reason = string()): d_reason(reason) {}
 
-    ostringstream reason() { return ostringstream(d_reason); }
+    std::ostringstream reason() { return std::ostringstream(d_reason); }
 
     const char * what() const noexcept
     {
@@ -2,10 +2,18 @@
 
 namespace datavis {
 
-QThread * background_thread()
+Reactive::Thread_Pool & compute_pool()
 {
-    static QThread background_thread;
-    return &background_thread;
+    static Reactive::Thread_Pool pool(0, "Compute");
+    return pool;
+}
+
+Reactive::Thread_Pool & io_pool()
+{
+    // Reads mostly wait, so more threads than cores can be useful,
+    // but too many compete for the disk.
+    static Reactive::Thread_Pool pool(4, "IO");
+    return pool;
 }
 
 }
@@ -1,9 +1,16 @@
 #pragma once
 
-#include <QThread>
+#include "../reactive/thread_pool.hpp"
 
 namespace datavis {
 
-QThread * background_thread();
+// Shared pool for computations, with a thread per core.
+// Use with Reactive::apply for background computations,
+// or for data-parallel computations.
+Reactive::Thread_Pool & compute_pool();
+
+// Shared pool for blocking reads, such as loading files or data tiles.
+// Use with Reactive::apply for loading data.
+Reactive::Thread_Pool & io_pool();
 
 }